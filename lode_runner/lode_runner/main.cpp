@@ -10,163 +10,396 @@
  * Q: Dig hole to the left-below (if standing on brick/ladder/rope and brick exists there)
  * E: Dig hole to the right-below (if standing on brick/ladder/rope and brick exists there)
  * R: Reset Game
+ * F: Fast-forward (hold, while replaying)
+ * P: Profiler overlay (CPU time per update and draw function, GPU time per pass, draw calls)
  * ESC: Exit
+ *
+ * Options:
+ * --tick-rate=N: Fixed simulation ticks per second (default 60)
+ * --pack=FILE: Play the levels of a binary level pack (see levelpack.h)
+ * --level=N: Pack level to start on (default 0)
+ * --record=FILE: Save each session's inputs to FILE when it ends (the latest session wins)
+ * --replay=FILE: Play a recording instead of the keyboard, which takes over when it ends
+ * --connect=HOST:PORT: Play a session hosted by lode_runner_headless --serve (see net.h);
+ *   play carries on locally if the server goes away
+ * --profile-csv=FILE: Profile from the start and write one CSV row per frame on exit
+ * --profile-trace=FILE: Likewise as a Chrome trace (chrome://tracing, Perfetto); see profile.h
+ * --swap-interval=N: Vertical blanks per buffer swap, 0 to not wait for vsync (default 1)
+ * --fps=N: Frames per second to aim for (default 60); 0 leaves the pace to the swap interval
+ * --always-redraw: Redraw every frame, even while nothing on screen changes
  */
 
 #include <GL/glew.h>      // Must be included before freeglut.h
+#ifdef _WIN32
+#include <GL/wglew.h>     // WGL_EXT_swap_control
+#else
+#include <GL/glxew.h>     // GLX_EXT/MESA_swap_control
+#endif
 #include <GL/freeglut.h>  // Handles window creation, input, and main loop
 #include <vector>
 #include <string>
 #include <iostream>
-#include <sstream>      // For formatting text
+#include <cstdio>       // snprintf for HUD text
 #include <cmath>
 #include <ctime>
 #include <cstdlib>
-#include <map>          // To store digging timers
+#include <cstdint>
+#include <algorithm>    // std::sort for dirty tile ranges
 #include <chrono>       // For delta time and respawn timer
-
- // --- Physics & Movement ---
- // --- Game Constants ---
-const int WINDOW_WIDTH = 800;
-const int WINDOW_HEIGHT = 600;
-const int GRID_WIDTH = 20;  // Number of tiles horizontally
-const int GRID_HEIGHT = 15; // Number of tiles vertically
-const float TILE_SIZE = 40.0f; // Pixel size of a grid tile
-
-// --- Physics & Movement ---
-const float PLAYER_SPEED = 150.0f; // Pixels per second
-const float ENEMY_SPEED = 120.0f;  // Pixels per second
-const float GRAVITY = 500.0f;    // Pixels per second squared
-const float JUMP_FORCE = 10.0f; // Lode Runner doesn't jump
-const float CLIMB_SPEED = 150.0f; // Pixels per second
-const float ROPE_SPEED = 150.0f; // Pixels per second (Speed moving horizontally on ropes)
-
-// --- Gameplay ---
-const int MAX_ENEMIES = 3;
-const int INITIAL_LIVES = 3;
-const float DIG_REFILL_TIME = 7.0f; // Seconds for a dug hole to refill
-const int POINTS_PER_COLLECTIBLE = 100;
-const float ENEMY_RESPAWN_DELAY = 3.0f; // Seconds before enemy respawns
-
-// --- Tile Types ---
-enum TileType {
-    EMPTY = 0,
-    BRICK = 1,       // Diggable
-    LADDER = 2,
-    ROPE = 3,        // Horizontal traversal
-    SOLID_BRICK = 4, // Indestructible
-    EXIT_LADDER = 5, // Appears after collecting all gold
-    // Removed DIGGING_BRICK, handled by dugHoles map
-};
-
-// --- Entity Structure ---
-struct Entity {
-    float x, y;          // Position (bottom-left corner)
-    float vx, vy;          // Velocity (pixels per second)
-    bool isJumping;      // << ADD THIS LINE
-    bool isClimbing;     // On ladder
-    bool isOnRope;       // On rope
-    bool isFalling;      //
-    bool faceRight;      // Direction facing
-    bool isTrapped;      // If stuck in a dug hole
-    float trappedTimer;  // How long they've been trapped (seconds)
-    bool isAlive;        // Track if enemy is alive or waiting to respawn
-    float respawnTimer;  // Timer for enemy respawn (seconds)
-    int startGridX, startGridY; // Initial spawn point for respawning
-};
-
-// --- Dug Hole Structure ---
-struct DugHole {
-    int gridX, gridY;
-    float timer; // Time remaining until refill (seconds)
-    TileType originalType; // What the tile was before digging (should always be BRICK)
+#include <cstddef>      // offsetof for instance attribute layout
+#include <cstring>      // memset for texture generation and the tile cache
+#include <thread>       // Background level preloading
+
+#include "game.h"       // Simulation (lode_runner_sim)
+#include "jobs.h"       // Worker threads for the simulation's parallel loops
+#include "levelpack.h"  // Levels from --pack=FILE
+#include "replay.h"     // --record/--replay
+#include "net.h"        // --connect
+#include "profile.h"    // P overlay, --profile-csv/--profile-trace
+#include "pacing.h"     // Ticks per frame and when the frame loop idles
+
+// --- Game Constants ---
+const int WINDOW_WIDTH = 800;  // VIEW_WIDTH tiles
+const int WINDOW_HEIGHT = 600; // VIEW_HEIGHT tiles
+
+// --- Frame Pacing ---
+// update() runs on a fixed cadence of targetFrameRate per second, whether or not a frame
+// pays for a tick (see pacing.h). With render-on-change (the default) a frame is only
+// drawn when the picture can have changed: while a session is in play, replayed, online
+// or showing the profiler, and after input or a window change. Once the session is over
+// (game over, level won) the loop stops until the next event, so an idle cabinet neither
+// ticks nor draws; nor is anything drawn while the window is hidden.
+const int DEFAULT_FRAME_RATE = 60;          // Frames per second update() aims for
+int swapInterval = 1;                       // Set with --swap-interval=N
+int targetFrameRate = DEFAULT_FRAME_RATE;   // Set with --fps=N, 0 = as fast as the swap allows
+bool renderOnChange = true;                 // Cleared by --always-redraw
+bool windowVisible = true;                  // Not minimised or fully covered
+bool redrawRequested = true;                // Draw the next frame even if nothing moved
+bool frameLoopIdle = false;                 // No update() pending; requestRedraw() restarts it
+FrameCadence frameCadence;                  // When update() is due, on clockSeconds()
+
+// --- Sprites ---
+// Every procedurally generated sprite lives in one layer of spriteAtlas
+// (a GL_TEXTURE_2D_ARRAY), so any tile or entity can be drawn without a texture bind.
+// Append new sprites (animation frames, enemy variants) before SPRITE_COUNT.
+enum SpriteId {
+    SPRITE_BRICK = 0,
+    SPRITE_LADDER = 1,
+    SPRITE_PLAYER = 2,
+    SPRITE_ENEMY = 3,
+    SPRITE_GOLD = 4,
+    SPRITE_SOLID_BRICK = 5,
+    SPRITE_ROPE = 6,
+    SPRITE_COUNT
 };
 
-// --- Global Variables ---
-Entity player;
-Entity enemies[MAX_ENEMIES];
-int numEnemies = MAX_ENEMIES;
-TileType level[GRID_HEIGHT][GRID_WIDTH] = { EMPTY };
-std::map<std::pair<int, int>, DugHole> dugHoles; // Track dug holes
-
-bool gameOver = false;
-bool gameWon = false;
-bool levelComplete = false; // True when all gold is collected
+// --- Input State ---
 bool keyStates[256] = { false }; // For standard keys
 bool specialKeyStates[256] = { false }; // For special keys (arrows)
 
-int collectibles[GRID_HEIGHT][GRID_WIDTH] = { 0 }; // 1 if collectible exists
-int collectiblesCollected = 0;
-int totalCollectibles = 0;
-int score = 0;
-int lives = INITIAL_LIVES;
-
-float gameTime = 0.0f; // Simple timer for effects
+// --- Fixed-Step Simulation ---
+int simTickRate = DEFAULT_TICK_RATE; // Set with --tick-rate=N
+FrameClock frameClock;               // Real time owed to ticks; alpha interpolates drawing
+
+// --- Level Pack ---
+LevelPack levelPack;  // Mapped with --pack=FILE; closed (levelCount 0) for the built-in level
+int packLevel = 0;    // Level being played, set with --level=N and advanced after a win
+
+// --- Level Preloading ---
+// The session R starts next is built in the spare World on a background thread while the
+// current one is played (level, nav graph, flow field, entities), so a restart or level
+// change only swaps the world pointer. GL objects are created once and outlive sessions.
+World gameWorlds[2];          // The world being played and the spare
+std::thread preloadThread;    // Running initGame() on the spare, if joinable
+int preloadedLevel = -1;      // Level in the spare world, -1 if none
+unsigned int sessionSeeds = 0; // Added to the time so back-to-back sessions differ
+
+// --- Recording & Replay ---
+const int FAST_FORWARD_SPEED = 8; // Replay speed while F is held
+const char* recordPath = nullptr; // --record=FILE
+InputRecording recording;         // Inputs of the session being played, while recording
+bool recordingSaved = false;      // This session's recording has been written
+InputRecording replay;            // --replay=FILE, played in the first session
+ReplayCursor replayCursor;
+bool replaying = false;           // Input comes from `replay` rather than the keyboard
+
+// --- Network Session ---
+NetClient netClient;    // Connected with --connect=HOST:PORT
+bool networked = false; // Ticks go through netClient (prediction and rollback) instead of stepSimulation()
+
+// --- Profiling ---
+// P shows the overlay and starts the profiler; an export option starts it at launch and
+// keeps it running until the history is written on exit
+const int GPU_QUERY_FRAMES = 3;        // Frames of timer queries in flight before their results are read
+const int PROFILE_OVERLAY_FRAMES = 30; // Frames averaged for each overlay refresh
+const int PROFILE_OVERLAY_LINES = PROFILE_ZONE_COUNT + 3; // Frame, zones, GPU passes, counters
+const char* profileCsvPath = nullptr;   // --profile-csv=FILE
+const char* profileTracePath = nullptr; // --profile-trace=FILE
+bool profileOverlay = false;
+GLuint gpuQueries[GPU_QUERY_FRAMES][PROFILE_GPU_PASS_COUNT]; // GL_TIME_ELAPSED, by profiler frame % GPU_QUERY_FRAMES
+long gpuQueryFrame[GPU_QUERY_FRAMES]; // Frame each slot's queries measured, -1 if none pending
 
 // --- OpenGL Handles ---
-GLuint textures[7]; // 0: brick, 1: ladder, 2: player, 3: enemy, 4: collectible, 5: solid_brick, 6: rope
+const int SPRITE_TEXTURE_SIZE = 16; // Pixel size of one atlas layer
+GLuint spriteAtlas;                 // GL_TEXTURE_2D_ARRAY, one layer per SpriteId
+int spriteLayers[SPRITE_COUNT];     // SpriteId -> atlas layer lookup
+
+// --- Glyph Atlas ---
+// GLUT's bitmap font is rasterized once at startup into a GL_TEXTURE_2D_ARRAY
+// (one printable ASCII glyph per layer), so HUD text goes through the sprite batch.
+const int GLYPH_FIRST = 32; // ' '
+const int GLYPH_LAST = 126; // '~'
+const int GLYPH_COUNT = GLYPH_LAST - GLYPH_FIRST + 1;
+GLuint glyphAtlas;              // Layer = character - GLYPH_FIRST
+int glyphAdvance[GLYPH_COUNT];  // Horizontal advance per glyph (pixels)
+int glyphCellWidth = 0;         // Size of one layer (pixels)
+int glyphCellHeight = 0;
+int glyphDescent = 0;           // Baseline offset from the bottom of a cell
 GLuint vao;         // Vertex Array Object
 GLuint vboQuad;     // Vertex Buffer Object for a standard quad
-GLuint shaderProgram; // Simple shader for texturing
+
+// --- Shader Program Wrapper ---
+// Uniform locations are looked up once at link time instead of on every draw.
+struct ShaderProgram {
+    GLuint id;
+    GLint projectionLoc;
+    GLint textureSamplerLoc;
+    GLint timeLoc;
+};
+ShaderProgram spriteShader; // Instanced sprite/tile shader
+
+// --- Render State Tracker ---
+// Mirrors the GL bindings and uniform values we touch so redundant calls can be skipped.
+// Only valid while every change goes through the helpers below; call resetRenderState()
+// after anything else may have changed GL state (context setup, object recreation).
+struct RenderState {
+    GLuint program;
+    GLuint vao;
+    GLuint textureArray;     // GL_TEXTURE_2D_ARRAY on texture unit 0
+    GLuint arrayBuffer;      // GL_ARRAY_BUFFER
+    float projection[16];    // Last projection uploaded to spriteShader
+    bool projectionValid;
+    float time;              // Last time uniform uploaded to spriteShader
+    bool timeValid;
+    int skippedCalls;        // GL calls avoided this frame (reset by display())
+    int stateChanges;        // Binds and uniform uploads made this frame (likewise)
+    int drawCalls;           // Likewise
+};
+RenderState renderState;
+GLuint vboInstances; // Per-instance sprite data for the sprite batch
+GLuint vaoTiles;     // Quad + cached tile instances for the static tile layer
+GLuint vboTileInstances; // One instance slot per grid cell, in chunk order (see tileSlot())
+
+// --- Sprite Batch ---
+// One textured quad queued for instanced drawing.
+// Layout must match the instanced attribute pointers set up in initBuffers().
+struct SpriteInstance {
+    float x, y;          // Bottom-left corner (world units)
+    float width, height; // Size (world units)
+    float flip;          // -1 mirrors the quad horizontally, 1 draws it as-is
+    float layer;         // Layer in the bound texture array
+    float tint[4];       // RGBA colour multiplier
+    float fade[2];       // Dug-hole fade: refill time (gameTime), fade duration. Duration 0 = no fade
+};
+
+// Consecutive instances sharing one texture array, drawn with a single instanced call
+struct SpriteRun {
+    GLuint textureId; // GL_TEXTURE_2D_ARRAY
+    int first; // Index of the first instance in the batch
+    int count;
+};
+
+std::vector<SpriteInstance> spriteInstances; // Quads queued since the last flush
+std::vector<SpriteRun> spriteRuns;           // Texture runs over spriteInstances
+size_t instanceBufferCapacity = 0;           // Instances vboInstances can currently hold
+
+// --- Static Tile Layer Cache ---
+// The tile grid changes only on dig/refill/exit reveal, so its instances are kept on
+// the GPU and only cells flagged by markTileDirty() are rebuilt and re-uploaded.
+// Slots are grouped in CHUNK_SIZE x CHUNK_SIZE chunks, so a row of chunks is one contiguous
+// range and only the chunks in view are drawn. A chunk is built when it first comes into
+// view after a level change; until then its cells are not tracked at all.
+const int CHUNK_SIZE = 8; // Cells per side
+const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+const int CHUNKS_X = GRID_WIDTH / CHUNK_SIZE;
+const int CHUNKS_Y = GRID_HEIGHT / CHUNK_SIZE;
+static_assert(GRID_WIDTH % CHUNK_SIZE == 0 && GRID_HEIGHT % CHUNK_SIZE == 0, "The grid is a whole number of chunks");
+SpriteInstance tileInstances[GRID_HEIGHT * GRID_WIDTH]; // CPU mirror of vboTileInstances
+bool tileDirty[GRID_HEIGHT][GRID_WIDTH] = { false };   // Cell already queued in dirtyTiles
+std::vector<int> dirtyTiles;                             // Slots (see tileSlot()) to rebuild
+bool chunkLoaded[CHUNKS_Y][CHUNKS_X] = { false };        // Chunk's slots match the level
+
+// --- Camera ---
+// Bottom-left corner of the window in world pixels, following the player (see getViewOrigin())
+float cameraX = 0.0f;
+float cameraY = 0.0f;
 
 // --- Function Prototypes ---
 // Initialization
 void init();
 bool initGL();
 void loadTextures();
-void initLevel();
-void initEntities();
+void initGlyphAtlas();
 void initBuffers();
 void initShaders();
+GLuint compileShader(GLenum type, const char* source, const char* label);
+bool createShaderProgram(ShaderProgram& program, const char* vertexSource, const char* fragmentSource);
 void resetGame();
+void startLevel(int level);   // Swaps in the preloaded session for `level`, then preloads the one after
+int followingLevel();         // Level R will start from the current state
+World* spareWorld();
+unsigned int newSessionSeed();
+void startPreload(int level, unsigned int seed, int enemies); // Builds a session in the spare world on preloadThread
+void preloadMain(World* target, unsigned int seed);
+void waitForPreload();
+void saveSessionRecording(); // Writes the current session's inputs to recordPath
+void finishReplay();         // Reports whether the replay reproduced the recording and hands over to the keyboard
+void startNetSession();      // Builds the server's session in the spare world and plays it through netClient
+
+// Render State
+void resetRenderState();
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vertexArray);
+void bindTextureArray(GLuint texture);
+void bindArrayBuffer(GLuint buffer);
+void setProjectionUniform(const float matrix[16]);
+void setTimeUniform(float time);
 
 // Game Loop
 void display();
 void reshape(int w, int h);
 void update(int value); // GLUT timer callback
+uint8_t readInput(); // Current key state as an InputBit mask
+void scheduleFrame();   // Queues the next update() for the target frame rate
+double clockSeconds();  // Frame timer's clock
+void requestRedraw();   // Draws the next frame, waking the loop if it is idle
+void setSwapInterval(int interval);
+void windowStatus(int state); // GLUT window status callback
 
 // Input Handling
 void keyboardDown(unsigned char key, int x, int y);
 void keyboardUp(unsigned char key, int x, int y);
 void specialKeyDown(int key, int x, int y);
 void specialKeyUp(int key, int x, int y);
-void handleInput(float deltaTime); // Pass delta time
-
-// Updates
-void updatePlayer(float deltaTime);
-void updateEnemies(float deltaTime);
-void updatePhysics(Entity& entity, float deltaTime);
-void updateDigging(float deltaTime);
-void checkLevelCompletion();
-void revealExitLadder();
 
 // Drawing
 void drawGrid();
 void drawEntities();
+float interpolate(float previous, float current); // Blends tick states by frameClock.alpha
 void drawCollectibles();
 void drawHUD();
-void drawText(float x, float y, const std::string& text, float r = 1.0f, float g = 1.0f, float b = 1.0f);
+
+// Text (laid out into the sprite batch from the glyph atlas)
+// A label keeps its glyph quads between frames and is re-laid-out only when its values change.
+struct TextLabel {
+    std::vector<SpriteInstance> glyphs;
+    int values[2]; // Values the current layout was built from
+    bool valid;    // False until first laid out (or after the glyph atlas is rebuilt)
+};
+TextLabel scoreLabel, livesLabel, goldLabel, messageLabel;
+TextLabel profileLabels[PROFILE_OVERLAY_LINES]; // Re-laid-out together on every overlay refresh
+
+bool labelNeedsLayout(TextLabel& label, int value0, int value1 = 0);
+float measureText(const char* text);
+void layoutText(TextLabel& label, float x, float y, const char* text, float r, float g, float b);
+void drawLabel(const TextLabel& label);
 // Updated drawQuad to handle texture flipping better using model matrix
-void drawQuad(float x, float y, float width, float height, GLuint textureId, bool flipH = false);
-
-// Collision & Grid Interaction
-bool isColliding(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2);
-bool canMoveTo(float x, float y, float width, float height, bool onRope, bool isClimbing);
-TileType getTileAt(float x, float y);
-int getGridX(float x);
-int getGridY(float y);
-bool isOnGround(const Entity& entity);
-bool isOnLadder(const Entity& entity);
-bool checkOnRope(const Entity& entity); // Renamed to avoid conflict
-void digHole(int gridX, int gridY);
-void killEnemy(Entity& enemy); // Function to handle enemy death/respawn start
+void drawSprite(float x, float y, float width, float height, SpriteId sprite, bool flipH = false,
+    float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f);
+void drawQuad(float x, float y, float width, float height, GLuint textureArray, int layer, bool flipH = false,
+    float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f);
+void queueInstances(GLuint textureArray, const SpriteInstance* instances, int count);
+void flushSpriteBatch(); // Submits all queued quads, one instanced draw per texture run
+void setInstanceAttribOffset(int firstInstance);
+int tileSlot(int gridX, int gridY); // Index of a cell in tileInstances/vboTileInstances
+void markTileDirty(int gridX, int gridY);
+void markAllTilesDirty();
+void loadChunk(int chunkX, int chunkY); // Builds and uploads a whole chunk
+void onTileChanged(int gridX, int gridY); // TileChangeListener for the simulation
+void buildTileInstance(int gridX, int gridY, SpriteInstance& instance);
+void updateTileLayer(); // Loads chunks coming into view and re-uploads dirty cells
+void getVisibleChunks(int& chunkX0, int& chunkY0, int& chunkX1, int& chunkY1);
+void setCamera(float left, float bottom); // Orthographic projection for a window-sized view
+void startProfiling();
+void finishProfiling(); // Writes the exports asked for
+void readGpuQueries();  // Hands finished timer queries to the profiler, without waiting
+void beginGpuPass(ProfileGpuPass pass);
+void endGpuPass();
+void drawProfileOverlay();
 
 // Timer
 auto lastUpdateTime = std::chrono::high_resolution_clock::now();
 
 // --- Main Function ---
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
+    glutInit(&argc, argv); // Removes the GLUT options it recognises from argv
+    world = &gameWorlds[0]; // Stepped and drawn on the GLUT thread
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--tick-rate=", 0) == 0) {
+            int rate = atoi(arg.c_str() + 12);
+            if (rate >= 10 && rate <= 1000) simTickRate = rate;
+            else std::cerr << "Ignoring out-of-range tick rate: " << arg << std::endl;
+        }
+        else if (arg.rfind("--pack=", 0) == 0) {
+            if (!openLevelPack(argv[i] + 7, levelPack)) return 1;
+        }
+        else if (arg.rfind("--level=", 0) == 0) packLevel = atoi(arg.c_str() + 8);
+        else if (arg.rfind("--record=", 0) == 0) recordPath = argv[i] + 9;
+        else if (arg.rfind("--replay=", 0) == 0) {
+            if (!loadRecording(argv[i] + 9, replay)) return 1;
+            replaying = true;
+        }
+        else if (arg.rfind("--profile-csv=", 0) == 0) profileCsvPath = argv[i] + 14;
+        else if (arg.rfind("--profile-trace=", 0) == 0) profileTracePath = argv[i] + 16;
+        else if (arg.rfind("--swap-interval=", 0) == 0) {
+            int interval = atoi(arg.c_str() + 16);
+            if (interval >= 0 && interval <= 4) swapInterval = interval;
+            else std::cerr << "Ignoring out-of-range swap interval: " << arg << std::endl;
+        }
+        else if (arg.rfind("--fps=", 0) == 0) {
+            int rate = atoi(arg.c_str() + 6);
+            if (rate == 0 || (rate >= 10 && rate <= 1000)) targetFrameRate = rate;
+            else std::cerr << "Ignoring out-of-range frame rate: " << arg << std::endl;
+        }
+        else if (arg == "--always-redraw") renderOnChange = false;
+        else if (arg.rfind("--connect=", 0) == 0) {
+            std::string address = argv[i] + 10;
+            size_t colon = address.rfind(':');
+            std::string host = colon == std::string::npos ? address : address.substr(0, colon);
+            int port = colon == std::string::npos ? NET_DEFAULT_PORT : atoi(address.c_str() + colon + 1);
+            if (!connectNetClient(netClient, host.c_str(), port)) return 1;
+            networked = true;
+        }
+    }
+    if (networked) { // The server's settings win
+        if (replaying || recordPath) {
+            std::cerr << "--record and --replay are for local sessions, not --connect" << std::endl;
+            return 1;
+        }
+        simTickRate = netClient.session.tickRate;
+        if (netClient.session.level < 0) closeLevelPack(levelPack);
+        else if (levelPack.levelCount == 0) {
+            std::cerr << "The server plays level " << netClient.session.level << " of a pack; pass it with --pack" << std::endl;
+            return 1;
+        }
+        else packLevel = netClient.session.level;
+    }
+    if (replaying) { // The recording's settings win
+        simTickRate = replay.tickRate;
+        if (replay.level < 0) closeLevelPack(levelPack); // Recorded on the built-in level
+        else if (levelPack.levelCount == 0) {
+            std::cerr << "The recording was made on level " << replay.level << " of a pack; pass it with --pack" << std::endl;
+            return 1;
+        }
+        else packLevel = replay.level;
+    }
+    LevelView firstLevel;
+    if (levelPack.levelCount > 0 && !getPackLevel(levelPack, packLevel, firstLevel, nullptr)) {
+        std::cerr << "The pack has no level " << packLevel << std::endl;
+        return 1;
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
     glutInitWindowPosition(100, 100);
@@ -187,6 +420,12 @@ int main(int argc, char** argv) {
         std::cerr << "Error initializing OpenGL settings!" << std::endl;
         return 1;
     }
+    setSwapInterval(swapInterval);
+    startLogger();          // Event messages are written off the GLUT thread
+    atexit(stopLogger);     // Registered first so it runs last, after everything that logs
+    startJobSystem(-1);
+    atexit(stopJobSystem); // ESC leaves through exit(); the workers must be joined first
+    atexit(waitForPreload); // Likewise the preload thread (runs before stopJobSystem)
     init();
 
     glutDisplayFunc(display);
@@ -195,17 +434,24 @@ int main(int argc, char** argv) {
     glutKeyboardUpFunc(keyboardUp);
     glutSpecialFunc(specialKeyDown);
     glutSpecialUpFunc(specialKeyUp);
-    glutTimerFunc(16, update, 0); // Request first update approx 60fps
+    glutWindowStatusFunc(windowStatus);
 
     lastUpdateTime = std::chrono::high_resolution_clock::now(); // Initialize timer
+    restartCadence(frameCadence, clockSeconds());
+    scheduleFrame(); // First update
 
     glutMainLoop();
 
     // Cleanup (won't usually be reached with glutMainLoop)
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vboQuad);
-    glDeleteProgram(shaderProgram);
-    glDeleteTextures(7, textures); // Clean up all textures
+    glDeleteBuffers(1, &vboInstances);
+    glDeleteVertexArrays(1, &vaoTiles);
+    glDeleteBuffers(1, &vboTileInstances);
+    glDeleteProgram(spriteShader.id);
+    glDeleteTextures(1, &spriteAtlas); // Clean up the sprite atlas
+    glDeleteTextures(1, &glyphAtlas);
+    glDeleteQueries(GPU_QUERY_FRAMES * PROFILE_GPU_PASS_COUNT, &gpuQueries[0][0]);
 
     return 0;
 }
@@ -221,42 +467,52 @@ bool initGL() {
     return true;
 }
 
+// Creates the GL objects (once for the whole run) and starts the first session
 void init() {
     srand(static_cast<unsigned int>(time(0)));
+    resetRenderState(); // Nothing is bound yet
     initShaders();
     initBuffers();
     loadTextures(); // Load textures after GL context is ready
-    initLevel();
-    initEntities();
-
-    // Reset game state
-    score = 0;
-    lives = INITIAL_LIVES;
-    collectiblesCollected = 0;
-    gameOver = false;
-    gameWon = false;
-    levelComplete = false;
-    dugHoles.clear();
-    gameTime = 0.0f;
-    lastUpdateTime = std::chrono::high_resolution_clock::now(); // Reset timer
+    initGlyphAtlas();
+    glGenQueries(GPU_QUERY_FRAMES * PROFILE_GPU_PASS_COUNT, &gpuQueries[0][0]);
+    if (profileCsvPath || profileTracePath) startProfiling();
+    if (replaying) startPreload(packLevel, replay.seed, replay.enemies);
+    if (networked) startNetSession();
+    else startLevel(packLevel);
 }
 
 void initShaders() {
-    // Simple Vertex Shader (Pass-through position and UVs, includes Model matrix)
+    // Instanced Vertex Shader (per-vertex quad corner + per-instance placement)
     const char* vertexShaderSource = R"(
         #version 330 core
-        layout(location = 0) in vec2 aPos;      // Vertex position (x, y) in model space (-0.5 to 0.5)
-        layout(location = 1) in vec2 aTexCoord; // Texture coordinate (u, v)
+        layout(location = 0) in vec2 aPos;       // Vertex position (x, y) in model space (-0.5 to 0.5)
+        layout(location = 1) in vec2 aTexCoord;  // Texture coordinate (u, v)
+        layout(location = 2) in vec4 aRect;      // Per instance: bottom-left (x, y), width, height
+        layout(location = 3) in vec2 aFlipLayer; // Per instance: horizontal flip (+-1), atlas layer
+        layout(location = 4) in vec4 aTint;      // Per instance: RGBA tint
+        layout(location = 5) in vec2 aFade;      // Per instance: refill time, fade duration (0 = none)
 
         out vec2 TexCoord;
+        flat out float Layer;
+        out vec4 Tint;
 
         uniform mat4 projection; // Orthographic projection matrix
-        uniform mat4 model;      // Model matrix for position, scale, rotation/flip
+        uniform float time;      // gameTime, drives dug-hole fades without re-uploading tiles
 
         void main() {
-            // Transform vertex position: Model -> World -> Clip Space
-            gl_Position = projection * model * vec4(aPos.x, aPos.y, 0.0, 1.0);
+            // Scale the unit quad (flipping X if requested), then move its center into place
+            vec2 center = aRect.xy + aRect.zw * 0.5;
+            vec2 worldPos = center + vec2(aPos.x * aRect.z * aFlipLayer.x, aPos.y * aRect.w);
+            gl_Position = projection * vec4(worldPos, 0.0, 1.0);
             TexCoord = aTexCoord;
+            Layer = aFlipLayer.y;
+            Tint = aTint;
+            if (aFade.y > 0.0) {
+                // 1 = just dug, 0 = about to refill; fade from darker to slightly less dark
+                float progress = clamp((aFade.x - time) / aFade.y, 0.0, 1.0);
+                Tint.rgb *= 0.2 + 0.3 * progress;
+            }
         }
     )";
 
@@ -264,50 +520,92 @@ void initShaders() {
     const char* fragmentShaderSource = R"(
         #version 330 core
         in vec2 TexCoord;
+        flat in float Layer;
+        in vec4 Tint;
         out vec4 FragColor;
 
-        uniform sampler2D textureSampler;
-        uniform vec4 tintColor = vec4(1.0, 1.0, 1.0, 1.0); // Default tint is white
+        uniform sampler2DArray textureSampler;
 
         void main() {
-            vec4 texColor = texture(textureSampler, TexCoord);
+            vec4 texColor = texture(textureSampler, vec3(TexCoord, Layer));
             // Discard fragment if alpha is very low (basic transparency)
             if (texColor.a < 0.1) discard;
-            FragColor = texColor * tintColor; // Apply tint
+            FragColor = texColor * Tint; // Apply per-sprite tint
         }
     )";
 
-    // --- Compile and Link Shaders ---
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // Add error checking here (glGetShaderiv, glGetShaderInfoLog)
+    if (createShaderProgram(spriteShader, vertexShaderSource, fragmentShaderSource)) {
+        std::cout << "Shaders compiled and linked successfully." << std::endl;
+    }
+
+    // The sampler always reads texture unit 0; set it once instead of every frame
+    useProgram(spriteShader.id);
+    glUniform1i(spriteShader.textureSamplerLoc, 0);
+}
+
+// Compiles one shader stage, printing the driver's info log on failure.
+// Returns 0 if compilation failed.
+GLuint compileShader(GLenum type, const char* source, const char* label) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    // Add error checking here
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::string infoLog(logLength > 1 ? logLength : 1, '\0');
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(infoLog.size()), NULL, &infoLog[0]);
+        std::cerr << "ERROR::SHADER::" << label << "::COMPILATION_FAILED\n" << infoLog.c_str() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Compiles and links a program and caches its uniform locations.
+// On failure the error is reported and program.id is left as 0.
+bool createShaderProgram(ShaderProgram& program, const char* vertexSource, const char* fragmentSource) {
+    program.id = 0;
+    program.projectionLoc = -1;
+    program.textureSamplerLoc = -1;
+    program.timeLoc = -1;
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader); // Deleting 0 is a no-op
+        glDeleteShader(fragmentShader);
+        return false;
+    }
 
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    // Add error checking here (glGetProgramiv, glGetProgramInfoLog)
+    GLuint id = glCreateProgram();
+    glAttachShader(id, vertexShader);
+    glAttachShader(id, fragmentShader);
+    glLinkProgram(id);
 
+    // Shaders are no longer needed once linked (or failed to link)
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    // Check for shader compilation/linking errors (basic example)
     GLint success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
     if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    else {
-        std::cout << "Shaders compiled and linked successfully." << std::endl;
+        GLint logLength = 0;
+        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &logLength);
+        std::string infoLog(logLength > 1 ? logLength : 1, '\0');
+        glGetProgramInfoLog(id, static_cast<GLsizei>(infoLog.size()), NULL, &infoLog[0]);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog.c_str() << std::endl;
+        glDeleteProgram(id);
+        return false;
     }
+
+    program.id = id;
+    program.projectionLoc = glGetUniformLocation(id, "projection");
+    program.textureSamplerLoc = glGetUniformLocation(id, "textureSampler");
+    program.timeLoc = glGetUniformLocation(id, "time");
+    return true;
 }
 
 
@@ -327,10 +625,10 @@ void initBuffers() {
 
 
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    bindVertexArray(vao);
 
     glGenBuffers(1, &vboQuad);
-    glBindBuffer(GL_ARRAY_BUFFER, vboQuad);
+    bindArrayBuffer(vboQuad);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
 
     // Position attribute (location = 0 in shader)
@@ -340,20 +638,52 @@ void initBuffers() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // Unbind VBO
-    glBindVertexArray(0);             // Unbind VAO
+    // Per-instance sprite data (locations 2-5), advanced once per instance.
+    // Storage is allocated lazily by flushSpriteBatch() as the batch grows.
+    glGenBuffers(1, &vboInstances);
+    bindArrayBuffer(vboInstances);
+    instanceBufferCapacity = 0;
+    setInstanceAttribOffset(0);
+    for (GLuint loc = 2; loc <= 5; ++loc) {
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+
+    // Static tile layer: same quad, but instances come from a persistent per-cell buffer
+    glGenVertexArrays(1, &vaoTiles);
+    bindVertexArray(vaoTiles);
+    bindArrayBuffer(vboQuad);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glGenBuffers(1, &vboTileInstances);
+    bindArrayBuffer(vboTileInstances);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(tileInstances), NULL, GL_DYNAMIC_DRAW);
+    setInstanceAttribOffset(0);
+    for (GLuint loc = 2; loc <= 5; ++loc) {
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+    markAllTilesDirty(); // Fresh buffer has no contents yet
+
+    bindArrayBuffer(0);  // Unbind VBO
+    bindVertexArray(0);  // Unbind VAO
 }
 
 
 void loadTextures() {
-    const int texSize = 16; // Smaller texture size for more retro pixelated look
+    const int texSize = SPRITE_TEXTURE_SIZE; // Smaller texture size for more retro pixelated look
     unsigned char texData[texSize][texSize][4]; // RGBA
 
-    // Texture IDs: 0: brick, 1: ladder, 2: player, 3: enemy, 4: collectible, 5: solid_brick, 6: rope
-    glGenTextures(7, textures);
+    // Allocate every layer of the atlas up front, then fill one sprite per layer
+    glGenTextures(1, &spriteAtlas);
+    bindTextureArray(spriteAtlas);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, texSize, texSize, SPRITE_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-    for (int i = 0; i < 7; i++) {
-        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        spriteLayers[i] = i; // One layer per sprite for now; frames can map to extra layers later
         memset(texData, 0, sizeof(texData)); // Clear to transparent black
 
         // Procedurally generate simple pixel art
@@ -362,7 +692,7 @@ void loadTextures() {
                 texData[y][x][3] = 0; // Default alpha = 0 (transparent)
 
                 switch (i) {
-                case 0: // Brick (Simple Red Brick)
+                case SPRITE_BRICK: // Brick (Simple Red Brick)
                     if (x > 0 && x < texSize - 1 && y > 0 && y < texSize - 1) { // Inner part
                         texData[y][x][0] = 180; texData[y][x][1] = 50; texData[y][x][2] = 30; // Reddish brown
                         texData[y][x][3] = 255;
@@ -374,13 +704,13 @@ void loadTextures() {
                         texData[y][x][3] = 255;
                     }
                     break;
-                case 1: // Ladder (Gray Vertical Lines)
+                case SPRITE_LADDER: // Ladder (Gray Vertical Lines)
                     if (x == 1 || x == texSize - 2 || (y % (texSize / 3) == 0 && y > 0 && y < texSize - 1)) { // Poles and rungs
                         texData[y][x][0] = 150; texData[y][x][1] = 150; texData[y][x][2] = 150; // Gray
                         texData[y][x][3] = 255;
                     }
                     break;
-                case 2: // Player (Magenta/Cyan - classic look)
+                case SPRITE_PLAYER: // Player (Magenta/Cyan - classic look)
                     // Simple blocky shape matching image
                     if (y >= texSize * 0.6f) { // Head (Blue Helmet)
                         texData[y][x][0] = 0; texData[y][x][1] = 0; texData[y][x][2] = 200;
@@ -406,7 +736,7 @@ void loadTextures() {
                     }
 
                     break;
-                case 3: // Enemy (White/Cyan - classic look)
+                case SPRITE_ENEMY: // Enemy (White/Cyan - classic look)
                     // Simple blocky shape matching image
                     if (y >= texSize * 0.6f) { // Head (Cyan Helmet)
                         texData[y][x][0] = 0; texData[y][x][1] = 200; texData[y][x][2] = 200; // Cyan
@@ -426,7 +756,7 @@ void loadTextures() {
                         texData[y][x][3] = 255;
                     }
                     break;
-                case 4: // Collectible (Gold Nugget - Yellow/White Shine)
+                case SPRITE_GOLD: // Collectible (Gold Nugget - Yellow/White Shine)
                 {
                     int centerX = texSize / 2;
                     int centerY = texSize / 2;
@@ -442,7 +772,7 @@ void loadTextures() {
                     }
                 }
                 break;
-                case 5: // Solid Brick (Gray, simple)
+                case SPRITE_SOLID_BRICK: // Solid Brick (Gray, simple)
                     texData[y][x][0] = 100; texData[y][x][1] = 100; texData[y][x][2] = 100; // Medium Gray
                     texData[y][x][3] = 255;
                     // Add simple border
@@ -450,7 +780,7 @@ void loadTextures() {
                         texData[y][x][0] = 60; texData[y][x][1] = 60; texData[y][x][2] = 60; // Darker Gray
                     }
                     break;
-                case 6: // Rope (Horizontal Yellow/Orange Bar)
+                case SPRITE_ROPE: // Rope (Horizontal Yellow/Orange Bar)
                     if (y >= texSize / 2 - 1 && y <= texSize / 2 + 1) { // Middle 3 pixels vertically
                         texData[y][x][0] = 255; // Red
                         texData[y][x][1] = (x % 4 < 2) ? 165 : 255; // Alternating Orange/Yellow segments
@@ -462,201 +792,314 @@ void loadTextures() {
             }
         }
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texSize, texSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Repeat might be better for some textures
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Pixelated look
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, spriteLayers[i], texSize, texSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, texData);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT); // Repeat might be better for some textures
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Pixelated look
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     std::cout << "Textures loaded." << std::endl;
 }
 
 
-void initLevel() {
-    totalCollectibles = 0;
-    levelComplete = false; // Reset level completion flag
-    for (int y = 0; y < GRID_HEIGHT; ++y) {
-        for (int x = 0; x < GRID_WIDTH; ++x) {
-            level[y][x] = EMPTY;
-            collectibles[y][x] = 0;
-        }
+// Rasterizes GLUT_BITMAP_HELVETICA_18 into glyphAtlas, one glyph per layer.
+// Uses the fixed-function bitmap path into an offscreen framebuffer once at startup;
+// nothing legacy runs per frame afterwards.
+void initGlyphAtlas() {
+    void* font = GLUT_BITMAP_HELVETICA_18;
+
+    glyphCellWidth = 1;
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+        glyphAdvance[i] = glutBitmapWidth(font, GLYPH_FIRST + i);
+        if (glyphAdvance[i] > glyphCellWidth) glyphCellWidth = glyphAdvance[i];
+    }
+    glyphCellHeight = glutBitmapHeight(font);
+    if (glyphCellHeight <= 0) glyphCellHeight = 22; // Helvetica 18 line height
+    glyphDescent = glyphCellHeight / 4;              // Room for descenders (g, j, p, q, y)
+
+    glGenTextures(1, &glyphAtlas);
+    bindTextureArray(glyphAtlas);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, glyphCellWidth, glyphCellHeight, GLYPH_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Keep bitmap edges crisp
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // --- Offscreen target one cell in size ---
+    GLuint bakeTexture, bakeFramebuffer;
+    glGenTextures(1, &bakeTexture);
+    glBindTexture(GL_TEXTURE_2D, bakeTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, glyphCellWidth, glyphCellHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &bakeFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, bakeFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bakeTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Glyph atlas framebuffer incomplete; HUD text will be blank." << std::endl;
     }
 
-    // Define a Lode Runner-style level
-    // S = Solid, B = Brick, L = Ladder, R = Rope, C = Gold (on Brick), E = Empty, P = Player Start, X = Enemy Start
-    // Note: Y=0 is the BOTTOM row
-    const char* levelLayout[] = {
-       "SSSSSSSSSSSSSSSSSSSS", // 14 - Top boundary (Solid) - Exit area
-       "SEEEEEEEEEEEEEEEEEES", // 13 - Potential Exit Ladder spots
-       "SCBBCBBLBBBBBLBBCBCS", // 12
-       "SLRRRRRLRRRRRLRRRRRS", // 11
-       "SL C C L C C L C C LS", // 10
-       "SCBBLBBBLELBBBBLBBBS", // 9
-       "SRRRRR C L C C RRCRRS", // 8
-       "SE E E B L B E E E ES", // 7
-       "SBBBEBBBLBLBBBBBBBBS", // 6
-       "SC RRRR L L RRRRR CS", // 5
-       "SE E E B L B E E E ES", // 4
-       "SBCBEBBBLBLBBBEBBEBS", // 3 - Player start area
-       "SXXXXXXELPBLXXXXXXBS", // 2 - Enemy start area, Player start 'P'
-       "SEEEEE B B B EEEEEES", // 1
-       "SSSSSSSSSSSSSSSSSSSS"  // 0 - Ground (Solid)
-    };
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glViewport(0, 0, glyphCellWidth, glyphCellHeight);
+    useProgram(0); // Bitmaps are rasterized by the fixed-function path
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f); // Transparent background, coverage ends up in alpha
+
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        glColor4f(1.0f, 1.0f, 1.0f, 1.0f); // White glyph, tinted per instance when drawn
+        glWindowPos2i(0, glyphDescent);    // Baseline (also latches the raster colour)
+        glutBitmapCharacter(font, GLYPH_FIRST + i);
+        glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, 0, 0, glyphCellWidth, glyphCellHeight);
+    }
+
+    // --- Restore state changed for baking ---
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &bakeFramebuffer);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &bakeTexture);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Black background like NES
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+
+    // Any existing layouts refer to the old atlas
+    scoreLabel.valid = false;
+    livesLabel.valid = false;
+    goldLabel.valid = false;
+    messageLabel.valid = false;
+    for (TextLabel& label : profileLabels) label.valid = false;
+    std::cout << "Glyph atlas baked (" << GLYPH_COUNT << " glyphs)." << std::endl;
+}
 
 
-    int layoutHeight = sizeof(levelLayout) / sizeof(levelLayout[0]);
-    int playerStartX = 1, playerStartY = 3; // Default player start if 'P' not found
-    std::vector<std::pair<int, int>> enemyStartPositions;
-
-    for (int y = 0; y < GRID_HEIGHT; ++y) {
-        int layoutY = layoutHeight - 1 - y; // Read layout from bottom up
-        if (layoutY < 0 || layoutY >= layoutHeight) continue;
-
-        std::string row = levelLayout[layoutY];
-        for (int x = 0; x < GRID_WIDTH; ++x) {
-            if (x >= row.length()) continue;
-
-            char tileChar = row[x];
-            switch (tileChar) {
-            case 'S': level[y][x] = SOLID_BRICK; break;
-            case 'B': level[y][x] = BRICK; break;
-            case 'L': level[y][x] = LADDER; break;
-            case 'R': level[y][x] = ROPE; break;
-            case 'C':
-                level[y][x] = BRICK; // Place gold ON a brick
-                if (y + 1 < GRID_HEIGHT) { // Ensure space above for the visual
-                    collectibles[y + 1][x] = 1; // Place collectible visual *above* the brick
-                    totalCollectibles++;
-                }
-                else { // If gold is on the top row of bricks, place it there
-                    collectibles[y][x] = 1;
-                    totalCollectibles++;
-                }
-                break;
-            case 'P': // Explicit Player start
-                playerStartX = x;
-                playerStartY = y;
-                level[y][x] = EMPTY; // Start position should be empty
-                break;
-            case 'X': // Enemy start position marker
-                enemyStartPositions.push_back({ x, y });
-                level[y][x] = EMPTY; // Keep the space empty
-                break;
-            case 'E': // Fallthrough intentional
-            default:  level[y][x] = EMPTY; break;
-            }
-        }
+void resetGame() {
+    LOG_INFO("Resetting game...");
+    if (networked) { // R after a networked game starts a local one
+        stopNetClient(netClient);
+        networked = false;
     }
-    std::cout << "Level initialized. Total Collectibles: " << totalCollectibles << std::endl;
-
-    // Store player start position (used in initEntities)
-    player.startGridX = playerStartX;
-    player.startGridY = playerStartY;
-
-    // Store enemy start positions (used in initEntities)
-    // Assign starting positions to enemies, cycling through markers if needed
-    for (int i = 0; i < numEnemies; ++i) {
-        if (!enemyStartPositions.empty()) {
-            enemies[i].startGridX = enemyStartPositions[i % enemyStartPositions.size()].first;
-            enemies[i].startGridY = enemyStartPositions[i % enemyStartPositions.size()].second;
-        }
-        else {
-            // Fallback if no 'X' markers
-            enemies[i].startGridX = GRID_WIDTH - 2 - i;
-            enemies[i].startGridY = 2;
-            std::cerr << "Warning: No 'X' markers found for enemy start positions. Using fallback." << std::endl;
-        }
+    startLevel(followingLevel());
+}
+
+void startLevel(int level) {
+    if (preloadedLevel != level) startPreload(level, newSessionSeed(), DEFAULT_ENEMIES); // Nothing usable prepared (first start)
+    waitForPreload(); // Usually long finished
+
+    world = spareWorld();
+    preloadedLevel = -1;
+    packLevel = level;
+    setTileChangeListener(onTileChanged);
+    markAllTilesDirty(); // The new level's chunks load as they come into view
+    if (levelPack.levelCount > 0) {
+        LevelView view;
+        std::string name;
+        getPackLevel(levelPack, level, view, &name);
+        LOG_INFO("Level %d/%d: %s", level + 1, levelPack.levelCount, name.c_str());
+    }
+    if (replaying && worldChecksum() != replay.startChecksum) {
+        LOG_WARNING("Replay: the level or settings differ from the recording's");
+    }
+    if (recordPath) {
+        beginRecording(recording, simTickRate, levelPack.levelCount > 0 ? level : -1);
+        recordingSaved = false;
     }
+
+    frameClock = FrameClock();
+    lastUpdateTime = std::chrono::high_resolution_clock::now(); // Reset timer
+
+    // Guess a win; update() re-targets the preload if the session ends otherwise
+    startPreload(levelPack.levelCount > 1 ? (level + 1) % levelPack.levelCount : level, newSessionSeed(), DEFAULT_ENEMIES);
 }
 
-void initEntities() {
-
-    // Place player at start position defined in level or default
-    player.x = player.startGridX * TILE_SIZE + (TILE_SIZE * 0.1f); // Position bottom-left
-    player.y = player.startGridY * TILE_SIZE;
-    player.vx = 0.0f;
-    player.vy = 0.0f;
-    player.isJumping = false; // Removed
-    player.isClimbing = false;
-    player.isOnRope = false;
-    player.isFalling = false;
-    player.faceRight = true;
-    player.isTrapped = false;
-    player.trappedTimer = 0.0f;
-    player.isAlive = true; // Player is always "alive" in this context
-    player.respawnTimer = 0.0f;
-
-
-    // Initialize enemies at their designated start positions
-    for (int i = 0; i < numEnemies; ++i) {
-        enemies[i].x = enemies[i].startGridX * TILE_SIZE + (TILE_SIZE * 0.1f);
-        enemies[i].y = enemies[i].startGridY * TILE_SIZE;
-        enemies[i].vx = (rand() % 2 == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // Random initial horizontal velocity
-        enemies[i].vy = 0.0f;
-        enemies[i].isClimbing = false;
-        enemies[i].isOnRope = false;
-        enemies[i].isFalling = false;
-        enemies[i].faceRight = (enemies[i].vx > 0);
-        enemies[i].isTrapped = false;
-        enemies[i].trappedTimer = 0.0f;
-        enemies[i].isAlive = true;
-        enemies[i].respawnTimer = 0.0f;
+int followingLevel() {
+    if (world->gameWon && levelPack.levelCount > 1) return (packLevel + 1) % levelPack.levelCount;
+    return packLevel;
+}
+
+World* spareWorld() {
+    return world == &gameWorlds[0] ? &gameWorlds[1] : &gameWorlds[0];
+}
+
+unsigned int newSessionSeed() {
+    return static_cast<unsigned int>(time(0)) + sessionSeeds++;
+}
+
+// The spare world is only touched by preloadThread until waitForPreload() returns
+void startPreload(int level, unsigned int seed, int enemies) {
+    waitForPreload();
+    World* target = spareWorld();
+    target->tileChangeListener = nullptr; // Rendering hooks in when the world is swapped in
+    target->numEnemies = enemies;
+    target->levelSource = LevelView(); // Built-in level
+    if (levelPack.levelCount > 0) getPackLevel(levelPack, level, target->levelSource, nullptr);
+    preloadedLevel = level;
+    preloadThread = std::thread(preloadMain, target, seed);
+}
+
+void preloadMain(World* target, unsigned int seed) {
+    world = target; // This thread's current world
+    initGame(seed); // Level, entities and game state; seeds the world's generator
+}
+
+void waitForPreload() {
+    if (preloadThread.joinable()) preloadThread.join();
+}
+
+// Built on this thread rather than preloaded: the server is already waiting
+void startNetSession() {
+    waitForPreload();
+    world = spareWorld();
+    preloadedLevel = -1;
+    world->numEnemies = netClient.session.enemies;
+    world->levelSource = LevelView(); // Built-in level
+    if (levelPack.levelCount > 0) getPackLevel(levelPack, packLevel, world->levelSource, nullptr);
+    setTileChangeListener(onTileChanged);
+    initGame(netClient.session.seed);
+    markAllTilesDirty();
+    if (!startNetClient(netClient)) {
+        std::cerr << "Playing locally instead" << std::endl;
+        stopNetClient(netClient);
+        networked = false;
     }
-    std::cout << "Entities initialized." << std::endl;
+    else std::cout << "Connected: playing the server's session" << std::endl;
+
+    frameClock = FrameClock();
+    lastUpdateTime = std::chrono::high_resolution_clock::now();
 }
 
+void saveSessionRecording() {
+    if (!recordPath || recordingSaved) return;
+    endRecording(recording);
+    if (saveRecording(recordPath, recording)) {
+        LOG_INFO("Recorded %ld ticks to %s", static_cast<long>(recording.ticks), recordPath);
+    }
+    recordingSaved = true;
+}
 
-void resetGame() {
-    std::cout << "Resetting game..." << std::endl;
-    init(); // Re-initialize everything
+void finishReplay() {
+    replaying = false;
+    LOG_INFO("Replay %s the recorded session (%ld ticks); the keyboard has control",
+        worldChecksum() == replay.endChecksum ? "reproduced" : "DIVERGED from", static_cast<long>(replay.ticks));
+}
+
+// --- Profiling ---
+
+void startProfiling() {
+    for (long& frame : gpuQueryFrame) frame = -1; // Frame numbers start again at 0
+    startProfiler();
+}
+
+void finishProfiling() {
+    if (!profilerRunning()) return;
+    stopProfiler();
+    if (profileCsvPath && writeProfileCsv(profileCsvPath)) std::cout << "Profile written to " << profileCsvPath << std::endl;
+    if (profileTracePath && writeProfileTrace(profileTracePath)) std::cout << "Trace written to " << profileTracePath << std::endl;
+}
+
+// Reads the slot this frame's queries are about to reuse, GPU_QUERY_FRAMES frames after it
+// was issued. A result that is still not available is dropped rather than waited for.
+void readGpuQueries() {
+    if (!profilerRunning()) return;
+    int slot = static_cast<int>(currentProfileFrame() % GPU_QUERY_FRAMES);
+    if (gpuQueryFrame[slot] < 0) return;
+    for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) {
+        GLint available = 0;
+        glGetQueryObjectiv(gpuQueries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(gpuQueries[slot][pass], GL_QUERY_RESULT, &nanoseconds);
+        setProfileGpuTime(gpuQueryFrame[slot], static_cast<ProfileGpuPass>(pass), nanoseconds / 1000.0);
+    }
+    gpuQueryFrame[slot] = -1;
+}
+
+// Time-elapsed queries cannot nest, so passes are measured one after another
+void beginGpuPass(ProfileGpuPass pass) {
+    if (!profilerRunning()) return;
+    glBeginQuery(GL_TIME_ELAPSED, gpuQueries[currentProfileFrame() % GPU_QUERY_FRAMES][pass]);
+}
+
+void endGpuPass() {
+    if (profilerRunning()) glEndQuery(GL_TIME_ELAPSED);
 }
 
 // --- Game Loop Functions ---
 
 void display() {
+    redrawRequested = false;
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(shaderProgram);
-
-    // --- Set up orthographic projection matrix ---
-    // Maps world coordinates (0,0 to WINDOW_WIDTH, WINDOW_HEIGHT) to NDC (-1,1 to 1,1)
-    float left = 0.0f;
-    float right = static_cast<float>(WINDOW_WIDTH);
-    float bottom = 0.0f;
-    float top = static_cast<float>(WINDOW_HEIGHT);
-    // Create Ortho matrix (Column-major order for OpenGL)
-    float projectionMatrix[16] = {
-        2.0f / (right - left), 0.0f, 0.0f, 0.0f,
-        0.0f, 2.0f / (top - bottom), 0.0f, 0.0f,
-        0.0f, 0.0f, -1.0f, 0.0f, // Simplified Z for 2D (maps z=0 to z=0 in NDC)
-        -(right + left) / (right - left), -(top + bottom) / (top - bottom), 0.0f, 1.0f
-    };
-    GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, projectionMatrix);
+    renderState.skippedCalls = 0;
+    renderState.stateChanges = 0;
+    renderState.drawCalls = 0;
+    readGpuQueries();
+    useProgram(spriteShader.id);
+
+    // --- Follow the player ---
+    // Whole pixels, so tile edges don't shimmer while scrolling
+    float viewX, viewY;
+    getViewOrigin(interpolate(world->entities.prevX[PLAYER], world->entities.x[PLAYER]) + TILE_SIZE * 0.4f,
+        interpolate(world->entities.prevY[PLAYER], world->entities.y[PLAYER]) + TILE_SIZE * 0.475f, viewX, viewY);
+    cameraX = floorf(viewX + 0.5f);
+    cameraY = floorf(viewY + 0.5f);
+    setCamera(cameraX, cameraY); // Skipped when unchanged since last frame
 
     // --- Bind the VAO (contains quad vertex data and attribute pointers) ---
-    glBindVertexArray(vao);
+    bindVertexArray(vao);
 
     // --- Draw Game Elements ---
-    // Reset tint before drawing each category
-    GLint tintLoc = glGetUniformLocation(shaderProgram, "tintColor");
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // White, Opaque
-    drawGrid();
+    // Each layer queues its quads into the sprite batch and is then submitted
+    // with one instanced draw per texture, keeping the layers in order.
+    // Time between ticks keeps hole fades and gold bobbing smooth on fast displays
+    setTimeUniform(world->gameTime + frameClock.alpha / static_cast<float>(simTickRate));
+
+    beginGpuPass(PROFILE_GPU_TILES);
+    drawGrid(); // Cached tile layer, drawn directly from its own instance buffer
+    endGpuPass();
 
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f);
+    beginGpuPass(PROFILE_GPU_SPRITES);
     drawCollectibles();
+    flushSpriteBatch();
 
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f);
     drawEntities(); // Draws player and living enemies
+    flushSpriteBatch();
+    endGpuPass();
 
-    // --- Unbind VAO ---
-    glBindVertexArray(0);
-
-    // --- Draw HUD (using GLUT's bitmap fonts - doesn't use the shader) ---
-    glUseProgram(0); // Stop using the custom shader
+    // --- Draw HUD (glyph atlas through the same sprite batch) ---
+    beginGpuPass(PROFILE_GPU_HUD);
+    glDisable(GL_DEPTH_TEST); // Draw HUD on top
+    setCamera(0.0f, 0.0f);    // Window coordinates, whatever the camera
     drawHUD();
+    if (profileOverlay) drawProfileOverlay();
+    flushSpriteBatch();
+    glEnable(GL_DEPTH_TEST);
+    endGpuPass();
 
     glutSwapBuffers();
+
+    // The frame ends at the swap; its ticks ran in the update() before it
+    if (profilerRunning()) {
+        gpuQueryFrame[currentProfileFrame() % GPU_QUERY_FRAMES] = currentProfileFrame();
+        addProfileCount(PROFILE_DRAW_CALLS, renderState.drawCalls);
+        addProfileCount(PROFILE_STATE_CHANGES, renderState.stateChanges);
+        addProfileCount(PROFILE_SKIPPED_CALLS, renderState.skippedCalls);
+        nextProfileFrame();
+    }
+}
+
+
+// Maps world coordinates (left, bottom) to (left + WINDOW_WIDTH, bottom + WINDOW_HEIGHT) to NDC (-1, -1 to 1, 1)
+void setCamera(float left, float bottom) {
+    float right = left + static_cast<float>(WINDOW_WIDTH);
+    float top = bottom + static_cast<float>(WINDOW_HEIGHT);
+    // Create Ortho matrix (Column-major order for OpenGL)
+    float projectionMatrix[16] = {
+        2.0f / (right - left), 0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f / (top - bottom), 0.0f, 0.0f,
+        0.0f, 0.0f, -1.0f, 0.0f, // Simplified Z for 2D (maps z=0 to z=0 in NDC)
+        -(right + left) / (right - left), -(top + bottom) / (top - bottom), 0.0f, 1.0f
+    };
+    setProjectionUniform(projectionMatrix);
 }
 
 
@@ -665,49 +1108,126 @@ void reshape(int w, int h) {
     glViewport(0, 0, w, h);
     // Projection matrix is set in display() based on fixed WINDOW_WIDTH/HEIGHT
     // So reshape only needs to set the viewport.
+    requestRedraw();
 }
 
+void windowStatus(int state) {
+    bool visible = state != GLUT_HIDDEN && state != GLUT_FULLY_COVERED;
+    if (visible && !windowVisible) requestRedraw(); // Whatever was drawn meanwhile was skipped
+    windowVisible = visible;
+}
+
+// Drives the fixed-step simulation from real time. Whatever the timer or display rate,
+// the game advances in ticks of exactly 1 / simTickRate seconds; a slow frame runs
+// several ticks to catch up (never a single large step), and the leftover fraction is
+// used to interpolate drawing between the last two tick states.
 void update(int value) {
-    // Calculate delta time
+    // Calculate real time since the last frame
     auto currentTime = std::chrono::high_resolution_clock::now();
-    float deltaTime = std::chrono::duration<float>(currentTime - lastUpdateTime).count();
+    float frameTime = std::chrono::duration<float>(currentTime - lastUpdateTime).count();
     lastUpdateTime = currentTime;
 
-    // Clamp delta time to avoid large jumps if debugging or paused
-    const float maxDeltaTime = 0.1f; // Max time step of 100ms
-    if (deltaTime > maxDeltaTime) deltaTime = maxDeltaTime;
-
-    gameTime += deltaTime; // Increment game time
-
-    if (!gameOver && !gameWon) {
-        handleInput(deltaTime);
-        updatePlayer(deltaTime);
-        updateEnemies(deltaTime);
-        updateDigging(deltaTime);
-        checkLevelCompletion(); // Check if all gold is collected
+    int speed = (replaying && keyStates['f']) ? FAST_FORWARD_SPEED : 1;
+    const float tickTime = 1.0f / static_cast<float>(simTickRate);
+    int ticks = takeFrameTicks(frameClock, frameTime, tickTime, speed); // Often none (see pacing.h)
+    for (int tick = 0; tick < ticks; ++tick) {
+        uint8_t input = 0;
+        if (replaying && !nextReplayInput(replay, replayCursor, input)) finishReplay();
+        bool fromKeyboard = !replaying;
+        if (fromKeyboard) input = readInput();
+        bool running = !world->gameOver && !world->gameWon;
+        if (running && recordPath) recordInput(recording, input); // Exactly what the tick is given
+
+        uint8_t consumed = networked ? stepNetClient(netClient, tickTime, input) : stepSimulation(tickTime, input);
+        if (networked && netClient.finished) {
+            LOG_INFO("The server ended the session; carrying on locally");
+            networked = false;
+        }
+        // One-shot presses fire once per key press, even while the key is held
+        if (fromKeyboard && (consumed & INPUT_JUMP)) keyStates[' '] = false;
+        if (fromKeyboard && (consumed & INPUT_DIG_LEFT)) keyStates['q'] = false;
+        if (fromKeyboard && (consumed & INPUT_DIG_RIGHT)) keyStates['e'] = false;
+        if (running && (world->gameOver || world->gameWon)) saveSessionRecording();
     }
-    else {
-        // Allow reset even when game is over/won by pressing 'R'
-        // Input handling for 'R' is done in keyboardDown for immediate response
+
+    // The session just ended some other way than the preload guessed: prepare the right one
+    if ((world->gameOver || world->gameWon) && preloadedLevel != followingLevel()) {
+        startPreload(followingLevel(), newSessionSeed(), DEFAULT_ENEMIES);
     }
 
+    // A finished session's screen stays as drawn: wait for an event instead of ticking on
+    FrameState state;
+    state.ticks = ticks;
+    state.sessionInPlay = !world->gameOver && !world->gameWon;
+    state.alwaysActive = replaying || networked || profileOverlay || !renderOnChange;
+    state.redrawRequested = redrawRequested;
+    state.windowVisible = windowVisible;
+    FrameDecision decision = endFrame(state);
+    if (decision.redraw) glutPostRedisplay();
+    if (decision.schedule) scheduleFrame();
+    else frameLoopIdle = true;
+}
+
+void scheduleFrame() {
+    glutTimerFunc(nextFrameDelayMs(frameCadence, clockSeconds(), targetFrameRate), update, 0);
+}
+
+double clockSeconds() {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
 
-    glutPostRedisplay();          // Request redraw
-    glutTimerFunc(16, update, 0); // Request next update (~60fps)
+void requestRedraw() {
+    redrawRequested = true;
+    if (!frameLoopIdle) return; // The next update() draws it
+    frameLoopIdle = false;
+    lastUpdateTime = std::chrono::high_resolution_clock::now(); // The idle time is not simulated
+    restartCadence(frameCadence, clockSeconds());
+    glutTimerFunc(0, update, 0);
 }
 
+// Through the platform's swap control extension; without one the driver's setting stays
+void setSwapInterval(int interval) {
+#ifdef _WIN32
+    if (WGLEW_EXT_swap_control) {
+        wglSwapIntervalEXT(interval);
+        return;
+    }
+#else
+    if (GLXEW_EXT_swap_control) {
+        glXSwapIntervalEXT(glXGetCurrentDisplay(), glXGetCurrentDrawable(), interval);
+        return;
+    }
+    if (GLXEW_MESA_swap_control) {
+        glXSwapIntervalMESA(interval);
+        return;
+    }
+#endif
+    std::cerr << "No swap control extension; the driver's vsync setting applies" << std::endl;
+}
+
+
 // --- Input Handling ---
 
 void keyboardDown(unsigned char key, int x, int y) {
     keyStates[tolower(key)] = true;
     if (key == 27) { // ESC key
+        saveSessionRecording(); // A session cut short is still worth replaying
+        if (networked) stopNetClient(netClient); // Lets the server end the session now
+        finishProfiling();
         exit(0);
     }
+    if (key == 'p' || key == 'P') {
+        profileOverlay = !profileOverlay;
+        if (profileOverlay && !profilerRunning()) startProfiling();
+        // Without an export to write, nothing needs the history once the overlay is gone
+        if (!profileOverlay && !profileCsvPath && !profileTracePath) stopProfiler();
+    }
     // Handle reset immediately only if game is over or won
-    if ((gameOver || gameWon) && keyStates['r']) {
+    if ((world->gameOver || world->gameWon) && keyStates['r']) {
         resetGame();
         // No need to consume 'r' here, resetGame reinitializes everything
     }
+    requestRedraw(); // Wakes a finished session's idle loop
 }
 
 void keyboardUp(unsigned char key, int x, int y) {
@@ -716,847 +1236,394 @@ void keyboardUp(unsigned char key, int x, int y) {
 
 void specialKeyDown(int key, int x, int y) {
     specialKeyStates[key] = true;
+    requestRedraw();
 }
 
 void specialKeyUp(int key, int x, int y) {
     specialKeyStates[key] = false;
 }
 
-void handleInput(float deltaTime) {
-    // No input if game over, won, player is trapped, or player is not alive (though player is always alive)
-    if (gameOver || gameWon || player.isTrapped || !player.isAlive) return;
+uint8_t readInput() {
+    uint8_t input = 0;
+    if (keyStates['a'] || specialKeyStates[GLUT_KEY_LEFT]) input |= INPUT_LEFT;
+    if (keyStates['d'] || specialKeyStates[GLUT_KEY_RIGHT]) input |= INPUT_RIGHT;
+    if (keyStates['w'] || specialKeyStates[GLUT_KEY_UP]) input |= INPUT_UP;
+    if (keyStates['s'] || specialKeyStates[GLUT_KEY_DOWN]) input |= INPUT_DOWN;
+    if (keyStates['q']) input |= INPUT_DIG_LEFT;
+    if (keyStates['e']) input |= INPUT_DIG_RIGHT;
+    if (keyStates[' ']) input |= INPUT_JUMP;
+    return input;
+}
 
-    player.vx = 0; // Reset horizontal velocity unless a key is pressed
 
-    bool onLadder = isOnLadder(player);
-    player.isOnRope = checkOnRope(player); // Update rope status based on current position
+// --- Render State Tracking ---
+
+// Forgets all cached state so the next call of each helper is always issued
+void resetRenderState() {
+    renderState.program = 0;
+    renderState.vao = 0;
+    renderState.textureArray = 0;
+    renderState.arrayBuffer = 0;
+    renderState.projectionValid = false;
+    renderState.timeValid = false;
+    renderState.skippedCalls = 0;
+    renderState.stateChanges = 0;
+    renderState.drawCalls = 0;
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0); // Only unit 0 is ever used
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    // --- Horizontal Movement ---
-    if (keyStates['a'] || specialKeyStates[GLUT_KEY_LEFT]) {
-        if (player.isOnRope) {
-            player.vx = -ROPE_SPEED; // Move at rope speed if on rope
-        }
-        else if (!player.isClimbing) { // Allow horizontal move if not actively climbing ladder
-            player.vx = -PLAYER_SPEED;
-        }
-        player.faceRight = false;
-        if (!player.isOnRope) player.isClimbing = false; // Stop climbing ladder if moving horizontally off it
-    }
-    if (keyStates['d'] || specialKeyStates[GLUT_KEY_RIGHT]) {
-        if (player.isOnRope) {
-            player.vx = ROPE_SPEED;
-        }
-        else if (!player.isClimbing) {
-            player.vx = PLAYER_SPEED;
-        }
-        player.faceRight = true;
-        if (!player.isOnRope) player.isClimbing = false;
-    }
+void useProgram(GLuint program) {
+    if (renderState.program == program) { renderState.skippedCalls++; return; }
+    glUseProgram(program);
+    renderState.stateChanges++;
+    renderState.program = program;
+}
 
-    // --- Vertical Movement (Ladders) ---
-    if (onLadder) {
-        //player.vy = 0; // Stop gravity/fall on ladder ONLY if moving vertically
-        player.isFalling = false;
-        player.isOnRope = false; // Cannot be on ladder and rope simultaneously
+void bindVertexArray(GLuint vertexArray) {
+    if (renderState.vao == vertexArray) { renderState.skippedCalls++; return; }
+    glBindVertexArray(vertexArray);
+    renderState.stateChanges++;
+    renderState.vao = vertexArray;
+}
 
-        if (keyStates['w'] || specialKeyStates[GLUT_KEY_UP]) {
-            player.vy = CLIMB_SPEED;
-            player.isClimbing = true;
-        }
-        else if (keyStates['s'] || specialKeyStates[GLUT_KEY_DOWN]) {
-            player.vy = -CLIMB_SPEED;
-            player.isClimbing = true;
-        }
-        else {
-            // If no vertical input, stop vertical movement on ladder
-            player.vy = 0;
-            // Allow horizontal movement to take precedence if keys are pressed
-            if (!keyStates['a'] && !specialKeyStates[GLUT_KEY_LEFT] && !keyStates['d'] && !specialKeyStates[GLUT_KEY_RIGHT]) {
-                player.isClimbing = false; // Not actively climbing if no vertical or horizontal input
-            }
-            else {
-                player.isClimbing = false; // Moving horizontally off ladder
-            }
-        }
-    }
-    else {
-        player.isClimbing = false; // Not on a ladder
-        // Gravity will be applied in updatePhysics if not climbing
-    }
+void bindTextureArray(GLuint texture) {
+    if (renderState.textureArray == texture) { renderState.skippedCalls++; return; }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    renderState.stateChanges++;
+    renderState.textureArray = texture;
+}
 
-    // --- Stop vertical movement if on rope and not falling onto it ---
-    if (player.isOnRope) {
-        // Only stop vertical velocity if actually *on* the rope, not just touching it while falling
-        int playerGridY = getGridY(player.y + TILE_SIZE * 0.1f); // Check slightly above feet
-        int playerGridX = getGridX(player.x + TILE_SIZE * 0.4f);
-        if (level[playerGridY][playerGridX] == ROPE) {
-            player.vy = 0;
-            player.isClimbing = false;
-            player.isFalling = false;
-        }
-    }
+void bindArrayBuffer(GLuint buffer) {
+    if (renderState.arrayBuffer == buffer) { renderState.skippedCalls++; return; }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    renderState.stateChanges++;
+    renderState.arrayBuffer = buffer;
+}
 
-    bool groundCheck = isOnGround(player); // Check if player is on a surface [cite: 465]
-    if (keyStates[' '] && groundCheck && !player.isClimbing && !player.isOnRope && !player.isFalling) { // Check for space key (ASCII 32 might be needed if ' ' doesn't work)
-        player.vy = JUMP_FORCE;         // Apply upward velocity
-        player.isJumping = true;        // Set jumping state
-        player.isFalling = false;       // Not falling initially
-        keyStates[' '] = false;         // Consume the key press to prevent repeated jumps
-    }
-    // --- Digging (Lode Runner Style: Down-Left/Right) ---
-    int playerGridX = getGridX(player.x + TILE_SIZE * 0.4f); // Center-ish X
-    int playerGridY = getGridY(player.y);                  // Bottom Y
-    float checkYBelow = player.y - 1.0f;                   // Check slightly below feet
-
-    // Check if player is standing on a valid surface for digging
-    TileType tileBelow = getTileAt(player.x + TILE_SIZE * 0.4f, checkYBelow);
-    bool canStand = (tileBelow == BRICK || tileBelow == SOLID_BRICK || tileBelow == LADDER || tileBelow == ROPE || isOnLadder(player) || checkOnRope(player));
-
-    if (canStand && !player.isFalling && !player.isClimbing) { // Can only dig if standing stably
-        int targetY = playerGridY - 1; // Target is one row below player
-
-        if (keyStates['q']) { // Dig Left-Below
-            int targetX = playerGridX - 1;
-            if (targetX >= 0 && targetY >= 0) { // Bounds check
-                // Check if the target tile is actually a brick
-                if (level[targetY][targetX] == BRICK && dugHoles.find({ targetX, targetY }) == dugHoles.end()) {
-                    digHole(targetX, targetY);
-                }
-            }
-            keyStates['q'] = false; // Consume key press (optional, prevents rapid digging)
-        }
-        else if (keyStates['e']) { // Dig Right-Below
-            int targetX = playerGridX + 1;
-            if (targetX < GRID_WIDTH && targetY >= 0) { // Bounds check
-                // Check if the target tile is actually a brick
-                if (level[targetY][targetX] == BRICK && dugHoles.find({ targetX, targetY }) == dugHoles.end()) {
-                    digHole(targetX, targetY);
-                }
-            }
-            keyStates['e'] = false; // Consume key press
-        }
+// Uniforms below belong to spriteShader, which must be the current program
+void setProjectionUniform(const float matrix[16]) {
+    if (renderState.projectionValid && memcmp(renderState.projection, matrix, sizeof(renderState.projection)) == 0) {
+        renderState.skippedCalls++;
+        return;
     }
+    glUniformMatrix4fv(spriteShader.projectionLoc, 1, GL_FALSE, matrix);
+    renderState.stateChanges++;
+    memcpy(renderState.projection, matrix, sizeof(renderState.projection));
+    renderState.projectionValid = true;
 }
 
+void setTimeUniform(float time) {
+    if (renderState.timeValid && renderState.time == time) { renderState.skippedCalls++; return; }
+    glUniform1f(spriteShader.timeLoc, time);
+    renderState.stateChanges++;
+    renderState.time = time;
+    renderState.timeValid = true;
+}
 
-// --- Update Functions ---
 
-void updatePhysics(Entity& entity, float deltaTime) {
-    if (entity.isTrapped) {
-        // If trapped, handle timer and potential freeing, but no movement/gravity
-        entity.trappedTimer -= deltaTime;
-        entity.vx = 0;
-        entity.vy = 0;
+// --- Drawing Functions ---
 
-        int gridX = getGridX(entity.x + TILE_SIZE * 0.4f);
-        int gridY = getGridY(entity.y);
+// Queues one sprite from the atlas into the sprite batch
+void drawSprite(float x, float y, float width, float height, SpriteId sprite, bool flipH,
+    float r, float g, float b, float a) {
+    drawQuad(x, y, width, height, spriteAtlas, spriteLayers[sprite], flipH, r, g, b, a);
+}
 
-        if (entity.trappedTimer <= 0) {
-            // Timer expired. Check if hole still exists.
-            auto currentHoleIt = dugHoles.find({ gridX, gridY });
-            if (currentHoleIt == dugHoles.end()) { // Hole refilled while trapped!
-                if (&entity != &player) { // Only enemies die when hole refills
-                    std::cout << "Enemy killed by refilling hole!" << std::endl;
-                    killEnemy(entity); // Mark for respawn
-                }
-                else {
-                    // Player gets freed but might be stuck in brick, give boost
-                    std::cout << "Player freed by refill!" << std::endl;
-                    entity.isTrapped = false;
-                    entity.y += 5.0f; // Small boost upwards
-                    entity.isFalling = true; // Apply gravity next frame
-                }
-            }
-            else {
-                // Hole still exists, but timer ran out? Keep trapped until refill.
-                // This case shouldn't ideally happen if trappedTimer is set correctly relative to DIG_REFILL_TIME
-                entity.trappedTimer = 0.01f; // Prevent timer going negative indefinitely
-            }
-        }
-        return; // Skip normal physics update if trapped
+// Queues a quad textured from one layer of a texture array; nothing is drawn until flushSpriteBatch()
+// Consecutive quads from the same texture array share a run and are drawn together
+void drawQuad(float x, float y, float width, float height, GLuint textureArray, int layer, bool flipH,
+    float r, float g, float b, float a) {
+    SpriteInstance instance;
+    instance.x = x;
+    instance.y = y;
+    instance.width = width;
+    instance.height = height;
+    instance.flip = flipH ? -1.0f : 1.0f;
+    instance.layer = static_cast<float>(layer);
+    instance.tint[0] = r;
+    instance.tint[1] = g;
+    instance.tint[2] = b;
+    instance.tint[3] = a;
+    instance.fade[0] = 0.0f;
+    instance.fade[1] = 0.0f; // Batched sprites never fade
+
+    // Start a new run only when the texture changes
+    if (spriteRuns.empty() || spriteRuns.back().textureId != textureArray) {
+        SpriteRun run;
+        run.textureId = textureArray;
+        run.first = static_cast<int>(spriteInstances.size());
+        run.count = 0;
+        spriteRuns.push_back(run);
     }
+    spriteRuns.back().count++;
+    spriteInstances.push_back(instance);
+}
 
-    // --- Apply Gravity ---
-    // Apply gravity if not climbing a ladder AND not on a rope
-    if (!entity.isClimbing && !entity.isOnRope) {
-        entity.vy -= GRAVITY * deltaTime;
-    }
-    else if (entity.isClimbing && entity.vy == 0) {
-        // If stopped on a ladder, ensure no residual vertical velocity
-        entity.vy = 0;
+// Appends pre-built instances (e.g. a cached text layout) to the batch in one go
+void queueInstances(GLuint textureArray, const SpriteInstance* instances, int count) {
+    if (count <= 0) return;
+    if (spriteRuns.empty() || spriteRuns.back().textureId != textureArray) {
+        SpriteRun run;
+        run.textureId = textureArray;
+        run.first = static_cast<int>(spriteInstances.size());
+        run.count = 0;
+        spriteRuns.push_back(run);
     }
+    spriteRuns.back().count += count;
+    spriteInstances.insert(spriteInstances.end(), instances, instances + count);
+}
 
+// Points the instanced attributes (locations 2-5) at the given instance in the bound buffer.
+// GL 3.3 has no base-instance draw, so each run re-bases the attributes instead.
+// Expects the target VAO and its instance buffer to be bound.
+void setInstanceAttribOffset(int firstInstance) {
+    const GLsizei stride = sizeof(SpriteInstance);
+    const size_t base = static_cast<size_t>(firstInstance) * sizeof(SpriteInstance);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, x)));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, flip)));
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, tint)));
+    glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, fade)));
+}
 
-    // --- Update Position based on Velocity ---
-    float oldX = entity.x;
-    float oldY = entity.y;
-    float newX = entity.x + entity.vx * deltaTime;
-    float newY = entity.y + entity.vy * deltaTime;
-
-    // --- Collision Detection & Resolution ---
-    float entityWidth = TILE_SIZE * 0.8f; // Use slightly smaller collision box
-    float entityHeight = TILE_SIZE * 0.95f;
-
-    // Create a bounding box for the entity's potential new position
-    float nextLeft = newX;
-    float nextRight = newX + entityWidth;
-    float nextBottom = newY;
-    float nextTop = newY + entityHeight;
-
-    // --- Vertical Collision ---
-    if (entity.vy != 0) { // Only check vertical collision if moving vertically
-        // Check points slightly inside the horizontal edges at the new bottom/top Y
-        float checkXLeft = nextLeft + TILE_SIZE * 0.1f;
-        float checkXRight = nextRight - TILE_SIZE * 0.1f;
-        float checkY = (entity.vy < 0) ? nextBottom : nextTop; // Check bottom edge when falling, top edge when rising
-
-        TileType tileLeft = getTileAt(checkXLeft, checkY);
-        TileType tileRight = getTileAt(checkXRight, checkY);
-
-        bool collision = false;
-        if (entity.vy < 0) { // Moving Down (Falling/Landing)
-            // Collision if hitting Brick, Solid Brick, or potentially another entity in a hole
-            if (tileLeft == BRICK || tileLeft == SOLID_BRICK || tileRight == BRICK || tileRight == SOLID_BRICK) {
-                collision = true;
-            }
-            // Check landing on trapped enemy head (Lode Runner mechanic)
-            for (int i = 0; i < numEnemies; ++i) {
-                if (&entity != &enemies[i] && enemies[i].isTrapped) { // Check against other trapped enemies
-                    float enemyHeadY = enemies[i].y + TILE_SIZE * 0.9f; // Approx head height
-                    if (nextBottom <= enemyHeadY && oldY >= enemyHeadY && // Crossing the head level
-                        nextRight > enemies[i].x && nextLeft < enemies[i].x + TILE_SIZE * 0.8f) // Horizontal overlap
-                    {
-                        collision = true;
-                        newY = enemyHeadY; // Land exactly on head
-                        break; // Stop checking after landing on one
-                    }
-                }
-            }
-
-            if (collision) {
-                int gridY = getGridY(checkY); // Grid Y of the tile being collided with
-                newY = static_cast<float>(gridY + 1) * TILE_SIZE; // Snap feet to top of the tile below
-                entity.vy = 0;
-                entity.isFalling = false;
-                if (&entity == &player) { // Only reset jump state for player
-                    entity.isJumping = false; // << ADD THIS LINE: Reset jump state on landing
-                }
-            }
-        }
-        else { // Moving Up
-            // Collision if hitting Brick or Solid Brick
-            if (tileLeft == BRICK || tileLeft == SOLID_BRICK || tileRight == BRICK || tileRight == SOLID_BRICK) {
-                collision = true;
-                int gridY = getGridY(checkY); // Grid Y of the tile being collided with
-                newY = static_cast<float>(gridY) * TILE_SIZE - entityHeight; // Snap head to bottom of tile above
-                entity.vy = 0; // Stop upward movement
-            }
-        }
-        // If no collision detected while moving down and not climbing/on rope, entity is falling
-        if (!collision && entity.vy < 0 && !entity.isClimbing && !entity.isOnRope) {
-            entity.isFalling = true;
-        }
+// Uploads every queued quad in one buffer update and issues one
+// glDrawArraysInstanced per texture run. Expects vao and the shader to be bound.
+void flushSpriteBatch() {
+    if (spriteInstances.empty()) {
+        spriteRuns.clear();
+        return;
     }
 
-    // --- Horizontal Collision ---
-    if (entity.vx != 0) { // Only check horizontal collision if moving horizontally
-        // Check points slightly inside the vertical edges at the new Y position
-        float checkYBottom = newY + TILE_SIZE * 0.1f;
-        float checkYMiddle = newY + entityHeight * 0.5f;
-        float checkYTop = newY + entityHeight * 0.9f; // Check near top
-        float checkX = (entity.vx < 0) ? nextLeft : nextRight; // Check left edge when moving left, right edge when moving right
-
-        TileType tileBottom = getTileAt(checkX, checkYBottom);
-        TileType tileMiddle = getTileAt(checkX, checkYMiddle);
-        TileType tileTop = getTileAt(checkX, checkYTop);
-
-        bool collision = false;
-        // Collision if hitting Brick or Solid Brick
-        if (tileBottom == BRICK || tileBottom == SOLID_BRICK ||
-            tileMiddle == BRICK || tileMiddle == SOLID_BRICK ||
-            tileTop == BRICK || tileTop == SOLID_BRICK)
-        {
-            // Special case: Allow moving horizontally *past* a ladder/rope if not climbing/on it
-            bool onValidTraversal = entity.isClimbing || entity.isOnRope;
-            if (!onValidTraversal || (tileBottom != LADDER && tileBottom != ROPE && tileMiddle != LADDER && tileMiddle != ROPE && tileTop != LADDER && tileTop != ROPE))
-            {
-                collision = true;
-                int gridX = getGridX(checkX);
-                if (entity.vx < 0) { // Moving left
-                    newX = static_cast<float>(gridX + 1) * TILE_SIZE; // Snap left edge to right edge of tile
-                }
-                else { // Moving right
-                    newX = static_cast<float>(gridX) * TILE_SIZE - entityWidth; // Snap right edge to left edge of tile
-                }
-                entity.vx = 0; // Stop horizontal movement
-            }
-        }
+    bindArrayBuffer(vboInstances);
+    size_t bytes = spriteInstances.size() * sizeof(SpriteInstance);
+    if (spriteInstances.size() > instanceBufferCapacity) {
+        // Grow geometrically so the buffer is reallocated only a handful of times
+        instanceBufferCapacity = spriteInstances.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, instanceBufferCapacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
     }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, spriteInstances.data());
 
-
-    // --- Update final position ---
-    entity.x = newX;
-    entity.y = newY;
-
-    // --- Boundary Checks (Window edges) ---
-    if (entity.x < 0) entity.x = 0;
-    if (entity.x + entityWidth > WINDOW_WIDTH) entity.x = WINDOW_WIDTH - entityWidth;
-    if (entity.y < -TILE_SIZE) { // Allow falling slightly off before reset
-        entity.y = 0; // Reset Y
-        entity.vy = 0;
-        if (&entity == &player) { // Only player loses life falling off screen
-            lives--;
-            if (lives <= 0) {
-                gameOver = true;
-            }
-            else {
-                // Respawn player at start
-                entity.x = entity.startGridX * TILE_SIZE + (TILE_SIZE * 0.1f);
-                entity.y = entity.startGridY * TILE_SIZE;
-                entity.vx = 0; entity.vy = 0;
-                entity.isFalling = false;
-            }
-        }
-        else {
-            // Enemy fell off bottom - kill and respawn
-            killEnemy(entity);
-        }
+    for (const SpriteRun& run : spriteRuns) {
+        setInstanceAttribOffset(run.first);
+        bindTextureArray(run.textureId);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, run.count); // 6 vertices per quad
+        renderState.drawCalls++;
     }
-    // No top boundary check needed if level prevents it
 
-
-     // --- Check if falling into a dug hole ---
-    int gridX = getGridX(entity.x + entityWidth / 2.0f);
-    int gridY = getGridY(entity.y + entityHeight / 2.0f); // Check center
-    int gridYFeet = getGridY(entity.y + 1.0f); // Check just above feet
-    if (entity.isFalling && entity.vy == 0 && isOnGround(entity)) { // Additional check ensure falling state is reset if vy becomes 0 while on ground
-        entity.isFalling = false;
-        if (&entity == &player) entity.isJumping = false;
-    }
-
-    // Check the tile the feet are currently in
-    if (gridX >= 0 && gridX < GRID_WIDTH && gridYFeet >= 0 && gridYFeet < GRID_HEIGHT) {
-        auto it = dugHoles.find({ gridX, gridYFeet });
-        if (it != dugHoles.end() && entity.isFalling) { // Fell into a hole
-            if (!entity.isTrapped) {
-                std::cout << "Entity trapped in hole at (" << gridX << ", " << gridYFeet << ")" << std::endl;
-                entity.isTrapped = true;
-                // Set trapped timer slightly less than refill time, allows enemy to be killed by refill
-                entity.trappedTimer = it->second.timer - 0.1f;
-                if (entity.trappedTimer < 0) entity.trappedTimer = 0.01f; // Ensure positive
-
-                entity.x = gridX * TILE_SIZE + (TILE_SIZE - entityWidth) / 2.0f; // Center in hole horizontally
-                entity.y = gridYFeet * TILE_SIZE; // Align feet with bottom of hole
-                entity.vx = 0;
-                entity.vy = 0;
-                entity.isFalling = false;
-                // entity.isJumping = false; // Removed
-                entity.isClimbing = false;
-            }
-        }
-    }
+    spriteInstances.clear();
+    spriteRuns.clear();
 }
 
-void updatePlayer(float deltaTime) {
-    if (!player.isAlive) return; // Should not happen for player, but safety check
-
-    updatePhysics(player, deltaTime);
-
-    // --- Collectibles ---
-    // Check a slightly larger area around the player's center for pickup
-    float playerCenterX = player.x + (TILE_SIZE * 0.8f) / 2.0f;
-    float playerCenterY = player.y + (TILE_SIZE * 0.95f) / 2.0f;
-    int centerGridX = getGridX(playerCenterX);
-    int centerGridY = getGridY(playerCenterY);
-
-    // Check 3x3 grid around the player's center grid cell
-    for (int dx = -1; dx <= 1; ++dx) {
-        for (int dy = -1; dy <= 1; ++dy) {
-            int checkX = centerGridX + dx;
-            int checkY = centerGridY + dy;
-
-            if (checkX >= 0 && checkX < GRID_WIDTH && checkY >= 0 && checkY < GRID_HEIGHT) {
-                // Check if collectible exists at this grid cell
-                if (collectibles[checkY][checkX] == 1) {
-                    // Check collision between player bounding box and collectible's small area
-                    float collectibleX = checkX * TILE_SIZE + TILE_SIZE * 0.2f; // Approx collectible position
-                    float collectibleY = checkY * TILE_SIZE + TILE_SIZE * 0.2f;
-                    float collectibleSize = TILE_SIZE * 0.6f;
-                    if (isColliding(player.x, player.y, TILE_SIZE * 0.8f, TILE_SIZE * 0.95f,
-                        collectibleX, collectibleY, collectibleSize, collectibleSize))
-                    {
-                        collectibles[checkY][checkX] = 0; // Collect it
-                        collectiblesCollected++;
-                        score += POINTS_PER_COLLECTIBLE;
-                        std::cout << "Collected! Score: " << score << ", Total: " << collectiblesCollected << "/" << totalCollectibles << std::endl;
-                        // Add sound effect here if possible
-                    }
-                }
-            }
-        }
-    }
 
-    // --- Check Win Condition ---
-    if (levelComplete && !gameWon) {
-        // Check if player reached an exit ladder at the top
-        int topGridY = GRID_HEIGHT - 1; // Or adjust based on level design
-        int playerHeadGridY = getGridY(player.y + TILE_SIZE * 0.9f);
-        int playerFeetGridY = getGridY(player.y + 1.0f);
-
-        // Check if player is overlapping with an exit ladder tile near the top
-        if (playerHeadGridY >= topGridY - 1) { // Check top two rows
-            TileType tileAtHead = getTileAt(playerCenterX, player.y + TILE_SIZE * 0.9f);
-            TileType tileAtFeet = getTileAt(playerCenterX, player.y + 1.0f);
-            if (tileAtHead == EXIT_LADDER || tileAtFeet == EXIT_LADDER) {
-                gameWon = true;
-                std::cout << "Level Complete! Player reached the exit!" << std::endl;
-            }
-        }
-    }
+int tileSlot(int gridX, int gridY) {
+    int chunk = (gridY / CHUNK_SIZE) * CHUNKS_X + gridX / CHUNK_SIZE;
+    return chunk * CHUNK_CELLS + (gridY % CHUNK_SIZE) * CHUNK_SIZE + gridX % CHUNK_SIZE;
 }
 
-void updateEnemies(float deltaTime) {
-    for (int i = 0; i < numEnemies; ++i) {
-        if (!enemies[i].isAlive) {
-            // Handle respawn timer
-            enemies[i].respawnTimer -= deltaTime;
-            if (enemies[i].respawnTimer <= 0) {
-                // Respawn the enemy
-                enemies[i].x = enemies[i].startGridX * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 161, 306]
-                enemies[i].y = enemies[i].startGridY * TILE_SIZE; // [cite: 161, 306]
-                enemies[i].vx = (rand() % 2 == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // [cite: 162, 307]
-                enemies[i].vy = 0.0f; // [cite: 162, 307]
-                enemies[i].isClimbing = false; // [cite: 163, 307]
-                enemies[i].isOnRope = false; // [cite: 163, 307]
-                enemies[i].isFalling = false; // [cite: 163, 307]
-                enemies[i].faceRight = (enemies[i].vx > 0); // [cite: 163, 307]
-                enemies[i].isTrapped = false; // [cite: 164, 308]
-                enemies[i].trappedTimer = 0.0f; // [cite: 164, 308]
-                enemies[i].isAlive = true; // Bring back to life [cite: 164, 308]
-                enemies[i].respawnTimer = 0.0f; // [cite: 164, 308]
-                std::cout << "Enemy " << i << " respawned." << std::endl; // [cite: 309]
-            }
-            continue; // Skip update if waiting to respawn [cite: 310]
-        }
-
-        // Skip AI and physics update if trapped (physics handles trapped state)
-        if (enemies[i].isTrapped) { // [cite: 311]
-            updatePhysics(enemies[i], deltaTime); // Still need physics for timer/freeing [cite: 312]
-            continue; // [cite: 312]
-        }
-
-        // --- Improved Lode Runner AI ---
-        float targetX = player.x; // [cite: 314]
-        float targetY = player.y; // [cite: 314]
-        float enemyX = enemies[i].x; // [cite: 314]
-        float enemyY = enemies[i].y; // [cite: 314]
-        float diffX = targetX - enemyX; // [cite: 315]
-        float diffY = targetY - enemyY; // [cite: 315]
-
-        float enemyWidth = TILE_SIZE * 0.8f; // [cite: 315]
-        float enemyHeight = TILE_SIZE * 0.95f; // [cite: 315]
-        float enemyCenterX = enemyX + enemyWidth / 2.0f; // [cite: 316]
-        float enemyFeetY = enemyY; // [cite: 316]
-        float enemyHeadY = enemyY + enemyHeight;
-
-        int enemyGridX = getGridX(enemyCenterX); // [cite: 316]
-        int enemyGridY = getGridY(enemyFeetY); // [cite: 316]
-        int enemyHeadGridY = getGridY(enemyHeadY);
-
-        bool enemyOnLadder = isOnLadder(enemies[i]); // [cite: 317]
-        bool enemyOnRope = checkOnRope(enemies[i]); // [cite: 317]
-        enemies[i].isOnRope = enemyOnRope; // Update state [cite: 317]
-
-        // --- AI Decision Making ---
-        float desiredVX = 0; // [cite: 319]
-        float desiredVY = 0; // [cite: 319]
-        bool wantsToClimb = false; // [cite: 319]
-
-        // --- Check Environment ---
-        // Check for ladders/ropes at current X position and surroundings
-        bool ladderAtFeet = (getTileAt(enemyCenterX, enemyFeetY) == LADDER);
-        bool ladderBelow = (getTileAt(enemyCenterX, enemyFeetY - 1.0f) == LADDER || ladderAtFeet); // [cite: 320, 321] Consider ladder tile itself for going down
-        bool ladderAbove = false; // [cite: 319]
-        for (int y = enemyHeadGridY; y < GRID_HEIGHT; ++y) { // Check from head upwards [cite: 322]
-            TileType t = getTileAt(enemyCenterX, y * TILE_SIZE + 1.0f); // [cite: 322]
-            if (t == LADDER) { ladderAbove = true; break; } // [cite: 323]
-            if (t == BRICK || t == SOLID_BRICK) break; // Path blocked [cite: 323]
-        }
-        bool ropeAtLevel = (getTileAt(enemyCenterX, enemyY + enemyHeight * 0.5f) == ROPE); // Check near vertical center for rope [cite: 324]
-
-
-        // --- START: MODIFIED AI Priorities ---
-        bool canMoveLeft = canMoveTo(enemyX - 1, enemyY, enemyWidth, enemyHeight, enemyOnRope, enemyOnLadder); // Basic check left
-        bool canMoveRight = canMoveTo(enemyX + 1, enemyY, enemyWidth, enemyHeight, enemyOnRope, enemyOnLadder); // Basic check right
-
-        // Priority 1: Vertical Alignment via Ladders/Ropes
-        if (fabs(diffY) > TILE_SIZE * 0.75) { // Player significantly above/below
-            if (diffY > 0 && ladderAbove) { // Player Above, Ladder directly above?
-                desiredVY = CLIMB_SPEED; // [cite: 327]
-                wantsToClimb = true; // [cite: 327]
-            }
-            else if (diffY < 0 && ladderBelow) { // Player Below, Ladder directly below?
-                desiredVY = -CLIMB_SPEED; // [cite: 328]
-                wantsToClimb = true; // [cite: 328]
-            }
-            else if (ropeAtLevel && fabs(diffY) < TILE_SIZE * 1.5) { // Player near rope level, use rope horizontally
-                if (diffX > TILE_SIZE * 0.2f && canMoveRight) desiredVX = ROPE_SPEED; // [cite: 330]
-                else if (diffX < -TILE_SIZE * 0.2f && canMoveLeft) desiredVX = -ROPE_SPEED; // [cite: 330]
-            }
-            else {
-                // Seek nearest ladder/rope horizontally
-                // Simple version: Just move towards player horizontally for now
-                if (diffX > TILE_SIZE * 0.2f && canMoveRight) desiredVX = ENEMY_SPEED; // [cite: 337]
-                else if (diffX < -TILE_SIZE * 0.2f && canMoveLeft) desiredVX = -ENEMY_SPEED; // [cite: 337]
-            }
-        }
-        // Priority 2: Horizontal Alignment / Rope Traversal
-        else { // Player is roughly level
-            if (enemyOnRope) { // Already on rope
-                if (diffX > TILE_SIZE * 0.2f && canMoveRight) desiredVX = ROPE_SPEED; // [cite: 330]
-                else if (diffX < -TILE_SIZE * 0.2f && canMoveLeft) desiredVX = -ROPE_SPEED; // [cite: 330]
-                // Ensure enemy stays vertically aligned with the rope [cite: 331]
-                int ropeGridY = getGridY(enemyY + enemyHeight * 0.5f); // [cite: 332]
-                if (ropeGridY >= 0 && ropeGridY < GRID_HEIGHT) { // [cite: 332]
-                    // Gently nudge towards rope center Y if slightly off
-                    float targetRopeY = static_cast<float>(ropeGridY) * TILE_SIZE; // [cite: 333]
-                    if (fabs(enemies[i].y - targetRopeY) > 1.0f) {
-                        enemies[i].y += (targetRopeY - enemies[i].y) * 0.1f; // Smooth adjustment
-                    }
-                    enemies[i].vy = 0; // [cite: 334]
-                    enemies[i].isFalling = false; // [cite: 335]
-                }
-            }
-            else if (ladderAtFeet && fabs(diffX) < TILE_SIZE * 0.6f) { // On a ladder but player is level? Stop climbing.
-                desiredVY = 0;
-                wantsToClimb = false; // Stay on ladder level
-                // Optionally move horizontally if player is to the side
-                if (diffX > TILE_SIZE * 0.2f && canMoveRight) desiredVX = ENEMY_SPEED / 2.0f; // Slower on ladder?
-                else if (diffX < -TILE_SIZE * 0.2f && canMoveLeft) desiredVX = -ENEMY_SPEED / 2.0f;
-
-            }
-            else { // Not on rope, not climbing vertically significantly, move horizontally
-                if (diffX > TILE_SIZE * 0.2f && canMoveRight) desiredVX = ENEMY_SPEED; // [cite: 337]
-                else if (diffX < -TILE_SIZE * 0.2f && canMoveLeft) desiredVX = -ENEMY_SPEED; // [cite: 337]
-            }
-        }
-
-        // --- Hazard Avoidance ---
-        if (!wantsToClimb && !enemyOnRope && desiredVX != 0 && !enemies[i].isFalling) {
-            float nextX = enemyCenterX + (desiredVX > 0 ? TILE_SIZE * 0.6f : -TILE_SIZE * 0.6f); // Check ahead horizontally
-            float checkYBelowNext = enemyFeetY - 1.0f; // Check below the potential next step [cite: 468]
-            TileType tileBelowNext = getTileAt(nextX, checkYBelowNext); // [cite: 458]
-            TileType tileAtNextFeet = getTileAt(nextX, enemyFeetY);
-
-            // Check for Empty space or Dug Hole below the next step
-            bool holeBelowNext = dugHoles.count({ getGridX(nextX), getGridY(checkYBelowNext) }); // Check dugHoles map [cite: 23, 447]
-            bool emptyBelowNext = (tileBelowNext == EMPTY && !holeBelowNext);
-
-            // Avoid falling blindly unless onto a ladder/rope or if player is below
-            if (emptyBelowNext && tileAtNextFeet != LADDER && tileAtNextFeet != ROPE) {
-                // Player is NOT significantly below, so avoid the fall
-                if (diffY > -TILE_SIZE) { // Avoid falling if player isn't clearly below
-                    desiredVX = 0; // Stop horizontal movement to prevent fall
-                }
-                // If player IS below, allow the fall (desiredVX remains unchanged)
-            }
-            // NEW: Check for walking into a hole at foot level
-            bool holeAtNextFeet = dugHoles.count({ getGridX(nextX), enemyGridY });
-            if (holeAtNextFeet && tileAtNextFeet != LADDER && tileAtNextFeet != ROPE) {
-                // Found a hole directly in path, stop moving
-                desiredVX = 0;
-            }
-
-        }
-        // --- END: MODIFIED AI Priorities ---
-
-
-        // --- Set final velocities based on decisions ---
-        enemies[i].vx = desiredVX; // [cite: 339]
-        enemies[i].vy = desiredVY; // [cite: 339]
-        enemies[i].isClimbing = wantsToClimb; // [cite: 339]
-        if (desiredVX != 0) enemies[i].faceRight = (desiredVX > 0); // [cite: 339]
-
-
-        // Apply physics and collision
-        updatePhysics(enemies[i], deltaTime); // [cite: 340]
-
-        // --- Check Collision with Player ---
-        if (!player.isTrapped && isColliding(player.x, player.y, TILE_SIZE * 0.8f, TILE_SIZE * 0.95f,
-            enemies[i].x, enemies[i].y, enemyWidth, enemyHeight)) // [cite: 341]
-        {
-            if (!gameOver && !gameWon) { // Only trigger once per life/reset [cite: 341]
-                std::cout << "Player caught by enemy " << i << "!" << std::endl; // [cite: 342]
-                lives--; // [cite: 342]
-                if (lives <= 0) { // [cite: 342]
-                    gameOver = true; // [cite: 343]
-                }
-                else {
-                    // Reset player/enemy positions after being caught
-                    player.x = player.startGridX * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 344]
-                    player.y = player.startGridY * TILE_SIZE; // [cite: 344]
-                    player.vx = 0; player.vy = 0; player.isFalling = false; player.isTrapped = false; player.isJumping = false; // Reset jump state too [cite: 344]
-
-                    // Optionally reset this specific enemy too
-                    enemies[i].x = enemies[i].startGridX * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 346]
-                    enemies[i].y = enemies[i].startGridY * TILE_SIZE; // [cite: 346]
-                    enemies[i].vx = (rand() % 2 == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // [cite: 347]
-                    enemies[i].isAlive = true; // Ensure it's alive [cite: 347]
-                    enemies[i].isTrapped = false; // [cite: 347]
-                    // Reset enemy state fully
-                    enemies[i].vy = 0.0f;
-                    enemies[i].isClimbing = false;
-                    enemies[i].isOnRope = false;
-                    enemies[i].isFalling = false;
-                    enemies[i].faceRight = (enemies[i].vx > 0);
-
-                }
-            }
-        }
-    }
+// Flags one grid cell for rebuild on the next updateTileLayer()
+void markTileDirty(int gridX, int gridY) {
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) return;
+    if (!chunkLoaded[gridY / CHUNK_SIZE][gridX / CHUNK_SIZE]) return; // Built from scratch when it comes into view
+    if (tileDirty[gridY][gridX]) return; // Already queued
+    tileDirty[gridY][gridX] = true;
+    dirtyTiles.push_back(tileSlot(gridX, gridY));
 }
 
+// Unloads every chunk; the ones in view are rebuilt on the next updateTileLayer()
+void markAllTilesDirty() {
+    memset(tileDirty, 0, sizeof(tileDirty));
+    memset(chunkLoaded, 0, sizeof(chunkLoaded));
+    dirtyTiles.clear();
+}
 
-void updateDigging(float deltaTime) {
-    auto it = dugHoles.begin();
-    while (it != dugHoles.end()) {
-        it->second.timer -= deltaTime; // Decrease timer
-
-        if (it->second.timer <= 0) {
-            // Time to refill the hole
-            int x = it->second.gridX;
-            int y = it->second.gridY;
-            if (x >= 0 && x < GRID_WIDTH && y >= 0 && y < GRID_HEIGHT) {
-                // Restore the original tile type
-                level[y][x] = it->second.originalType;
-                std::cout << "Hole refilled at (" << x << ", " << y << ")" << std::endl;
-
-                // Check if any entity is currently trapped in this exact spot when it refills
-                float checkX = x * TILE_SIZE + TILE_SIZE * 0.4f; // Center X of the grid cell
-                float checkY = y * TILE_SIZE;                   // Bottom Y of the grid cell
-
-                // Check Player
-                if (player.isTrapped && getGridX(player.x + TILE_SIZE * 0.4f) == x && getGridY(player.y) == y) {
-                    player.isTrapped = false;
-                    player.y += 5.0f; // Boost slightly to avoid getting stuck in refilled brick
-                    player.isFalling = true;
-                    std::cout << "Player freed by refill." << std::endl;
-                }
-                // Check Enemies
-                for (int i = 0; i < numEnemies; ++i) {
-                    if (enemies[i].isAlive && enemies[i].isTrapped && getGridX(enemies[i].x + TILE_SIZE * 0.4f) == x && getGridY(enemies[i].y) == y) {
-                        std::cout << "Enemy " << i << " killed by refilling hole at (" << x << ", " << y << ")" << std::endl;
-                        killEnemy(enemies[i]); // Mark enemy for respawn
-                    }
-                }
-            }
-            // Erase the hole from the map and advance iterator
-            it = dugHoles.erase(it);
-        }
-        else {
-            // Hole still digging, move to the next one
-            ++it;
+void loadChunk(int chunkX, int chunkY) {
+    int first = (chunkY * CHUNKS_X + chunkX) * CHUNK_CELLS;
+    for (int y = chunkY * CHUNK_SIZE; y < (chunkY + 1) * CHUNK_SIZE; ++y) {
+        for (int x = chunkX * CHUNK_SIZE; x < (chunkX + 1) * CHUNK_SIZE; ++x) {
+            buildTileInstance(x, y, tileInstances[tileSlot(x, y)]);
         }
     }
+    bindArrayBuffer(vboTileInstances);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(SpriteInstance), CHUNK_CELLS * sizeof(SpriteInstance), &tileInstances[first]);
+    chunkLoaded[chunkY][chunkX] = true;
 }
 
-void checkLevelCompletion() {
-    if (!levelComplete && collectiblesCollected >= totalCollectibles && totalCollectibles > 0) {
-        levelComplete = true;
-        std::cout << "All gold collected! Revealing exit ladder." << std::endl;
-        revealExitLadder();
-        // Add sound effect or visual cue here
-    }
+void onTileChanged(int gridX, int gridY) {
+    if (gridX < 0 && gridY < 0) markAllTilesDirty(); // Whole level rebuilt
+    else markTileDirty(gridX, gridY);
 }
 
-void revealExitLadder() {
-    // Find specific locations (e.g., above certain ladders at the top) and change EMPTY to EXIT_LADDER
-    for (int x = 0; x < GRID_WIDTH; ++x) {
-        // Example: Reveal ladder above the top-most regular ladders
-        if (level[GRID_HEIGHT - 2][x] == LADDER) { // Check row below the top empty space
-            if (level[GRID_HEIGHT - 1][x] == EMPTY || level[GRID_HEIGHT - 1][x] == LADDER) { // Ensure space above is empty or ladder
-                level[GRID_HEIGHT - 1][x] = EXIT_LADDER;
-                std::cout << "Exit ladder revealed at (" << x << ", " << GRID_HEIGHT - 1 << ")" << std::endl;
-            }
-        }
-        // Add more complex logic here if needed based on level design
+// Fills the cached instance for one cell. Empty cells become zero-sized quads,
+// so every cell keeps a fixed slot and the whole layer is one instanced draw.
+void buildTileInstance(int gridX, int gridY, SpriteInstance& instance) {
+    SpriteId sprite = SPRITE_BRICK;
+    bool draw = true;
+    float exitTintRB = 1.0f; // Red/blue reduction for the exit ladder's green tint
+    float refillTime = 0.0f;
+    float fadeDuration = 0.0f;
+
+    // Check if this tile is a dug hole
+    const DugHole& hole = world->dugHoles[gridY][gridX];
+    if (hole.active) {
+        // Draw digging effect: Darker background (Solid Brick texture tinted).
+        // The fade is evaluated in the shader from gameTime, so the cell is not rebuilt each frame.
+        sprite = SPRITE_SOLID_BRICK; // Use solid brick as background for hole
+        refillTime = world->gameTime + holeTimeLeft(gridX, gridY);
+        fadeDuration = DIG_REFILL_TIME;
     }
-    // Simple fallback: Place one exit ladder at top center if others fail
-    bool foundExit = false;
-    for (int x = 0; x < GRID_WIDTH; ++x) if (level[GRID_HEIGHT - 1][x] == EXIT_LADDER) foundExit = true;
-    if (!foundExit) {
-        int centerX = GRID_WIDTH / 2;
-        if (level[GRID_HEIGHT - 2][centerX] == LADDER || level[GRID_HEIGHT - 2][centerX] == EMPTY) {
-            level[GRID_HEIGHT - 1][centerX] = EXIT_LADDER;
-            std::cout << "Fallback exit ladder revealed at (" << centerX << ", " << GRID_HEIGHT - 1 << ")" << std::endl;
+    else {
+        // Not a dug hole, draw normally based on tile type
+        switch (world->level[gridY][gridX]) {
+        case BRICK:       sprite = SPRITE_BRICK; break;
+        case LADDER:      sprite = SPRITE_LADDER; break;
+        case ROPE:        sprite = SPRITE_ROPE; break; // Use rope texture
+        case SOLID_BRICK: sprite = SPRITE_SOLID_BRICK; break;
+        case EXIT_LADDER: sprite = SPRITE_LADDER; // Use ladder texture for exit
+            exitTintRB = 0.8f; // Light green tint
+            break;
+        case EMPTY:       // Fallthrough intentional
+        default:          draw = false; break; // Don't draw empty tiles
         }
     }
 
+    instance.x = static_cast<float>(gridX) * TILE_SIZE;
+    instance.y = static_cast<float>(gridY) * TILE_SIZE;
+    instance.width = draw ? TILE_SIZE : 0.0f;
+    instance.height = draw ? TILE_SIZE : 0.0f;
+    instance.flip = 1.0f; // Static grid tiles are never flipped
+    instance.layer = static_cast<float>(spriteLayers[sprite]);
+    instance.tint[0] = exitTintRB;
+    instance.tint[1] = 1.0f;
+    instance.tint[2] = exitTintRB;
+    instance.tint[3] = 1.0f;
+    instance.fade[0] = refillTime;
+    instance.fade[1] = fadeDuration;
 }
 
-void killEnemy(Entity& enemy) {
-    if (!enemy.isAlive) return; // Already dead/respawning
+// Loads the chunks in view that are not yet, then rebuilds only the dirty cells and
+// uploads them as contiguous slot ranges
+void updateTileLayer() {
+    int chunkX0, chunkY0, chunkX1, chunkY1;
+    getVisibleChunks(chunkX0, chunkY0, chunkX1, chunkY1);
+    for (int cy = chunkY0; cy <= chunkY1; ++cy) {
+        for (int cx = chunkX0; cx <= chunkX1; ++cx) {
+            if (!chunkLoaded[cy][cx]) loadChunk(cx, cy);
+        }
+    }
+    if (dirtyTiles.empty()) return; // Steady state: nothing to do
+
+    std::sort(dirtyTiles.begin(), dirtyTiles.end());
+    for (int slot : dirtyTiles) {
+        int chunk = slot / CHUNK_CELLS;
+        int x = (chunk % CHUNKS_X) * CHUNK_SIZE + slot % CHUNK_SIZE;
+        int y = (chunk / CHUNKS_X) * CHUNK_SIZE + (slot % CHUNK_CELLS) / CHUNK_SIZE;
+        buildTileInstance(x, y, tileInstances[slot]);
+        tileDirty[y][x] = false;
+    }
 
-    enemy.isAlive = false;
-    enemy.isTrapped = false; // Ensure not marked as trapped anymore
-    enemy.respawnTimer = ENEMY_RESPAWN_DELAY; // Start respawn timer
-    enemy.vx = 0;
-    enemy.vy = 0;
-    // Position will be reset when respawn timer finishes
-    std::cout << "Enemy marked for respawn." << std::endl;
+    bindArrayBuffer(vboTileInstances);
+    size_t runStart = 0;
+    for (size_t i = 1; i <= dirtyTiles.size(); ++i) {
+        // Close the run when the next index is not adjacent (or at the end)
+        if (i == dirtyTiles.size() || dirtyTiles[i] != dirtyTiles[i - 1] + 1) {
+            int first = dirtyTiles[runStart];
+            int count = dirtyTiles[i - 1] - first + 1;
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(SpriteInstance),
+                count * sizeof(SpriteInstance), &tileInstances[first]);
+            runStart = i;
+        }
+    }
+    dirtyTiles.clear();
 }
 
-
-// --- Drawing Functions ---
-
-// Draws a textured quad using the bound VAO and current shader program
-// Uses a model matrix to position, scale, and flip the quad
-void drawQuad(float x, float y, float width, float height, GLuint textureId, bool flipH) {
-    // Bind the specific texture to texture unit 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glUniform1i(glGetUniformLocation(shaderProgram, "textureSampler"), 0); // Tell shader sampler to use unit 0
-
-    // --- Create Model Matrix ---
-    // 1. Scale: Scale the base quad (1x1 centered at origin) to desired width/height
-    // 2. Flip: Apply horizontal flip if needed (scale X by -1)
-    // 3. Translate: Move the scaled quad to the desired world position (x, y)
-    // Note: OpenGL matrices are column-major. Order of multiplication is Translate * Rotate * Scale
-
-    // Identity matrix
-    float modelMatrix[16] = {
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
-
-    // 3. Translate to position (x, y) - Adjust for bottom-left origin
-    // The quad vertices are -0.5 to 0.5, so center is at 0,0.
-    // We want the bottom-left corner to be at (x, y).
-    float translateX = x + width / 2.0f;
-    float translateY = y + height / 2.0f;
-    modelMatrix[12] = translateX; // Apply translation in the last column
-    modelMatrix[13] = translateY;
-
-    // 2. Flip (Scale X by -1 if flipH is true)
-    float scaleX = width * (flipH ? -1.0f : 1.0f);
-    float scaleY = height;
-
-    // 1. Scale
-    // Apply scaling factors to the appropriate columns
-    modelMatrix[0] *= scaleX; // Scale X
-    modelMatrix[5] *= scaleY; // Scale Y
-
-    // --- Send Model Matrix to Shader ---
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, modelMatrix);
-
-    // --- Draw the Quad ---
-    // Assumes VAO with quad vertices/UVs is already bound
-    glDrawArrays(GL_TRIANGLES, 0, 6); // 6 vertices define the two triangles of the quad
-
-    // Unbind texture (optional, good practice)
-    glBindTexture(GL_TEXTURE_2D, 0);
+// Chunks overlapping the window at the current camera
+void getVisibleChunks(int& chunkX0, int& chunkY0, int& chunkX1, int& chunkY1) {
+    const float chunkPixels = CHUNK_SIZE * TILE_SIZE;
+    chunkX0 = std::max(static_cast<int>(cameraX / chunkPixels), 0);
+    chunkY0 = std::max(static_cast<int>(cameraY / chunkPixels), 0);
+    chunkX1 = std::min(static_cast<int>((cameraX + WINDOW_WIDTH - 1) / chunkPixels), CHUNKS_X - 1);
+    chunkY1 = std::min(static_cast<int>((cameraY + WINDOW_HEIGHT - 1) / chunkPixels), CHUNKS_Y - 1);
 }
 
-
+// Draws the static tile layer from its cached instance buffer, one call per row of
+// visible chunks. Expects the shader to be bound; restores vao for the sprite batch afterwards.
 void drawGrid() {
-    GLint tintLoc = glGetUniformLocation(shaderProgram, "tintColor");
-
-    for (int y = 0; y < GRID_HEIGHT; ++y) {
-        for (int x = 0; x < GRID_WIDTH; ++x) {
-            float drawX = static_cast<float>(x) * TILE_SIZE;
-            float drawY = static_cast<float>(y) * TILE_SIZE;
-            GLuint textureId = 0;
-            bool draw = true;
-            TileType currentTile = level[y][x];
-            glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // Reset tint
-
-            // Check if this tile is a dug hole
-            auto dugIt = dugHoles.find({ x, y });
-            if (dugIt != dugHoles.end()) {
-                // Draw digging effect: Darker background (Solid Brick texture tinted)
-                textureId = textures[5]; // Use solid brick as background for hole
-                float progress = dugIt->second.timer / DIG_REFILL_TIME; // 1 = just dug, 0 = about to refill
-                float tint = 0.2f + 0.3f * progress; // Fade from darker to slightly less dark
-                glUniform4f(tintLoc, tint, tint, tint, 1.0f); // Tint it gray/darker
-            }
-            else {
-                // Not a dug hole, draw normally based on tile type
-                switch (currentTile) {
-                case BRICK:       textureId = textures[0]; break;
-                case LADDER:      textureId = textures[1]; break;
-                case ROPE:        textureId = textures[6]; break; // Use rope texture
-                case SOLID_BRICK: textureId = textures[5]; break;
-                case EXIT_LADDER: textureId = textures[1]; // Use ladder texture for exit
-                    // Optional: Tint exit ladder differently
-                    glUniform4f(tintLoc, 0.8f, 1.0f, 0.8f, 1.0f); // Light green tint
-                    break;
-                case EMPTY:       // Fallthrough intentional
-                default:          draw = false; break; // Don't draw empty tiles
-                }
-            }
-
-            if (draw && textureId != 0) {
-                // Pass flipH = false for static grid tiles
-                drawQuad(drawX, drawY, TILE_SIZE, TILE_SIZE, textureId, false);
-            }
-        }
+    PROFILE_SCOPE(PROFILE_DRAW_GRID);
+    updateTileLayer();
+
+    int chunkX0, chunkY0, chunkX1, chunkY1;
+    getVisibleChunks(chunkX0, chunkY0, chunkX1, chunkY1);
+    bindVertexArray(vaoTiles);
+    bindArrayBuffer(vboTileInstances);
+    bindTextureArray(spriteAtlas);
+    for (int cy = chunkY0; cy <= chunkY1; ++cy) {
+        setInstanceAttribOffset((cy * CHUNKS_X + chunkX0) * CHUNK_CELLS);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (chunkX1 - chunkX0 + 1) * CHUNK_CELLS);
+        renderState.drawCalls++;
     }
-    // Reset tint after drawing grid
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f);
+    bindVertexArray(vao);
 }
 
 void drawEntities() {
-    GLint tintLoc = glGetUniformLocation(shaderProgram, "tintColor");
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // Ensure no default tint
-
+    PROFILE_SCOPE(PROFILE_DRAW_ENTITIES);
     // Draw player
-    if (player.isAlive) { // Player should always be alive unless game over logic changes
+    if (world->entities.isAlive[PLAYER]) { // Player should always be alive unless game over logic changes
         float playerWidth = TILE_SIZE * 0.8f;
         float playerHeight = TILE_SIZE * 0.95f;
         // Flip texture based on facing direction
-        drawQuad(player.x, player.y, playerWidth, playerHeight, textures[2], !player.faceRight);
+        drawSprite(interpolate(world->entities.prevX[PLAYER], world->entities.x[PLAYER]), interpolate(world->entities.prevY[PLAYER], world->entities.y[PLAYER]),
+            playerWidth, playerHeight, SPRITE_PLAYER, !world->entities.faceRight[PLAYER]);
     }
 
     // Draw enemies
-    for (int i = 0; i < numEnemies; ++i) {
-        if (enemies[i].isAlive) { // Only draw living enemies
+    for (int i = FIRST_ENEMY; i < world->entities.count; ++i) {
+        if (world->entities.isAlive[i]) { // Only draw living enemies
             float enemyWidth = TILE_SIZE * 0.8f;
             float enemyHeight = TILE_SIZE * 0.95f;
+            float drawX = interpolate(world->entities.prevX[i], world->entities.x[i]);
+            float drawY = interpolate(world->entities.prevY[i], world->entities.y[i]);
+            if (drawX + enemyWidth < cameraX || drawX > cameraX + WINDOW_WIDTH ||
+                drawY + enemyHeight < cameraY || drawY > cameraY + WINDOW_HEIGHT) continue; // Out of view
 
             // Tint slightly red if trapped (optional visual cue)
-            if (enemies[i].isTrapped) {
-                glUniform4f(tintLoc, 1.0f, 0.7f, 0.7f, 1.0f); // Light red tint
-            }
-            else {
-                glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // No tint
-            }
+            float gb = world->entities.isTrapped[i] ? 0.7f : 1.0f;
 
             // Flip texture based on facing direction
-            drawQuad(enemies[i].x, enemies[i].y, enemyWidth, enemyHeight, textures[3], !enemies[i].faceRight);
+            drawSprite(drawX, drawY, enemyWidth, enemyHeight, SPRITE_ENEMY, !world->entities.faceRight[i],
+                1.0f, gb, gb, 1.0f);
         }
     }
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // Reset tint
 }
 
-void drawCollectibles() {
-    GLint tintLoc = glGetUniformLocation(shaderProgram, "tintColor");
-    glUniform4f(tintLoc, 1.0f, 1.0f, 1.0f, 1.0f); // Ensure no tint
+// Position between the previous and current tick. Jumps of a tile or more are
+// teleports (respawn, reset after capture) and are drawn at the new position directly.
+float interpolate(float previous, float current) {
+    if (fabs(current - previous) >= TILE_SIZE) return current;
+    return previous + (current - previous) * frameClock.alpha;
+}
 
+void drawCollectibles() {
+    PROFILE_SCOPE(PROFILE_DRAW_COLLECTIBLES);
     float collectibleSize = TILE_SIZE * 0.6f; // Make gold smaller than tile
     float offsetX = (TILE_SIZE - collectibleSize) / 2.0f; // Center it horizontally
     float offsetY = TILE_SIZE * 0.1f; // Position slightly above bottom of cell
 
-    for (int y = 0; y < GRID_HEIGHT; ++y) {
-        for (int x = 0; x < GRID_WIDTH; ++x) {
-            if (collectibles[y][x] == 1) {
+    // Cells in view only
+    int x0 = std::max(static_cast<int>(cameraX / TILE_SIZE), 0);
+    int y0 = std::max(static_cast<int>(cameraY / TILE_SIZE), 0);
+    int x1 = std::min(static_cast<int>((cameraX + WINDOW_WIDTH - 1) / TILE_SIZE), GRID_WIDTH - 1);
+    int y1 = std::min(static_cast<int>((cameraY + WINDOW_HEIGHT - 1) / TILE_SIZE), GRID_HEIGHT - 1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            if (world->collectibles[y][x] == 1) {
                 float drawX = static_cast<float>(x) * TILE_SIZE + offsetX;
                 float drawY = static_cast<float>(y) * TILE_SIZE + offsetY;
                 // Add slight bobbing effect using gameTime
-                drawY += sin(gameTime * 4.0f + x * 0.5f) * TILE_SIZE * 0.08f;
-                drawQuad(drawX, drawY, collectibleSize, collectibleSize, textures[4], false);
+                drawY += sin(world->gameTime * 4.0f + x * 0.5f) * TILE_SIZE * 0.08f;
+                drawSprite(drawX, drawY, collectibleSize, collectibleSize, SPRITE_GOLD, false);
             }
         }
     }
@@ -1564,269 +1631,128 @@ void drawCollectibles() {
 
 
 void drawHUD() {
-    // --- Use fixed-function pipeline for text rendering (simpler than shader text) ---
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix(); // Save the current projection matrix (likely the shader's ortho)
-    glLoadIdentity();
-    gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT); // Set ortho mode for screen coordinates
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix(); // Save the current modelview matrix
-    glLoadIdentity();
-
-    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT); // Save enable states and color
-    glDisable(GL_DEPTH_TEST); // Draw HUD on top
-    glDisable(GL_TEXTURE_2D); // Don't need textures for basic text
-    glDisable(GL_LIGHTING);   // Ensure lighting is off if it were enabled
+    PROFILE_SCOPE(PROFILE_DRAW_HUD);
+    // Counters only rebuild their glyph quads when the value behind them changes
+    char buffer[64];
 
     // Draw Score
-    std::stringstream ssScore;
-    ssScore << "Score: " << score;
-    drawText(10, WINDOW_HEIGHT - 25, ssScore.str(), 1.0f, 1.0f, 0.0f); // Yellow text
+    if (labelNeedsLayout(scoreLabel, world->score)) {
+        snprintf(buffer, sizeof(buffer), "Score: %d", world->score);
+        layoutText(scoreLabel, 10, WINDOW_HEIGHT - 25, buffer, 1.0f, 1.0f, 0.0f); // Yellow text
+    }
+    drawLabel(scoreLabel);
 
     // Draw Lives
-    std::stringstream ssLives;
-    ssLives << "Lives: " << lives;
-    drawText(WINDOW_WIDTH - 100, WINDOW_HEIGHT - 25, ssLives.str(), 1.0f, 0.2f, 0.2f); // Red text
+    if (labelNeedsLayout(livesLabel, world->lives)) {
+        snprintf(buffer, sizeof(buffer), "Lives: %d", world->lives);
+        layoutText(livesLabel, WINDOW_WIDTH - 100, WINDOW_HEIGHT - 25, buffer, 1.0f, 0.2f, 0.2f); // Red text
+    }
+    drawLabel(livesLabel);
 
     // Draw Collectibles count
-    std::stringstream ssCollectibles;
-    ssCollectibles << "Gold: " << collectiblesCollected << " / " << totalCollectibles;
-    drawText(10, WINDOW_HEIGHT - 50, ssCollectibles.str(), 0.9f, 0.9f, 0.9f); // Light Gray text
-
+    if (labelNeedsLayout(goldLabel, world->collectiblesCollected, world->totalCollectibles)) {
+        snprintf(buffer, sizeof(buffer), "Gold: %d / %d", world->collectiblesCollected, world->totalCollectibles);
+        layoutText(goldLabel, 10, WINDOW_HEIGHT - 50, buffer, 0.9f, 0.9f, 0.9f); // Light Gray text
+    }
+    drawLabel(goldLabel);
 
     // Draw Game Over / You Win Message Centered
-    if (gameOver) {
-        std::string msg = "GAME OVER! Press 'R' to Restart";
-        // Estimate text width (GLUT doesn't provide an easy way, this is approximate)
-        float textWidth = msg.length() * 10.0f; // Adjust multiplier based on font size
-        drawText((WINDOW_WIDTH - textWidth) / 2, WINDOW_HEIGHT / 2, msg, 1.0f, 0.2f, 0.2f);
-    }
-    else if (gameWon) {
-        std::string msg = "YOU WIN! Press 'R' to Play Again";
-        float textWidth = msg.length() * 10.0f;
-        drawText((WINDOW_WIDTH - textWidth) / 2, WINDOW_HEIGHT / 2, msg, 0.2f, 1.0f, 0.2f);
+    int messageState = world->gameOver ? 1 : (world->gameWon ? 2 : 0);
+    if (messageState != 0) {
+        if (labelNeedsLayout(messageLabel, messageState)) {
+            const char* msg = world->gameOver ? "GAME OVER! Press 'R' to Restart"
+                : levelPack.levelCount > 1 ? "YOU WIN! Press 'R' for the Next Level" : "YOU WIN! Press 'R' to Play Again";
+            float textWidth = measureText(msg); // Exact, from the baked advances
+            if (world->gameOver) {
+                layoutText(messageLabel, (WINDOW_WIDTH - textWidth) / 2, WINDOW_HEIGHT / 2, msg, 1.0f, 0.2f, 0.2f);
+            }
+            else {
+                layoutText(messageLabel, (WINDOW_WIDTH - textWidth) / 2, WINDOW_HEIGHT / 2, msg, 0.2f, 1.0f, 0.2f);
+            }
+        }
+        drawLabel(messageLabel);
     }
-
-    // Restore previous OpenGL states
-    glPopAttrib(); // Restore enable states and color
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix(); // Restore projection matrix
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix(); // Restore modelview matrix
 }
 
-// Helper function to draw text using GLUT bitmap fonts
-// Note: This uses legacy OpenGL. For modern GL, use a text rendering library or texture atlases.
-void drawText(float x, float y, const std::string& text, float r, float g, float b) {
-    glColor3f(r, g, b);           // Set text color
-    glRasterPos2f(x, y);        // Set position for text rendering (bottom-left)
-
-    for (char c : text) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c); // Use a standard bitmap font
+// Lines of the P overlay, below the HUD counters. Averages are taken over the last
+// PROFILE_OVERLAY_FRAMES frames and refreshed once per that many, so they stay readable.
+void drawProfileOverlay() {
+    int refresh = static_cast<int>(currentProfileFrame() / PROFILE_OVERLAY_FRAMES);
+    if (labelNeedsLayout(profileLabels[0], refresh)) {
+        ProfileFrame average;
+        int frames = averageProfileFrames(PROFILE_OVERLAY_FRAMES, average);
+        char buffer[128];
+        float x = 10.0f;
+        float y = WINDOW_HEIGHT - 80.0f;
+        const float lineHeight = 20.0f;
+        const float r = 0.6f, g = 1.0f, b = 0.6f; // Light green
+
+        snprintf(buffer, sizeof(buffer), "Frame %.2f ms, %d ticks (mean of %d)", average.duration / 1000.0, average.counters[PROFILE_TICKS], frames);
+        layoutText(profileLabels[0], x, y, buffer, r, g, b);
+        for (int zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) {
+            snprintf(buffer, sizeof(buffer), "%s: %.3f ms x%d", profileZoneName(static_cast<ProfileZone>(zone)),
+                average.zoneTime[zone] / 1000.0, average.zoneCalls[zone]);
+            layoutText(profileLabels[1 + zone], x, y - lineHeight * (1 + zone), buffer, r, g, b);
+        }
+        int line = 1 + PROFILE_ZONE_COUNT;
+        if (average.gpuTime[PROFILE_GPU_TILES] < 0.0) snprintf(buffer, sizeof(buffer), "GPU: waiting for timer queries");
+        else snprintf(buffer, sizeof(buffer), "GPU tiles %.3f, sprites %.3f, HUD %.3f ms", average.gpuTime[PROFILE_GPU_TILES] / 1000.0,
+            average.gpuTime[PROFILE_GPU_SPRITES] / 1000.0, average.gpuTime[PROFILE_GPU_HUD] / 1000.0);
+        layoutText(profileLabels[line], x, y - lineHeight * line, buffer, r, g, b);
+        line++;
+        snprintf(buffer, sizeof(buffer), "Draw calls %d, state changes %d, skipped %d", average.counters[PROFILE_DRAW_CALLS],
+            average.counters[PROFILE_STATE_CHANGES], average.counters[PROFILE_SKIPPED_CALLS]);
+        layoutText(profileLabels[line], x, y - lineHeight * line, buffer, r, g, b);
     }
+    for (const TextLabel& label : profileLabels) drawLabel(label);
 }
 
-
-// --- Collision & Grid Interaction ---
-
-// Simple Axis-Aligned Bounding Box collision check
-bool isColliding(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
-    return (x1 < x2 + w2 &&
-        x1 + w1 > x2 &&
-        y1 < y2 + h2 &&
-        y1 + h1 > y2);
+// Returns true (and records the new values) if the label has to be laid out again
+bool labelNeedsLayout(TextLabel& label, int value0, int value1) {
+    if (label.valid && label.values[0] == value0 && label.values[1] == value1) return false;
+    label.values[0] = value0;
+    label.values[1] = value1;
+    return true;
 }
 
-// Gets the tile type at a specific world coordinate (x, y)
-// Takes dug holes into account.
-TileType getTileAt(float x, float y) {
-    int gridX = static_cast<int>(floor(x / TILE_SIZE));
-    int gridY = static_cast<int>(floor(y / TILE_SIZE));
-
-    // Bounds check
-    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) {
-        return SOLID_BRICK; // Treat out-of-bounds as solid
-    }
-
-    // Check for dug holes first - they act as EMPTY space for collision
-    auto it = dugHoles.find({ gridX, gridY });
-    if (it != dugHoles.end()) {
-        return EMPTY;
-    }
-
-    // Return the actual tile type from the level grid
-    return level[gridY][gridX];
-}
-
-// Helper to get grid X index from world X coordinate
-int getGridX(float x) {
-    return static_cast<int>(floor(x / TILE_SIZE));
-}
-// Helper to get grid Y index from world Y coordinate
-int getGridY(float y) {
-    return static_cast<int>(floor(y / TILE_SIZE));
-}
-
-
-// Check if the entity can move to the target (x, y) position.
-// Checks collision with solid tiles based on entity's bounding box.
-// `onRope` and `isClimbing` flags influence how ladders/ropes are treated.
-bool canMoveTo(float x, float y, float width, float height, bool onRope, bool isClimbing) {
-    // Check corners and center points of the entity's bounding box in the potential new position
-    float checkPointsX[] = { x, x + width / 2.0f, x + width };
-    float checkPointsY[] = { y, y + height / 2.0f, y + height };
-
-    for (float checkX : checkPointsX) {
-        for (float checkY : checkPointsY) {
-            // Don't check points exactly at the top/right edge if moving up/right?
-            // Check slightly inside maybe? For now, check edges.
-
-            TileType tile = getTileAt(checkX, checkY);
-
-            switch (tile) {
-            case BRICK:
-            case SOLID_BRICK:
-                // Collision with solid tile - cannot move here
-                // Exception: Allow moving slightly into a solid tile if climbing off a ladder? Needs care.
-                return false;
-            case LADDER:
-                // Allow passing through ladders if climbing, or moving horizontally
-                // Block vertical movement through ladder if not climbing? Physics handles this mostly.
-                break; // Generally passable, physics handles gravity/climbing speed
-            case ROPE:
-                // Allow passing horizontally if onRope is true.
-                // Block falling through rope unless moving off the edge.
-                // Block moving vertically onto a rope unless falling?
-                break; // Generally passable horizontally, physics handles falling
-            case EXIT_LADDER: // Treat like a regular ladder for collision
-                break;
-            case EMPTY:
-            default:
-                continue; // No collision with empty space
-            }
-        }
-    }
-
-    return true; // No solid collision detected
-}
-
-
-// Check if the entity is standing on solid ground (Brick, Solid Brick, or trapped enemy head)
-bool isOnGround(const Entity& entity) {
-    // Check slightly below the entity's feet at left, center, and right points
-    float entityWidth = TILE_SIZE * 0.8f;
-    float checkXLeft = entity.x + entityWidth * 0.1f;
-    float checkXCenter = entity.x + entityWidth * 0.5f;
-    float checkXRight = entity.x + entityWidth * 0.9f;
-    float checkY = entity.y - 1.0f; // Check 1 pixel below feet
-
-    TileType tileLeft = getTileAt(checkXLeft, checkY);
-    TileType tileCenter = getTileAt(checkXCenter, checkY);
-    TileType tileRight = getTileAt(checkXRight, checkY);
-
-    // Considered on ground if standing on Brick or Solid Brick
-    bool onSolidTile = (tileLeft == BRICK || tileLeft == SOLID_BRICK ||
-        tileCenter == BRICK || tileCenter == SOLID_BRICK ||
-        tileRight == BRICK || tileRight == SOLID_BRICK);
-
-    if (onSolidTile) return true;
-
-    // Check if standing on top of a trapped enemy's head
-    for (int i = 0; i < numEnemies; ++i) {
-        if (&entity != &enemies[i] && enemies[i].isTrapped) { // Check other entities that are trapped
-            float enemyHeadY = enemies[i].y + TILE_SIZE * 0.9f; // Approx head height
-            // Check if entity's feet are very close to the enemy's head Y
-            // and horizontally overlapping
-            if (fabs(entity.y - enemyHeadY) < 5.0f &&
-                entity.x + entityWidth > enemies[i].x &&
-                entity.x < enemies[i].x + TILE_SIZE * 0.8f)
-            {
-                return true; // Standing on trapped enemy head
-            }
-        }
+// Width of a string in pixels using the baked glyph advances
+float measureText(const char* text) {
+    float width = 0.0f;
+    for (const char* c = text; *c; ++c) {
+        int glyph = static_cast<unsigned char>(*c) - GLYPH_FIRST;
+        if (glyph >= 0 && glyph < GLYPH_COUNT) width += static_cast<float>(glyphAdvance[glyph]);
     }
+    return width;
+}
 
-    return false; // Not on solid tile or trapped enemy
-}
-
-// Check if the entity is overlapping with a ladder tile at its center column
-bool isOnLadder(const Entity& entity) {
-    float entityWidth = TILE_SIZE * 0.8f;
-    float entityHeight = TILE_SIZE * 0.95f;
-    float checkX = entity.x + entityWidth / 2.0f; // Center X
-    // Check multiple points vertically along the center line
-    float checkYBottom = entity.y + entityHeight * 0.1f; // Near feet
-    float checkYMiddle = entity.y + entityHeight * 0.5f; // Middle
-    float checkYTop = entity.y + entityHeight * 0.9f; // Near head
-
-    TileType tileBottom = getTileAt(checkX, checkYBottom);
-    TileType tileMiddle = getTileAt(checkX, checkYMiddle);
-    TileType tileTop = getTileAt(checkX, checkYTop);
-
-    // True if any central part overlaps with a ladder or exit ladder
-    return (tileBottom == LADDER || tileBottom == EXIT_LADDER ||
-        tileMiddle == LADDER || tileMiddle == EXIT_LADDER ||
-        tileTop == LADDER || tileTop == EXIT_LADDER);
-}
-
-// Check if the entity is overlapping with a rope tile near its vertical center
-// and is roughly horizontally aligned with it.
-bool checkOnRope(const Entity& entity) {
-    float entityWidth = TILE_SIZE * 0.8f;
-    float entityHeight = TILE_SIZE * 0.95f;
-    // Check near the middle of the entity horizontally and vertically
-    float checkX = entity.x + entityWidth / 2.0f;
-    float checkY = entity.y + entityHeight * 0.5f; // Check vertical center
-
-    TileType tileCenter = getTileAt(checkX, checkY);
-
-    // Check if the tile at the vertical center is a rope
-    if (tileCenter == ROPE) {
-        // Check if the entity's feet are reasonably close to the rope's level
-        int ropeGridY = getGridY(checkY);
-        float ropeCenterY = ropeGridY * TILE_SIZE + TILE_SIZE / 2.0f;
-        // Allow being slightly above/below the rope center while still considered "on" it
-        if (fabs(entity.y - ropeGridY * TILE_SIZE) < TILE_SIZE * 0.3f) {
-            return true;
+// Builds one quad per visible glyph, with (x, y) as the baseline start like glRasterPos
+void layoutText(TextLabel& label, float x, float y, const char* text, float r, float g, float b) {
+    label.glyphs.clear();
+    float penX = x;
+    for (const char* c = text; *c; ++c) {
+        int glyph = static_cast<unsigned char>(*c) - GLYPH_FIRST;
+        if (glyph < 0 || glyph >= GLYPH_COUNT) continue; // Not in the atlas
+        if (*c != ' ') { // Spaces only advance
+            SpriteInstance instance;
+            instance.x = penX;
+            instance.y = y - static_cast<float>(glyphDescent);
+            instance.width = static_cast<float>(glyphCellWidth);
+            instance.height = static_cast<float>(glyphCellHeight);
+            instance.flip = 1.0f;
+            instance.layer = static_cast<float>(glyph);
+            instance.tint[0] = r;
+            instance.tint[1] = g;
+            instance.tint[2] = b;
+            instance.tint[3] = 1.0f;
+            instance.fade[0] = 0.0f;
+            instance.fade[1] = 0.0f;
+            label.glyphs.push_back(instance);
         }
+        penX += static_cast<float>(glyphAdvance[glyph]);
     }
-    return false;
+    label.valid = true;
 }
 
-// Creates a dug hole at the specified grid coordinates if possible
-void digHole(int gridX, int gridY) {
-    // Check bounds
-    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) {
-        std::cerr << "Dig attempt out of bounds (" << gridX << ", " << gridY << ")" << std::endl;
-        return;
-    }
-
-    // Check if the tile is diggable (only BRICK)
-    if (level[gridY][gridX] == BRICK) {
-        // Check if there's already a hole being dug here
-        if (dugHoles.find({ gridX, gridY }) == dugHoles.end()) {
-            // Create a new dug hole entry
-            DugHole hole;
-            hole.gridX = gridX;
-            hole.gridY = gridY;
-            hole.timer = DIG_REFILL_TIME;
-            hole.originalType = BRICK; // Store original type (always brick)
-
-            dugHoles[{gridX, gridY}] = hole;
-            // Don't change level[y][x] here; getTileAt handles checking dugHoles.
-            // The visual representation is handled in drawGrid.
-
-            std::cout << "Dug hole initiated at (" << gridX << ", " << gridY << ")" << std::endl;
-            // Add digging sound effect here if possible
-        }
-        else {
-            // Optional: Prevent re-digging an existing hole? Or maybe reset timer?
-            // std::cout << "Already digging at (" << gridX << ", " << gridY << ")" << std::endl;
-        }
-    }
-    else {
-        std::cout << "Cannot dig non-brick tile type " << level[gridY][gridX] << " at (" << gridX << ", " << gridY << ")" << std::endl;
-    }
+void drawLabel(const TextLabel& label) {
+    queueInstances(glyphAtlas, label.glyphs.data(), static_cast<int>(label.glyphs.size()));
 }
@@ -0,0 +1,306 @@
+/**
+ * Lode Runner benchmarks
+ *
+ * Times the simulation's hot paths on their own (tile and collision queries, enemy
+ * updates, dig/refill churn, the enemy planner) and whole headless ticks, on the built-in
+ * level and on every level of a pack. Each benchmark restores the same starting world
+ * before every repetition and reports the median and fastest time per operation, so runs
+ * on one machine can be compared across changes: --save appends the results to a CSV
+ * history and --baseline compares against the latest entry for each benchmark in one.
+ *
+ * Options:
+ * --pack=FILE: Also run the per-level benchmarks on every level of a binary level pack
+ * --filter=TEXT: Only benchmarks whose name contains TEXT
+ * --repetitions=N: Timed repetitions per benchmark (default 9), after one warm-up
+ * --threads=N: Job system worker threads (default 0, so results do not depend on the machine's load)
+ * --save=FILE: Append the results to a CSV history (created with a header if missing)
+ * --label=TEXT: Name for this run in the history, e.g. a commit (default "-")
+ * --baseline=FILE: Compare with the latest result for each benchmark in a history
+ */
+
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "game.h"
+#include "jobs.h"
+#include "levelpack.h"
+#include "snapshot.h"
+
+// --- Harness ---
+struct BenchResult {
+    std::string name;
+    double medianNs, minNs; // Per operation
+    long ops;               // Operations per repetition
+};
+
+struct BenchOptions {
+    std::string filter;
+    int repetitions = 9;
+};
+
+// Runs setup() then body() (which returns the operations it did) for one warm-up and
+// `repetitions` timed repetitions; only body() is timed
+template <typename Setup, typename Body>
+void runBenchmark(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& name, Setup setup, Body body) {
+    if (name.find(options.filter) == std::string::npos) return;
+    std::vector<double> samples;
+    long ops = 0;
+    for (int repetition = -1; repetition < options.repetitions; ++repetition) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        ops = body();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (repetition >= 0 && ops > 0) samples.push_back(ns / ops);
+    }
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    results.push_back({ name, samples[samples.size() / 2], samples[0], ops });
+}
+
+// Keeps a value alive so the optimizer cannot drop the work that produced it
+volatile long benchSink = 0;
+
+// --- Worlds ---
+World benchWorld;
+WorldSnapshot* benchStart = nullptr; // World as the benchmark starts it, restored before each repetition
+
+const float TICK_TIME = 1.0f / DEFAULT_TICK_RATE;
+const int WARM_TICKS = 120; // Stepped before saving the start state, so enemies are spread out
+
+// Builds a session in benchWorld, plays `warmTicks` ticks without input and saves it as the start state
+void prepareWorld(const LevelView& level, int enemies, int warmTicks) {
+    world = &benchWorld;
+    world->numEnemies = enemies;
+    world->levelSource = level;
+    world->logEvents = false;
+    initGame(1);
+    for (int t = 0; t < warmTicks; ++t) stepSimulation(TICK_TIME, 0);
+    saveSnapshot(*benchStart);
+}
+
+void restoreStart() {
+    restoreSnapshot(*benchStart);
+}
+
+// --- Benchmarks ---
+
+// Tile and collision queries at random points of the map
+void benchQueries(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& suffix) {
+    const int POINTS = 4096;
+    std::vector<float> xs(POINTS), ys(POINTS);
+    float width = world->mapWidth * TILE_SIZE, height = world->mapHeight * TILE_SIZE;
+    for (int i = 0; i < POINTS; ++i) {
+        xs[i] = randomInt(static_cast<int>(width));
+        ys[i] = randomInt(static_cast<int>(height));
+    }
+    const int PASSES = 64;
+    runBenchmark(options, results, "getTileAt" + suffix, restoreStart, [&]() {
+        long sum = 0;
+        for (int pass = 0; pass < PASSES; ++pass) {
+            for (int i = 0; i < POINTS; ++i) sum += getTileAt(xs[i], ys[i]);
+        }
+        benchSink = sum;
+        return static_cast<long>(PASSES) * POINTS;
+    });
+    runBenchmark(options, results, "canMoveTo" + suffix, restoreStart, [&]() {
+        long sum = 0;
+        for (int pass = 0; pass < PASSES; ++pass) {
+            for (int i = 0; i < POINTS; ++i) sum += canMoveTo(xs[i], ys[i], TILE_SIZE * 0.8f, TILE_SIZE * 0.95f, false, false);
+        }
+        benchSink = sum;
+        return static_cast<long>(PASSES) * POINTS;
+    });
+}
+
+void benchGround(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& suffix) {
+    const int PASSES = 64;
+    runBenchmark(options, results, "isOnGround" + suffix, restoreStart, [&]() {
+        long sum = 0;
+        for (int pass = 0; pass < PASSES; ++pass) {
+            for (int e = 0; e < world->entities.count; ++e) sum += isOnGround(e);
+        }
+        benchSink = sum;
+        return static_cast<long>(PASSES) * world->entities.count;
+    });
+}
+
+// ns per updateEnemies() tick
+void benchEnemies(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& name) {
+    const int TICKS = 300;
+    runBenchmark(options, results, name, restoreStart, []() {
+        for (int t = 0; t < TICKS; ++t) updateEnemies(TICK_TIME);
+        return static_cast<long>(TICKS);
+    });
+}
+
+// ns per hole: every brick is dug at once, then updateTimers() runs until all have refilled
+void benchDigging(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& suffix) {
+    runBenchmark(options, results, "digRefill" + suffix, restoreStart, []() {
+        long holes = 0;
+        for (int y = 0; y < world->mapHeight; ++y) {
+            for (int x = 0; x < world->mapWidth; ++x) {
+                if (world->level[y][x] != BRICK || world->dugHoles[y][x].active) continue;
+                digHole(x, y);
+                holes++;
+            }
+        }
+        while (world->numActiveHoles > 0) updateTimers();
+        return holes;
+    });
+}
+
+// ns per full recompute of the flow field from scratch
+void benchFlowField(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& suffix) {
+    const int RECOMPUTES = 20;
+    runBenchmark(options, results, "flowRecompute" + suffix, restoreStart, []() {
+        for (int r = 0; r < RECOMPUTES; ++r) {
+            resetFlowField();
+            do updateFlowField(); while (world->flowQueueSize > 0);
+        }
+        return static_cast<long>(RECOMPUTES);
+    });
+}
+
+// ns per whole headless tick, as lode_runner_headless runs them
+void benchTicks(const BenchOptions& options, std::vector<BenchResult>& results, const std::string& suffix) {
+    const int TICKS = 1200;
+    runBenchmark(options, results, "tick" + suffix, restoreStart, []() {
+        int t = 0;
+        for (; t < TICKS && !world->gameOver && !world->gameWon; ++t) stepSimulation(TICK_TIME, 0);
+        return static_cast<long>(t);
+    });
+}
+
+// Everything measured on one level
+void benchLevel(const BenchOptions& options, std::vector<BenchResult>& results, const LevelView& level, const std::string& suffix) {
+    prepareWorld(level, DEFAULT_ENEMIES, WARM_TICKS);
+    benchQueries(options, results, suffix);
+    benchDigging(options, results, suffix);
+    benchFlowField(options, results, suffix);
+    benchTicks(options, results, suffix);
+    const int enemyCounts[] = { 3, 100, 1000 };
+    for (int enemies : enemyCounts) {
+        prepareWorld(level, enemies, WARM_TICKS);
+        std::string count = "/" + std::to_string(enemies);
+        if (enemies == 1000) benchGround(options, results, suffix + count);
+        benchEnemies(options, results, "updateEnemies" + suffix + count);
+    }
+}
+
+// --- History ---
+// CSV rows: time,label,benchmark,median_ns,min_ns,ops
+
+bool loadBaseline(const char* path, std::map<std::string, double>& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open baseline: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    std::getline(file, line); // Header
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        std::string field;
+        while (std::getline(row, field, ',')) fields.push_back(field);
+        if (fields.size() < 6) continue;
+        baseline[fields[2]] = atof(fields[3].c_str()); // Later rows win
+    }
+    return true;
+}
+
+bool saveResults(const char* path, const std::string& label, const std::vector<BenchResult>& results) {
+    bool exists = static_cast<bool>(std::ifstream(path));
+    std::ofstream out(path, std::ios::app);
+    if (!out) {
+        std::cerr << "Cannot write results: " << path << std::endl;
+        return false;
+    }
+    if (!exists) out << "time,label,benchmark,median_ns,min_ns,ops\n";
+    long long now = static_cast<long long>(std::time(nullptr));
+    for (const BenchResult& result : results) {
+        out << now << "," << label << "," << result.name << "," << result.medianNs << "," << result.minNs << "," << result.ops << "\n";
+    }
+    return static_cast<bool>(out.flush());
+}
+
+// --- Main ---
+int main(int argc, char** argv) {
+    BenchOptions options;
+    const char* packPath = nullptr;
+    const char* savePath = nullptr;
+    const char* baselinePath = nullptr;
+    std::string label = "-";
+    int workers = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--pack=", 0) == 0) packPath = argv[i] + 7;
+        else if (arg.rfind("--filter=", 0) == 0) options.filter = arg.substr(9);
+        else if (arg.rfind("--repetitions=", 0) == 0) {
+            int count = atoi(arg.c_str() + 14);
+            if (count >= 1 && count <= 1000) options.repetitions = count;
+            else std::cerr << "Ignoring out-of-range repetitions: " << arg << std::endl;
+        }
+        else if (arg.rfind("--threads=", 0) == 0) {
+            int count = atoi(arg.c_str() + 10);
+            if (count >= 0 && count <= 256) workers = count;
+            else std::cerr << "Ignoring out-of-range thread count: " << arg << std::endl;
+        }
+        else if (arg.rfind("--save=", 0) == 0) savePath = argv[i] + 7;
+        else if (arg.rfind("--label=", 0) == 0) {
+            label = arg.substr(8);
+            std::replace(label.begin(), label.end(), ',', ' '); // Keep the CSV's columns
+        }
+        else if (arg.rfind("--baseline=", 0) == 0) baselinePath = argv[i] + 11;
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath && !loadBaseline(baselinePath, baseline)) return 1;
+    LevelPack pack;
+    if (packPath && !openLevelPack(packPath, pack)) return 1;
+
+    startJobSystem(workers);
+    std::vector<WorldSnapshot> start(1); // About 450 KB, so not on the stack
+    benchStart = &start[0];
+
+    std::vector<BenchResult> results;
+    benchLevel(options, results, LevelView(), "");
+    for (int index = 0; index < pack.levelCount; ++index) {
+        LevelView level;
+        std::string name;
+        getPackLevel(pack, index, level, &name);
+        std::cout << "Level " << index << ": " << name << " (" << level.width << "x" << level.height << ")" << std::endl;
+        benchLevel(options, results, level, "@" + std::to_string(index));
+    }
+
+    printf("%-28s %12s %12s %10s %12s\n", "Benchmark", "median ns", "min ns", "ops/rep", "vs baseline");
+    for (const BenchResult& result : results) {
+        printf("%-28s %12.1f %12.1f %10ld", result.name.c_str(), result.medianNs, result.minNs, result.ops);
+        auto previous = baseline.find(result.name);
+        if (previous != baseline.end() && previous->second > 0.0) {
+            printf(" %+11.1f%%", (result.medianNs / previous->second - 1.0) * 100.0);
+        }
+        printf("\n");
+    }
+    printf("Built-in level and %d pack levels, %d repetitions, %d worker threads\n", pack.levelCount, options.repetitions, jobWorkerCount());
+    fflush(stdout);
+
+    if (savePath && saveResults(savePath, label, results)) std::cout << "Results appended to " << savePath << std::endl;
+    stopJobSystem();
+    closeLevelPack(pack);
+    return 0;
+}
@@ -0,0 +1,656 @@
+/**
+ * Lode Runner headless runner
+ *
+ * Steps the simulation (lode_runner_sim) as fast as possible with no window,
+ * OpenGL or GLUT, driven by scripted input. Meant for soak runs, AI experiments
+ * and measuring simulation cost on its own.
+ *
+ * Options:
+ * --ticks=N: Number of fixed ticks to run (default 36000, ten minutes at 60 Hz)
+ * --seed=S: Seed for the world's random generator (default 1, so runs are repeatable)
+ * --script=FILE: Input script, see below (default: no input)
+ * --tick-rate=N: Fixed simulation ticks per second (default 60)
+ * --enemies=N: Enemies to spawn (default 3, up to MAX_ENEMIES), for stress runs
+ * --worlds=N: Play N independent sessions, seeded S, S+1, ..., spread over the job
+ *   system's threads, and report aggregate throughput (implies --quiet)
+ * --threads=N: Job system worker threads (default: one per spare hardware thread);
+ *   results do not depend on it
+ * --pack=FILE: Play a level from a binary level pack instead of the built-in level
+ * --level=N: Level of the pack to play (default 0)
+ * --make-pack=TEXT,PACK: Compile a text level pack into a binary one and exit
+ * --record=FILE: Save the session's inputs as a recording (see replay.h)
+ * --replay=FILE: Play a recording from the game or --record at full speed, with its seed,
+ *   enemy count, tick rate and level (pass the same --pack), and check the outcome matches
+ * --rollback=N: After every tick, roll back N ticks from snapshots and resimulate them
+ *   (see snapshot.h); the outcome must not change, only the time taken
+ * --serve=PORT: Host the session for one client (the game or --connect) in real time,
+ *   until the game ends, the client leaves or --ticks have run (see net.h)
+ * --connect=HOST:PORT: Play a server's session as its client in real time, driven by
+ *   --script, and report rollbacks and bandwidth (pass the server's --pack)
+ * --fps=N: Run the ticks through the game's frame loop (see pacing.h) at N frames per
+ *   second, on a simulated clock and at full speed: each frame is timed by the game's
+ *   frame cadence, runs the ticks its time pays for (often none) and ends with the game's
+ *   keep-running and redraw decision. Fails if the loop would idle while the session is in
+ *   play, or keep running once it is over
+ * --profile-csv=FILE: Profile the update functions, one CSV row per tick (see profile.h)
+ * --profile-trace=FILE: Likewise as a Chrome trace (chrome://tracing, Perfetto)
+ * --log-level=LEVEL: Least severe event messages shown: debug (debug builds only), info
+ *   (default), warning, error or off (see log.h)
+ * --quiet: Suppress the simulation's event log
+ *
+ * Script format, one entry per line ('#' starts a comment):
+ *   <tick> <buttons>
+ * From <tick> on, hold <buttons> until the next entry. Buttons are any of
+ * L R U D (move), Q E (dig left/right) and J (jump), or '-' for none.
+ * Q, E and J fire once per entry, like a key press in the game.
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+
+#include "game.h"
+#include "jobs.h"
+#include "levelpack.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "net.h"
+#include "profile.h"
+#include "pacing.h"
+
+// --- Script ---
+struct ScriptEntry {
+    long tick;     // First tick the buttons apply to
+    uint8_t input; // InputBit mask
+};
+
+bool loadScript(const char* path, std::vector<ScriptEntry>& script) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open script: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        ScriptEntry entry;
+        std::string buttons;
+        if (!(fields >> entry.tick)) continue; // Blank or comment-only line
+        if (!(fields >> buttons) || entry.tick < 0 || (!script.empty() && entry.tick < script.back().tick)) {
+            std::cerr << path << ":" << lineNumber << ": expected '<tick> <buttons>' with ticks in order" << std::endl;
+            return false;
+        }
+
+        entry.input = 0;
+        for (char c : buttons) {
+            switch (toupper(c)) {
+            case 'L': entry.input |= INPUT_LEFT; break;
+            case 'R': entry.input |= INPUT_RIGHT; break;
+            case 'U': entry.input |= INPUT_UP; break;
+            case 'D': entry.input |= INPUT_DOWN; break;
+            case 'Q': entry.input |= INPUT_DIG_LEFT; break;
+            case 'E': entry.input |= INPUT_DIG_RIGHT; break;
+            case 'J': entry.input |= INPUT_JUMP; break;
+            case '-': break;
+            default:
+                std::cerr << path << ":" << lineNumber << ": unknown button '" << c << "'" << std::endl;
+                return false;
+            }
+        }
+        script.push_back(entry);
+    }
+    return true;
+}
+
+// Buttons for `tick`; call with ticks in order. One-shot presses stay in `held` until consumed.
+uint8_t scriptInput(const std::vector<ScriptEntry>& script, size_t& nextEntry, uint8_t& held, long tick) {
+    while (nextEntry < script.size() && script[nextEntry].tick <= tick) {
+        held = script[nextEntry].input;
+        nextEntry++;
+    }
+    return held;
+}
+
+// --- Sessions ---
+struct RunOptions {
+    long maxTicks;
+    float tickTime;
+    int enemies;
+    bool quiet; // Discard the session's event log
+    const std::vector<ScriptEntry>* script;
+    LevelView level; // Cells from a level pack, or none for the built-in level
+    const InputRecording* replay; // Input source instead of the script, if set
+    InputRecording* record;       // Filled with the session's inputs, if set (single session only)
+    int levelIndex;               // Stored in recordings
+    int rollback;                 // Ticks to roll back and resimulate after each tick, 0 for none
+    bool profile;                 // Profile the session, one frame per tick (single session only)
+    int frameRate;                // --fps: frames the ticks are paced by, 0 to step them directly
+};
+
+struct SessionResult {
+    long ticks;
+    bool won, lost;
+    int score, gold, totalGold, lives;
+    float playerX, playerY;
+    uint32_t startChecksum, endChecksum; // worldChecksum() after initGame() and at the end
+    long resimulatedTicks;               // Ticks stepped again by --rollback
+    long frames, emptyFrames, drawnFrames; // --fps: frames paced, those that ran no tick, those drawn
+    long stalledTick;                    // --fps: tick the frame loop idled before in play, -1 if none
+    bool keptRunning;                    // --fps: the frame loop went on after the session ended
+};
+
+// --fps: the game's update() loop on a simulated clock, with no time spent in a frame
+struct PacedFrames {
+    int frameRate;
+    float tickTime;
+    FrameClock clock;
+    FrameCadence cadence;
+    double now = 0.0;        // Simulated time (seconds)
+    double lastUpdate = 0.0; // When the current frame started
+    int owedTicks = 0;       // Ticks the current frame still has to run
+    int ranTicks = 0;        // Ticks it has run
+    bool started = false;    // A frame has begun
+};
+
+// Ends frames the way update() does and begins the next until one owes a tick; false once
+// the loop idles (the session is over, or it stalled: see SessionResult) or misbehaves.
+// A frame is cut short when the session ends, as its remaining ticks change nothing.
+bool nextPacedTick(PacedFrames& frames, long tick, SessionResult& result) {
+    for (;;) {
+        bool inPlay = !world->gameOver && !world->gameWon;
+        if (inPlay && frames.owedTicks > 0) {
+            frames.owedTicks--;
+            frames.ranTicks++;
+            return true;
+        }
+        if (frames.started) {
+            FrameState state;
+            state.ticks = frames.ranTicks;
+            state.sessionInPlay = inPlay;
+            state.alwaysActive = false;    // No replay in the game's sense, network or profiler overlay
+            state.redrawRequested = false; // No window events
+            state.windowVisible = true;
+            FrameDecision decision = endFrame(state);
+            if (decision.redraw) result.drawnFrames++;
+            if (!decision.schedule) {
+                if (inPlay) result.stalledTick = tick;
+                return false;
+            }
+            if (!inPlay) {
+                result.keptRunning = true;
+                return false;
+            }
+        }
+        else restartCadence(frames.cadence, frames.now); // main() before the first frame
+        // The frame timer fires exactly when asked
+        frames.now += nextFrameDelayMs(frames.cadence, frames.now, frames.frameRate) / 1000.0;
+        float frameTime = static_cast<float>(frames.now - frames.lastUpdate);
+        frames.lastUpdate = frames.now;
+        frames.owedTicks = takeFrameTicks(frames.clock, frameTime, frames.tickTime, 1);
+        frames.ranTicks = 0;
+        frames.started = true;
+        result.frames++;
+        if (frames.owedTicks == 0) result.emptyFrames++;
+    }
+}
+
+// --rollback: rewinds to `ticks` ago and steps forward again with the same inputs, as a
+// netcode client does when a late input arrives; returns the ticks resimulated
+long rollbackAndResimulate(SnapshotRing& ring, const std::vector<uint8_t>& inputs, int ticks, float tickTime) {
+    long now = world->tickCount;
+    long from = rollbackTo(ring, now - ticks);
+    if (from < 0) return 0; // Not that many ticks in yet
+    bool logEvents = world->logEvents;
+    world->logEvents = false; // The events were logged the first time round
+    for (long t = from; t < now; ++t) {
+        pushSnapshot(ring);
+        stepSimulation(tickTime, inputs[t]);
+    }
+    world->logEvents = logEvents;
+    return now - from;
+}
+
+// Plays one game in a World of its own until it ends or maxTicks have run
+void runSession(const RunOptions& options, unsigned int seed, SessionResult& result) {
+    World session;
+    World* caller = world;
+    world = &session;
+    world->numEnemies = options.enemies;
+    world->levelSource = options.level;
+    if (options.quiet) world->logEvents = false;
+    initGame(seed);
+    result.startChecksum = worldChecksum();
+    if (options.profile) startProfiler(); // On the thread running the session
+    if (options.record) beginRecording(*options.record, static_cast<int>(1.0f / options.tickTime + 0.5f), options.levelIndex);
+
+    SnapshotRing ring;
+    std::vector<uint8_t> inputs; // Mask passed on each tick so far, for resimulating
+    if (options.rollback > 0) initSnapshotRing(ring, options.rollback + 1);
+    result.resimulatedTicks = 0;
+    result.frames = 0;
+    result.emptyFrames = 0;
+    result.drawnFrames = 0;
+    result.stalledTick = -1;
+    result.keptRunning = false;
+    PacedFrames paced;
+    paced.frameRate = options.frameRate;
+    paced.tickTime = options.tickTime;
+
+    const std::vector<ScriptEntry>& script = *options.script;
+    size_t nextEntry = 0;
+    ReplayCursor cursor;
+    uint8_t held = 0;
+    long tick = 0;
+    for (; tick < options.maxTicks; ++tick) {
+        if (options.frameRate > 0) {
+            if (!nextPacedTick(paced, tick, result)) break;
+        }
+        else if (world->gameOver || world->gameWon) break;
+        if (options.profile && tick > 0) nextProfileFrame(); // stopProfiler() closes the last tick's
+        uint8_t input;
+        if (options.replay) {
+            // Recorded masks already have one-shot presses cleared where the game consumed them
+            if (!nextReplayInput(*options.replay, cursor, input)) break;
+        }
+        else {
+            input = scriptInput(script, nextEntry, held, tick);
+        }
+        if (options.record) recordInput(*options.record, input);
+        if (options.rollback > 0) {
+            pushSnapshot(ring);
+            inputs.push_back(input);
+        }
+        uint8_t consumed = stepSimulation(options.tickTime, input);
+        held &= ~(consumed & INPUT_ONE_SHOT);
+        if (options.rollback > 0) result.resimulatedTicks += rollbackAndResimulate(ring, inputs, options.rollback, options.tickTime);
+    }
+    if (options.profile) stopProfiler();
+    if (options.record) endRecording(*options.record);
+    result.endChecksum = worldChecksum();
+
+    result.ticks = tick;
+    result.won = world->gameWon;
+    result.lost = world->gameOver;
+    result.score = world->score;
+    result.gold = world->collectiblesCollected;
+    result.totalGold = world->totalCollectibles;
+    result.lives = world->lives;
+    result.playerX = world->entities.x[PLAYER];
+    result.playerY = world->entities.y[PLAYER];
+    world = caller;
+}
+
+// --- Network Sessions ---
+
+// Sleeps until `tick` is due, ticking in real time from `start`
+void waitForTick(std::chrono::steady_clock::time_point start, long tick, float tickTime) {
+    std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(tick * static_cast<double>(tickTime))));
+}
+
+void printResult() {
+    flushLog(); // The session's last events first
+    std::cout << "Result: " << (world->gameWon ? "won" : world->gameOver ? "game over" : "running")
+        << ", score " << world->score << ", gold " << world->collectiblesCollected << "/" << world->totalCollectibles
+        << ", lives " << world->lives << ", player at (" << world->entities.x[PLAYER] << ", " << world->entities.y[PLAYER] << ")" << std::endl;
+}
+
+// --serve: the authoritative session, stepped with the client's inputs as they arrive
+int runServer(const RunOptions& options, unsigned int seed, int port) {
+    NetServer server;
+    if (!startNetServer(server, port)) return 1;
+    std::cout << "Waiting for a client on port " << port << std::endl;
+    if (!acceptNetClient(server)) {
+        stopNetServer(server);
+        return 1;
+    }
+
+    World session;
+    world = &session;
+    world->numEnemies = options.enemies;
+    world->levelSource = options.level;
+    if (options.quiet) world->logEvents = false;
+    initGame(seed);
+    NetSessionInfo info;
+    info.seed = seed;
+    info.tickRate = static_cast<int>(1.0f / options.tickTime + 0.5f);
+    info.enemies = options.enemies;
+    info.level = options.levelIndex;
+    beginNetSession(server, info);
+    std::cout << "Client connected" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    long tick = 0;
+    for (; tick < options.maxTicks && !world->gameOver && !world->gameWon && netConnected(server.client); ++tick) {
+        waitForTick(start, tick, options.tickTime);
+        uint8_t input = nextNetInput(server);
+        uint8_t consumed = stepSimulation(options.tickTime, input);
+        sendNetFrame(server, input, consumed);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bool stayed = netConnected(server.client);
+    std::cout << "Served " << tick << " ticks" << (stayed ? "" : " (the client left)") << ": sent "
+        << server.client.bytesSent << " bytes";
+    if (seconds > 0.0) std::cout << " (" << server.client.bytesSent / seconds / 1024.0 << " KB/s)";
+    std::cout << ", " << server.lateInputs << " inputs arrived late" << std::endl;
+    printResult();
+    endNetSession(server);
+    stopNetServer(server);
+    return 0;
+}
+
+// --connect: predicts the server's session locally with the script's inputs
+int runClient(const RunOptions& options, NetClient& client) {
+    World session;
+    world = &session;
+    world->numEnemies = client.session.enemies;
+    world->levelSource = options.level;
+    if (options.quiet) world->logEvents = false;
+    initGame(client.session.seed);
+    if (!startNetClient(client)) {
+        stopNetClient(client);
+        return 1;
+    }
+
+    const std::vector<ScriptEntry>& script = *options.script;
+    size_t nextEntry = 0;
+    uint8_t held = 0;
+    auto start = std::chrono::steady_clock::now();
+    long tick = 0;
+    for (; tick < options.maxTicks && !client.finished; ++tick) {
+        waitForTick(start, tick, options.tickTime);
+        uint8_t consumed = stepNetClient(client, options.tickTime, scriptInput(script, nextEntry, held, world->tickCount));
+        held &= ~(consumed & INPUT_ONE_SHOT);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Played " << tick << " ticks as a client: " << client.rollbacks << " rollbacks (" << client.resimulatedTicks
+        << " ticks resimulated), " << client.corrections << " corrections";
+    if (seconds > 0.0) {
+        std::cout << "; received " << client.connection.bytesReceived / seconds / 1024.0 << " KB/s, sent "
+            << client.connection.bytesSent / seconds / 1024.0 << " KB/s";
+    }
+    std::cout << std::endl;
+    printResult();
+    stopNetClient(client);
+    return 0;
+}
+
+// Job body for --worlds: sessions [begin, end), seeded firstSeed + index
+struct BatchJob {
+    const RunOptions* options;
+    unsigned int firstSeed;
+    std::vector<SessionResult>* results;
+};
+
+void runBatch(int begin, int end, void* context) {
+    const BatchJob* job = static_cast<const BatchJob*>(context);
+    for (int k = begin; k < end; ++k) {
+        runSession(*job->options, job->firstSeed + static_cast<unsigned int>(k), (*job->results)[k]);
+    }
+}
+
+// --- Main Function ---
+int main(int argc, char** argv) {
+    long maxTicks = 36000;
+    unsigned int seed = 1;
+    int tickRate = DEFAULT_TICK_RATE;
+    int enemies = DEFAULT_ENEMIES;
+    int worlds = 1;
+    bool quiet = false;
+    int workers = -1;
+    const char* packPath = nullptr;
+    int levelIndex = 0;
+    const char* recordPath = nullptr;
+    int rollback = 0;
+    int frameRate = 0;
+    int servePort = 0;
+    const char* connectAddress = nullptr;
+    const char* profileCsvPath = nullptr;
+    const char* profileTracePath = nullptr;
+    bool replaying = false;
+    InputRecording replay;
+    std::vector<ScriptEntry> script;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--ticks=", 0) == 0) maxTicks = atol(arg.c_str() + 8);
+        else if (arg.rfind("--seed=", 0) == 0) seed = static_cast<unsigned int>(strtoul(arg.c_str() + 7, nullptr, 10));
+        else if (arg.rfind("--script=", 0) == 0) {
+            if (!loadScript(arg.c_str() + 9, script)) return 1;
+        }
+        else if (arg.rfind("--tick-rate=", 0) == 0) {
+            int rate = atoi(arg.c_str() + 12);
+            if (rate >= 10 && rate <= 1000) tickRate = rate;
+            else std::cerr << "Ignoring out-of-range tick rate: " << arg << std::endl;
+        }
+        else if (arg.rfind("--enemies=", 0) == 0) {
+            int count = atoi(arg.c_str() + 10);
+            if (count >= 0 && count <= MAX_ENEMIES) enemies = count;
+            else std::cerr << "Ignoring out-of-range enemy count: " << arg << std::endl;
+        }
+        else if (arg.rfind("--worlds=", 0) == 0) {
+            int count = atoi(arg.c_str() + 9);
+            if (count >= 1) worlds = count;
+            else std::cerr << "Ignoring out-of-range world count: " << arg << std::endl;
+        }
+        else if (arg.rfind("--threads=", 0) == 0) {
+            int count = atoi(arg.c_str() + 10);
+            if (count >= 0 && count <= 256) workers = count;
+            else std::cerr << "Ignoring out-of-range thread count: " << arg << std::endl;
+        }
+        else if (arg.rfind("--pack=", 0) == 0) packPath = argv[i] + 7;
+        else if (arg.rfind("--level=", 0) == 0) levelIndex = atoi(arg.c_str() + 8);
+        else if (arg.rfind("--make-pack=", 0) == 0) {
+            size_t comma = arg.find(',');
+            if (comma == std::string::npos) {
+                std::cerr << "Expected --make-pack=TEXT,PACK" << std::endl;
+                return 1;
+            }
+            std::string textPath = arg.substr(12, comma - 12);
+            return compileLevelPack(textPath.c_str(), arg.c_str() + comma + 1) ? 0 : 1;
+        }
+        else if (arg.rfind("--record=", 0) == 0) recordPath = argv[i] + 9;
+        else if (arg.rfind("--replay=", 0) == 0) {
+            if (!loadRecording(argv[i] + 9, replay)) return 1;
+            replaying = true;
+        }
+        else if (arg.rfind("--rollback=", 0) == 0) {
+            int count = atoi(arg.c_str() + 11);
+            if (count >= 0 && count <= 600) rollback = count;
+            else std::cerr << "Ignoring out-of-range rollback: " << arg << std::endl;
+        }
+        else if (arg.rfind("--serve=", 0) == 0) {
+            servePort = atoi(arg.c_str() + 8);
+            if (servePort <= 0 || servePort > 65535) {
+                std::cerr << "Expected --serve=PORT" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.rfind("--connect=", 0) == 0) connectAddress = argv[i] + 10;
+        else if (arg.rfind("--fps=", 0) == 0) {
+            int rate = atoi(arg.c_str() + 6);
+            if (rate >= 10 && rate <= 1000) frameRate = rate;
+            else std::cerr << "Ignoring out-of-range frame rate: " << arg << std::endl;
+        }
+        else if (arg.rfind("--profile-csv=", 0) == 0) profileCsvPath = argv[i] + 14;
+        else if (arg.rfind("--profile-trace=", 0) == 0) profileTracePath = argv[i] + 16;
+        else if (arg.rfind("--log-level=", 0) == 0) {
+            LogLevel logLevel;
+            if (!parseLogLevel(arg.c_str() + 12, logLevel)) {
+                std::cerr << "Expected --log-level=debug|info|warning|error|off" << std::endl;
+                return 1;
+            }
+            setLogLevel(logLevel);
+        }
+        else if (arg == "--quiet") quiet = true;
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // A replay brings its own session settings
+    if (replaying) {
+        seed = replay.seed;
+        enemies = replay.enemies;
+        tickRate = replay.tickRate;
+        levelIndex = replay.level;
+        maxTicks = replay.ticks;
+        worlds = 1;
+        if (levelIndex < 0) packPath = nullptr; // Recorded on the built-in level
+        else if (!packPath) {
+            std::cerr << "The recording was made on level " << levelIndex << " of a pack; pass it with --pack" << std::endl;
+            return 1;
+        }
+    }
+    if (recordPath && worlds > 1) {
+        std::cerr << "--record needs a single session" << std::endl;
+        return 1;
+    }
+    bool profiling = profileCsvPath || profileTracePath;
+    if (profiling && (worlds > 1 || servePort || connectAddress)) {
+        std::cerr << "--profile-csv and --profile-trace need a single local session" << std::endl;
+        return 1;
+    }
+
+    // A client plays the server's session
+    NetClient client;
+    if ((servePort || connectAddress) && (worlds > 1 || replaying || recordPath || rollback || frameRate)) {
+        std::cerr << "--serve and --connect play one live session, without --worlds, --replay, --record, --rollback or --fps" << std::endl;
+        return 1;
+    }
+    if (connectAddress) {
+        std::string address = connectAddress;
+        size_t colon = address.rfind(':');
+        std::string host = colon == std::string::npos ? address : address.substr(0, colon);
+        int port = colon == std::string::npos ? NET_DEFAULT_PORT : atoi(address.c_str() + colon + 1);
+        if (!connectNetClient(client, host.c_str(), port)) return 1;
+        seed = client.session.seed;
+        enemies = client.session.enemies;
+        tickRate = client.session.tickRate;
+        levelIndex = client.session.level;
+        if (levelIndex < 0) packPath = nullptr;
+        else if (!packPath) {
+            std::cerr << "The server plays level " << levelIndex << " of a pack; pass it with --pack" << std::endl;
+            return 1;
+        }
+    }
+
+    // The pack stays mapped for the whole run; every session reads the same cells
+    LevelPack pack;
+    LevelView level;
+    if (packPath) {
+        std::string levelName;
+        if (!openLevelPack(packPath, pack)) return 1;
+        if (!getPackLevel(pack, levelIndex, level, &levelName)) {
+            std::cerr << packPath << ": no level " << levelIndex << " (the pack has " << pack.levelCount << ")" << std::endl;
+            return 1;
+        }
+        std::cout << "Level " << levelIndex << ": " << levelName << " (" << level.width << "x" << level.height << ")" << std::endl;
+    }
+
+    startJobSystem(workers);
+    startLogger();
+    atexit(stopLogger);
+
+    // The simulation logs events through the asynchronous log; --quiet silences the
+    // session's, as do batches (the sessions' logs would interleave)
+    InputRecording recording;
+    RunOptions options = { maxTicks, 1.0f / static_cast<float>(tickRate), enemies, quiet || worlds > 1, &script, level,
+        replaying ? &replay : nullptr, recordPath ? &recording : nullptr, packPath ? levelIndex : -1, rollback, profiling, frameRate };
+    if (servePort || connectAddress) {
+        int status = servePort ? runServer(options, seed, servePort) : runClient(options, client);
+        stopJobSystem();
+        closeLevelPack(pack);
+        return status;
+    }
+    std::vector<SessionResult> results(worlds);
+    BatchJob batch = { &options, seed, &results };
+    auto startTime = std::chrono::high_resolution_clock::now();
+    parallelFor(worlds, 1, runBatch, &batch); // One session per job, so workers steal whole games
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    flushLog(); // Events before the summary
+
+    long totalTicks = 0;
+    for (const SessionResult& result : results) totalTicks += result.ticks;
+    if (worlds == 1) {
+        std::cout << "Ran " << totalTicks << " ticks (" << totalTicks * options.tickTime << " s game time) in " << seconds * 1000.0 << " ms";
+    }
+    else {
+        std::cout << "Ran " << worlds << " worlds, " << totalTicks << " ticks in total, in " << seconds * 1000.0 << " ms";
+    }
+    if (seconds > 0.0) std::cout << ", " << static_cast<long>(totalTicks / seconds) << " ticks/s";
+    std::cout << " with " << jobWorkerCount() << " worker threads" << std::endl;
+
+    int failed = 0; // Sessions whose frame loop idled in play or ran on after the end
+    if (frameRate > 0) {
+        long frames = 0, emptyFrames = 0, drawnFrames = 0;
+        for (const SessionResult& result : results) {
+            frames += result.frames;
+            emptyFrames += result.emptyFrames;
+            drawnFrames += result.drawnFrames;
+            if (result.stalledTick < 0 && !result.keptRunning) continue;
+            if (failed++ > 0) continue; // Report the first
+            if (result.stalledTick >= 0) std::cout << "The frame loop idled at tick " << result.stalledTick << " with the session in play" << std::endl;
+            else std::cout << "The frame loop kept running after the session ended" << std::endl;
+        }
+        std::cout << "Paced by " << frames << " frames at " << frameRate << " fps: " << emptyFrames << " without a tick, "
+            << drawnFrames << " drawn";
+        if (failed > 1) std::cout << "; " << failed << " sessions failed";
+        std::cout << std::endl;
+    }
+
+    if (worlds == 1) {
+        const SessionResult& result = results[0];
+        std::cout << "Result: " << (result.won ? "won" : result.lost ? "game over" : "running")
+            << ", score " << result.score << ", gold " << result.gold << "/" << result.totalGold
+            << ", lives " << result.lives << ", player at (" << result.playerX << ", " << result.playerY << ")" << std::endl;
+        if (rollback > 0) {
+            std::cout << "Rolled back " << rollback << " ticks after every tick, " << result.resimulatedTicks << " ticks resimulated" << std::endl;
+        }
+        if (replaying) {
+            if (result.startChecksum != replay.startChecksum) std::cout << "Replay warning: the level or settings differ from the recording's" << std::endl;
+            std::cout << "Replay " << (result.endChecksum == replay.endChecksum ? "reproduced" : "DIVERGED from")
+                << " the recorded session (" << replay.ticks << " ticks)" << std::endl;
+        }
+        if (recordPath && saveRecording(recordPath, recording)) {
+            std::cout << "Recorded " << recording.ticks << " ticks in " << recording.runs.size() << " input runs to " << recordPath << std::endl;
+        }
+        if (profiling) {
+            ProfileFrame average;
+            int frames = averageProfileFrames(PROFILE_HISTORY_FRAMES, average);
+            std::cout << "Mean per tick over the last " << frames << ":";
+            for (int zone = PROFILE_HANDLE_INPUT; zone <= PROFILE_UPDATE_TIMERS; ++zone) {
+                std::cout << " " << profileZoneName(static_cast<ProfileZone>(zone)) << " " << average.zoneTime[zone] << " us";
+            }
+            std::cout << std::endl;
+            if (profileCsvPath && writeProfileCsv(profileCsvPath)) std::cout << "Profile written to " << profileCsvPath << std::endl;
+            if (profileTracePath && writeProfileTrace(profileTracePath)) std::cout << "Trace written to " << profileTracePath << std::endl;
+        }
+    }
+    else {
+        int won = 0, lost = 0;
+        long totalScore = 0;
+        for (const SessionResult& result : results) {
+            if (result.won) won++;
+            else if (result.lost) lost++;
+            totalScore += result.score;
+        }
+        std::cout << "Results: " << won << " won, " << lost << " game over, " << (worlds - won - lost) << " running"
+            << ", mean score " << static_cast<double>(totalScore) / worlds << std::endl;
+    }
+    stopJobSystem();
+    closeLevelPack(pack);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,1691 @@
+/**
+ * Lode Runner simulation: level setup, fixed-tick stepping, physics, enemies and digging.
+ * See game.h.
+ */
+
+#include "game.h"
+#include "jobs.h"
+#include "profile.h"
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>    // std::min/std::max for planner keys and cell clamps
+#include <cstdlib>
+#include <cstring>      // std::memcpy for flag loads, strlen for level rows
+
+// SSE2 is baseline on x64; 32-bit MSVC reports it through _M_IX86_FP
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LODE_RUNNER_SSE2 1
+#include <emmintrin.h>
+#else
+#define LODE_RUNNER_SSE2 0
+#endif
+
+// --- Current World ---
+thread_local World* world = nullptr;
+
+// --- Initialization Functions ---
+
+void initGame(unsigned int seed) {
+    world->seed = seed;
+    // Spread nearby seeds apart (xorshift needs a non-zero state)
+    world->rngState = seed * 2654435761u ^ 0x9E3779B9u;
+    if (world->rngState == 0) world->rngState = 1;
+    world->tickCount = 0;
+    resetTimers();
+    clearDugHoles(); // Before initLevel() so the masks and nav graph see no stale holes
+    initLevel();
+    initEntities();
+
+    // Reset game state
+    world->score = 0;
+    world->lives = INITIAL_LIVES;
+    world->collectiblesCollected = 0;
+    world->gameOver = false;
+    world->gameWon = false;
+    world->levelComplete = false;
+    world->gameTime = 0.0f;
+}
+
+void initLevel() {
+    if (world->numEnemies < 0) world->numEnemies = 0;
+    if (world->numEnemies > MAX_ENEMIES) world->numEnemies = MAX_ENEMIES;
+    resizeEntities(FIRST_ENEMY + world->numEnemies);
+    world->totalCollectibles = 0;
+    world->levelComplete = false; // Reset level completion flag
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            world->level[y][x] = EMPTY;
+            world->collectibles[y][x] = 0;
+        }
+    }
+
+    // Built-in Lode Runner-style level, used unless levelSource is set (e.g. from a level pack)
+    // S = Solid, B = Brick, L = Ladder, R = Rope, C = Gold (on Brick), E = Empty, P = Player Start, X = Enemy Start
+    // Note: Y=0 is the BOTTOM row
+    const char* levelLayout[] = {
+       "SSSSSSSSSSSSSSSSSSSS", // 14 - Top boundary (Solid) - Exit area
+       "SEEEEEEEEEEEEEEEEEES", // 13 - Potential Exit Ladder spots
+       "SCBBCBBLBBBBBLBBCBCS", // 12
+       "SLRRRRRLRRRRRLRRRRRS", // 11
+       "SL C C L C C L C C LS", // 10
+       "SCBBLBBBLELBBBBLBBBS", // 9
+       "SRRRRR C L C C RRCRRS", // 8
+       "SE E E B L B E E E ES", // 7
+       "SBBBEBBBLBLBBBBBBBBS", // 6
+       "SC RRRR L L RRRRR CS", // 5
+       "SE E E B L B E E E ES", // 4
+       "SBCBEBBBLBLBBBEBBEBS", // 3 - Player start area
+       "SXXXXXXELPBLXXXXXXBS", // 2 - Enemy start area, Player start 'P'
+       "SEEEEE B B B EEEEEES", // 1
+       "SSSSSSSSSSSSSSSSSSSS"  // 0 - Ground (Solid)
+    };
+
+
+    // The built-in level's width is its top wall's; longer rows are cut and missing cells stay empty
+    const LevelView& source = world->levelSource;
+    int layoutHeight = source.cells ? source.height : static_cast<int>(sizeof(levelLayout) / sizeof(levelLayout[0]));
+    int layoutWidth = source.cells ? source.width : static_cast<int>(strlen(levelLayout[0]));
+    world->mapWidth = std::min(layoutWidth, GRID_WIDTH);
+    world->mapHeight = std::min(layoutHeight, GRID_HEIGHT);
+    int playerStartX = 1, playerStartY = 3; // Default player start if 'P' not found
+    std::vector<std::pair<int, int>> enemyStartPositions;
+
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        // Rows are listed top first; the map's bottom row is y = 0, so a map taller than the
+        // grid loses its top rows
+        int layoutY = layoutHeight - 1 - y;
+        const char* row = nullptr;
+        int rowLength = 0;
+        if (y < world->mapHeight) {
+            row = source.cells ? source.cells + static_cast<size_t>(layoutY) * source.width : levelLayout[layoutY];
+            rowLength = source.cells ? source.width : static_cast<int>(strlen(row));
+            if (rowLength > world->mapWidth) rowLength = world->mapWidth;
+        }
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            if (!row || x >= world->mapWidth) world->level[y][x] = SOLID_BRICK; // Grid cells outside the map
+            if (x >= rowLength) continue;
+
+            char tileChar = row[x];
+            switch (tileChar) {
+            case 'S': world->level[y][x] = SOLID_BRICK; break;
+            case 'B': world->level[y][x] = BRICK; break;
+            case 'L': world->level[y][x] = LADDER; break;
+            case 'R': world->level[y][x] = ROPE; break;
+            case 'C':
+                world->level[y][x] = BRICK; // Place gold ON a brick
+                if (y + 1 < world->mapHeight) { // Ensure space above for the visual
+                    world->collectibles[y + 1][x] = 1; // Place collectible visual *above* the brick
+                    world->totalCollectibles++;
+                }
+                else { // If gold is on the top row of bricks, place it there
+                    world->collectibles[y][x] = 1;
+                    world->totalCollectibles++;
+                }
+                break;
+            case 'P': // Explicit Player start
+                playerStartX = x;
+                playerStartY = y;
+                world->level[y][x] = EMPTY; // Start position should be empty
+                break;
+            case 'X': // Enemy start position marker
+                enemyStartPositions.push_back({ x, y });
+                world->level[y][x] = EMPTY; // Keep the space empty
+                break;
+            case 'E': // Fallthrough intentional
+            default:  world->level[y][x] = EMPTY; break;
+            }
+        }
+    }
+    rebuildTileMasks();
+    compileNavGraph();
+    notifyTileChanged(-1, -1); // Whole tile layer changed
+    EVENT_INFO("Level initialized. Total Collectibles: %d", world->totalCollectibles);
+
+    // Store player start position (used in initEntities)
+    world->entities.startGridX[PLAYER] = playerStartX;
+    world->entities.startGridY[PLAYER] = playerStartY;
+
+    // Store enemy start positions (used in initEntities)
+    // Assign starting positions to enemies, cycling through markers if needed
+    for (int i = FIRST_ENEMY; i < world->entities.count; ++i) {
+        if (!enemyStartPositions.empty()) {
+            size_t marker = (i - FIRST_ENEMY) % enemyStartPositions.size();
+            world->entities.startGridX[i] = enemyStartPositions[marker].first;
+            world->entities.startGridY[i] = enemyStartPositions[marker].second;
+        }
+        else {
+            // Fallback if no 'X' markers
+            world->entities.startGridX[i] = world->mapWidth - 2 - (i - FIRST_ENEMY) % std::max(world->mapWidth - 2, 1);
+            world->entities.startGridY[i] = 2;
+            LOG_WARNING("No 'X' markers found for enemy start positions. Using fallback.");
+        }
+    }
+}
+
+void initEntities() {
+
+    // Place player at start position defined in level or default
+    world->entities.x[PLAYER] = world->entities.startGridX[PLAYER] * TILE_SIZE + (TILE_SIZE * 0.1f); // Position bottom-left
+    world->entities.y[PLAYER] = world->entities.startGridY[PLAYER] * TILE_SIZE;
+    world->entities.prevX[PLAYER] = world->entities.x[PLAYER];
+    world->entities.prevY[PLAYER] = world->entities.y[PLAYER];
+    world->entities.vx[PLAYER] = 0.0f;
+    world->entities.vy[PLAYER] = 0.0f;
+    world->entities.isJumping[PLAYER] = false; // Removed
+    world->entities.isClimbing[PLAYER] = false;
+    world->entities.isOnRope[PLAYER] = false;
+    world->entities.isFalling[PLAYER] = false;
+    world->entities.faceRight[PLAYER] = true;
+    world->entities.isTrapped[PLAYER] = false;
+    world->entities.isAlive[PLAYER] = true; // Player is always "alive" in this context
+    cancelTimer(TIMER_ENTITY_BASE + PLAYER);
+
+
+    // Initialize enemies at their designated start positions
+    for (int i = FIRST_ENEMY; i < world->entities.count; ++i) {
+        world->entities.x[i] = world->entities.startGridX[i] * TILE_SIZE + (TILE_SIZE * 0.1f);
+        world->entities.y[i] = world->entities.startGridY[i] * TILE_SIZE;
+        world->entities.prevX[i] = world->entities.x[i];
+        world->entities.prevY[i] = world->entities.y[i];
+        world->entities.vx[i] = (randomInt(2) == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // Random initial horizontal velocity
+        world->entities.vy[i] = 0.0f;
+        world->entities.isClimbing[i] = false;
+        world->entities.isOnRope[i] = false;
+        world->entities.isFalling[i] = false;
+        world->entities.faceRight[i] = (world->entities.vx[i] > 0);
+        world->entities.isTrapped[i] = false;
+        world->entities.isAlive[i] = true;
+        cancelTimer(TIMER_ENTITY_BASE + i);
+    }
+    updateEntityLists();
+    buildSpatialIndex();
+    EVENT_INFO("Entities initialized.");
+}
+
+// --- Entity Store ---
+
+void resizeEntities(int count) {
+    world->entities.count = count;
+    world->entities.x.assign(count, 0.0f);
+    world->entities.y.assign(count, 0.0f);
+    world->entities.prevX.assign(count, 0.0f);
+    world->entities.prevY.assign(count, 0.0f);
+    world->entities.vx.assign(count, 0.0f);
+    world->entities.vy.assign(count, 0.0f);
+    world->entities.nextX.assign(count, 0.0f);
+    world->entities.nextY.assign(count, 0.0f);
+    world->entities.isClimbing.assign(count, 0);
+    world->entities.isOnRope.assign(count, 0);
+    world->entities.isFalling.assign(count, 0);
+    world->entities.isJumping.assign(count, 0);
+    world->entities.faceRight.assign(count, 0);
+    world->entities.isTrapped.assign(count, 0);
+    world->entities.isAlive.assign(count, 0);
+    world->entities.isDormant.assign(count, 0);
+    world->entities.sleepTime.assign(count, 0.0f);
+    world->entities.startGridX.assign(count, 0);
+    world->entities.startGridY.assign(count, 0);
+    world->activeEnemies.reserve(count);
+    world->distantEnemies.reserve(count);
+    world->dormantEnemies.reserve(count);
+    world->trappedEnemies.reserve(count);
+    world->spatialEntities.reserve(count);
+    world->spatialCellOf.assign(count, 0);
+}
+
+void updateEntityLists() {
+    world->activeEnemies.clear();
+    world->distantEnemies.clear();
+    world->dormantEnemies.clear();
+    world->trappedEnemies.clear();
+
+    // Cells stepped every tick: the view around the player plus a margin. On maps no larger
+    // than the view this is the whole map, so nothing is ever distant.
+    float viewX, viewY;
+    getViewOrigin(world->entities.x[PLAYER] + TILE_SIZE * 0.4f, world->entities.y[PLAYER] + TILE_SIZE * 0.475f, viewX, viewY);
+    int nearX0 = static_cast<int>(viewX / TILE_SIZE) - ENEMY_LOD_MARGIN;
+    int nearY0 = static_cast<int>(viewY / TILE_SIZE) - ENEMY_LOD_MARGIN;
+    int nearX1 = static_cast<int>(ceilf(viewX / TILE_SIZE)) + VIEW_WIDTH - 1 + ENEMY_LOD_MARGIN;
+    int nearY1 = static_cast<int>(ceilf(viewY / TILE_SIZE)) + VIEW_HEIGHT - 1 + ENEMY_LOD_MARGIN;
+    bool allNear = nearX0 <= 0 && nearY0 <= 0 && nearX1 >= world->mapWidth - 1 && nearY1 >= world->mapHeight - 1;
+
+    for (int i = FIRST_ENEMY; i < world->entities.count; ++i) {
+        world->entities.isDormant[i] = false;
+        if (!world->entities.isAlive[i]) continue; // Waiting for its respawn timer
+        if (world->entities.isTrapped[i]) {
+            world->trappedEnemies.push_back(i);
+            continue;
+        }
+        bool near = allNear;
+        if (!near) {
+            int gridX, gridY;
+            getEntityCell(i, gridX, gridY);
+            near = gridX >= nearX0 && gridX <= nearX1 && gridY >= nearY0 && gridY <= nearY1;
+        }
+        if (near && world->entities.sleepTime[i] == 0.0f) {
+            world->activeEnemies.push_back(i);
+            continue;
+        }
+        // Distant: stays out of the every-tick batch and catches up one tick in ENEMY_LOD_INTERVAL,
+        // or straight away once near again
+        world->entities.isDormant[i] = true;
+        if (near || (world->tickCount + i) % ENEMY_LOD_INTERVAL == 0) world->distantEnemies.push_back(i);
+        else world->dormantEnemies.push_back(i);
+    }
+}
+
+// --- Spatial Index ---
+
+// Counting sort of the living enemies by layer and the cell containing their centre: count
+// per bucket, prefix-sum into end offsets, then place back to front so each offset walks
+// down to its bucket's start. Slots stay ascending within a bucket.
+void buildSpatialIndex() {
+    const int cells = world->mapHeight * world->mapWidth;
+    const int buckets = SPATIAL_LAYERS * cells;
+    std::fill(world->spatialCellStart, world->spatialCellStart + buckets + 1, 0);
+
+    for (int i = FIRST_ENEMY; i < world->entities.count; ++i) {
+        if (!world->entities.isAlive[i]) continue;
+        int gridX = getGridX(world->entities.x[i] + TILE_SIZE * 0.4f);
+        int gridY = getGridY(world->entities.y[i] + TILE_SIZE * 0.475f);
+        gridX = std::min(std::max(gridX, 0), world->mapWidth - 1);
+        gridY = std::min(std::max(gridY, 0), world->mapHeight - 1);
+        int layer = world->entities.isTrapped[i] ? SPATIAL_TRAPPED : SPATIAL_FREE;
+        world->spatialCellOf[i] = layer * cells + gridY * world->mapWidth + gridX;
+        world->spatialCellStart[world->spatialCellOf[i]]++;
+    }
+    for (int c = 1; c < buckets; ++c) world->spatialCellStart[c] += world->spatialCellStart[c - 1];
+    world->spatialCellStart[buckets] = world->spatialCellStart[buckets - 1];
+
+    world->spatialEntities.resize(world->spatialCellStart[buckets]);
+    for (int i = world->entities.count - 1; i >= FIRST_ENEMY; --i) {
+        if (world->entities.isAlive[i]) world->spatialEntities[--world->spatialCellStart[world->spatialCellOf[i]]] = i;
+    }
+}
+
+// Buckets are stored row-major, so a run of cells in one row is one contiguous range
+void spatialRowRange(int layer, int gridX0, int gridX1, int gridY, int& begin, int& end) {
+    if (gridX0 < 0) gridX0 = 0;
+    if (gridX1 >= world->mapWidth) gridX1 = world->mapWidth - 1;
+    if (gridY < 0 || gridY >= world->mapHeight || gridX0 > gridX1) {
+        begin = end = 0;
+        return;
+    }
+    int row = layer * world->mapHeight * world->mapWidth + gridY * world->mapWidth;
+    begin = world->spatialCellStart[row + gridX0];
+    end = world->spatialCellStart[row + gridX1 + 1];
+}
+
+// --- Simulation Step ---
+
+uint8_t stepSimulation(float tickTime, uint8_t input) {
+    // Remember where everything was so drawing can blend towards the new state
+    world->entities.prevX = world->entities.x;
+    world->entities.prevY = world->entities.y;
+
+    world->gameTime += tickTime; // Increment game time
+    world->tickCount++;
+    world->tickTime = tickTime;
+    addProfileCount(PROFILE_TICKS);
+
+    uint8_t consumed = 0;
+
+    if (!world->gameOver && !world->gameWon) {
+        consumed = handleInput(input, tickTime);
+        updatePlayer(tickTime);
+        updateEnemies(tickTime);
+        updateTimers(); // Hole refills, trap expiry and respawns
+        checkLevelCompletion(); // Check if all gold is collected
+    }
+    else {
+        // Allow reset even when game is over/won by pressing 'R'
+        // Input handling for 'R' is done in keyboardDown for immediate response
+    }
+    return consumed;
+}
+
+void setTileChangeListener(TileChangeListener listener) {
+    world->tileChangeListener = listener;
+}
+
+// xorshift32: small, fast and private to the world, so sessions on other threads
+// neither disturb nor depend on each other's sequence (unlike rand())
+int randomInt(int range) {
+    uint32_t x = world->rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    world->rngState = x;
+    return static_cast<int>(x % static_cast<uint32_t>(range));
+}
+
+// The view is clamped to the map, and a map narrower or shorter than the view stays at its origin
+void getViewOrigin(float centreX, float centreY, float& originX, float& originY) {
+    float maxX = (world->mapWidth - VIEW_WIDTH) * TILE_SIZE;
+    float maxY = (world->mapHeight - VIEW_HEIGHT) * TILE_SIZE;
+    originX = std::max(0.0f, std::min(centreX - VIEW_WIDTH * TILE_SIZE * 0.5f, maxX));
+    originY = std::max(0.0f, std::min(centreY - VIEW_HEIGHT * TILE_SIZE * 0.5f, maxY));
+}
+
+void notifyTileChanged(int gridX, int gridY) {
+    if (gridX < 0 && gridY < 0) resetFlowField(); // Level rebuilt (nav graph already compiled)
+    else updateNavAround(gridX, gridY); // Queues the cells whose routes opened or closed
+    if (world->tileChangeListener) world->tileChangeListener(gridX, gridY);
+}
+
+// --- Input Handling ---
+
+uint8_t handleInput(uint8_t input, float deltaTime) {
+    PROFILE_SCOPE(PROFILE_HANDLE_INPUT);
+    // No input if game over, won, player is trapped, or player is not alive (though player is always alive)
+    if (world->gameOver || world->gameWon || world->entities.isTrapped[PLAYER] || !world->entities.isAlive[PLAYER]) return 0;
+
+    uint8_t consumed = 0; // One-shot presses acted on this tick
+
+    world->entities.vx[PLAYER] = 0; // Reset horizontal velocity unless a key is pressed
+
+    // Nothing below moves the player or changes a tile before the dig, so one contact query serves the whole tick
+    uint8_t contacts = getTileContacts(PLAYER, CONTACT_GROUND | CONTACT_LADDER | CONTACT_ROPE);
+    bool onLadder = (contacts & CONTACT_LADDER) != 0;
+    bool onRope = (contacts & CONTACT_ROPE) != 0;
+    world->entities.isOnRope[PLAYER] = onRope; // Update rope status based on current position
+
+    // --- Horizontal Movement ---
+    if (input & INPUT_LEFT) {
+        if (world->entities.isOnRope[PLAYER]) {
+            world->entities.vx[PLAYER] = -ROPE_SPEED; // Move at rope speed if on rope
+        }
+        else if (!world->entities.isClimbing[PLAYER]) { // Allow horizontal move if not actively climbing ladder
+            world->entities.vx[PLAYER] = -PLAYER_SPEED;
+        }
+        world->entities.faceRight[PLAYER] = false;
+        if (!world->entities.isOnRope[PLAYER]) world->entities.isClimbing[PLAYER] = false; // Stop climbing ladder if moving horizontally off it
+    }
+    if (input & INPUT_RIGHT) {
+        if (world->entities.isOnRope[PLAYER]) {
+            world->entities.vx[PLAYER] = ROPE_SPEED;
+        }
+        else if (!world->entities.isClimbing[PLAYER]) {
+            world->entities.vx[PLAYER] = PLAYER_SPEED;
+        }
+        world->entities.faceRight[PLAYER] = true;
+        if (!world->entities.isOnRope[PLAYER]) world->entities.isClimbing[PLAYER] = false;
+    }
+
+    // --- Vertical Movement (Ladders) ---
+    if (onLadder) {
+        //entities.vy[PLAYER] = 0; // Stop gravity/fall on ladder ONLY if moving vertically
+        world->entities.isFalling[PLAYER] = false;
+        world->entities.isOnRope[PLAYER] = false; // Cannot be on ladder and rope simultaneously
+
+        if (input & INPUT_UP) {
+            world->entities.vy[PLAYER] = CLIMB_SPEED;
+            world->entities.isClimbing[PLAYER] = true;
+        }
+        else if (input & INPUT_DOWN) {
+            world->entities.vy[PLAYER] = -CLIMB_SPEED;
+            world->entities.isClimbing[PLAYER] = true;
+        }
+        else {
+            // If no vertical input, stop vertical movement on ladder
+            world->entities.vy[PLAYER] = 0;
+            // Allow horizontal movement to take precedence if keys are pressed
+            if (!(input & (INPUT_LEFT | INPUT_RIGHT))) {
+                world->entities.isClimbing[PLAYER] = false; // Not actively climbing if no vertical or horizontal input
+            }
+            else {
+                world->entities.isClimbing[PLAYER] = false; // Moving horizontally off ladder
+            }
+        }
+    }
+    else {
+        world->entities.isClimbing[PLAYER] = false; // Not on a ladder
+        // Gravity will be applied in updatePhysics if not climbing
+    }
+
+    // --- Stop vertical movement if on rope and not falling onto it ---
+    if (world->entities.isOnRope[PLAYER]) {
+        // Only stop vertical velocity if actually *on* the rope, not just touching it while falling
+        int playerGridY = getGridY(world->entities.y[PLAYER] + TILE_SIZE * 0.1f); // Check slightly above feet
+        int playerGridX = getGridX(world->entities.x[PLAYER] + TILE_SIZE * 0.4f);
+        if (world->level[playerGridY][playerGridX] == ROPE) {
+            world->entities.vy[PLAYER] = 0;
+            world->entities.isClimbing[PLAYER] = false;
+            world->entities.isFalling[PLAYER] = false;
+        }
+    }
+
+    bool groundCheck = (contacts & CONTACT_GROUND) != 0; // Check if player is on a surface [cite: 465]
+    if ((input & INPUT_JUMP) && groundCheck && !world->entities.isClimbing[PLAYER] && !world->entities.isOnRope[PLAYER] && !world->entities.isFalling[PLAYER]) {
+        world->entities.vy[PLAYER] = JUMP_FORCE;         // Apply upward velocity
+        world->entities.isJumping[PLAYER] = true;        // Set jumping state
+        world->entities.isFalling[PLAYER] = false;       // Not falling initially
+        consumed |= INPUT_JUMP;         // Consume the press to prevent repeated jumps
+    }
+    // --- Digging (Lode Runner Style: Down-Left/Right) ---
+    int playerGridX = getGridX(world->entities.x[PLAYER] + TILE_SIZE * 0.4f); // Center-ish X
+    int playerGridY = getGridY(world->entities.y[PLAYER]);                  // Bottom Y
+    float checkYBelow = world->entities.y[PLAYER] - 1.0f;                   // Check slightly below feet
+
+    // Check if player is standing on a valid surface for digging
+    TileType tileBelow = getTileAt(world->entities.x[PLAYER] + TILE_SIZE * 0.4f, checkYBelow);
+    bool canStand = (tileBelow == BRICK || tileBelow == SOLID_BRICK || tileBelow == LADDER || tileBelow == ROPE || onLadder || onRope);
+
+    if (canStand && !world->entities.isFalling[PLAYER] && !world->entities.isClimbing[PLAYER]) { // Can only dig if standing stably
+        int targetY = playerGridY - 1; // Target is one row below player
+
+        if (input & INPUT_DIG_LEFT) { // Dig Left-Below
+            int targetX = playerGridX - 1;
+            if (targetX >= 0 && targetY >= 0) { // Bounds check
+                // Check if the target tile is actually a brick
+                if (world->level[targetY][targetX] == BRICK && !isHoleAt(targetX, targetY)) {
+                    digHole(targetX, targetY);
+                }
+            }
+            consumed |= INPUT_DIG_LEFT; // Consume press (prevents rapid digging)
+        }
+        else if (input & INPUT_DIG_RIGHT) { // Dig Right-Below
+            int targetX = playerGridX + 1;
+            if (targetX < GRID_WIDTH && targetY >= 0) { // Bounds check
+                // Check if the target tile is actually a brick
+                if (world->level[targetY][targetX] == BRICK && !isHoleAt(targetX, targetY)) {
+                    digHole(targetX, targetY);
+                }
+            }
+            consumed |= INPUT_DIG_RIGHT; // Consume press
+        }
+    }
+    return consumed;
+}
+
+
+// --- Update Functions ---
+
+void updatePhysics(int e, float deltaTime) {
+    PROFILE_SCOPE(PROFILE_UPDATE_PHYSICS);
+    if (world->entities.isTrapped[e]) {
+        // Held in the hole: no movement or gravity until its refill (or the trap's own timer) frees them
+        world->entities.vx[e] = 0;
+        world->entities.vy[e] = 0;
+        return; // Skip normal physics update if trapped
+    }
+
+    integrateEntities(e, e + 1, deltaTime);
+    resolveCollisions(e);
+}
+
+#if LODE_RUNNER_SSE2
+// Four consecutive flag bytes, each widened to a 32-bit lane (0 or 1)
+static inline __m128i loadFlags4(const uint8_t* flags) {
+    int packed;
+    std::memcpy(&packed, flags, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+}
+#endif
+
+// Gravity and velocity integration for slots [first, last), writing nextX/nextY.
+// Gravity applies to alive entities that are not trapped, dormant, climbing or on a rope;
+// slots that will not be resolved this tick get a next position nobody reads. Four entities
+// per step with SSE2, the same float operations one at a time for the remainder.
+void integrateEntities(int first, int last, float deltaTime) {
+    const float fall = GRAVITY * deltaTime;
+    int e = first;
+
+#if LODE_RUNNER_SSE2
+    const __m128 fall4 = _mm_set1_ps(fall);
+    const __m128 dt4 = _mm_set1_ps(deltaTime);
+    const __m128i zero = _mm_setzero_si128();
+    for (; e + 4 <= last; e += 4) {
+        // Widen four flag bytes to one 32-bit lane each
+        __m128i alive = loadFlags4(&world->entities.isAlive[e]);
+        __m128i held = _mm_or_si128(_mm_or_si128(loadFlags4(&world->entities.isTrapped[e]), loadFlags4(&world->entities.isDormant[e])),
+            _mm_or_si128(loadFlags4(&world->entities.isClimbing[e]), loadFlags4(&world->entities.isOnRope[e])));
+        __m128 gravityLanes = _mm_castsi128_ps(_mm_andnot_si128(_mm_cmpeq_epi32(alive, zero), _mm_cmpeq_epi32(held, zero)));
+
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(&world->entities.vy[e]), _mm_and_ps(gravityLanes, fall4));
+        _mm_storeu_ps(&world->entities.vy[e], vy);
+        _mm_storeu_ps(&world->entities.nextX[e], _mm_add_ps(_mm_loadu_ps(&world->entities.x[e]), _mm_mul_ps(_mm_loadu_ps(&world->entities.vx[e]), dt4)));
+        _mm_storeu_ps(&world->entities.nextY[e], _mm_add_ps(_mm_loadu_ps(&world->entities.y[e]), _mm_mul_ps(vy, dt4)));
+    }
+#endif
+
+    for (; e < last; ++e) {
+        // Apply gravity if not climbing a ladder AND not on a rope
+        if (world->entities.isAlive[e] && !world->entities.isTrapped[e] && !world->entities.isDormant[e] &&
+            !world->entities.isClimbing[e] && !world->entities.isOnRope[e]) {
+            world->entities.vy[e] -= fall;
+        }
+        world->entities.nextX[e] = world->entities.x[e] + world->entities.vx[e] * deltaTime;
+        world->entities.nextY[e] = world->entities.y[e] + world->entities.vy[e] * deltaTime;
+    }
+}
+
+// Moves one entity to its integrated position, resolving tiles, trapped heads, the screen
+// edges and holes. Runs after integrateEntities() has covered the entity's slot.
+void resolveCollisions(int e) {
+    float oldY = world->entities.y[e];
+    float newX = world->entities.nextX[e];
+    float newY = world->entities.nextY[e];
+
+    // --- Collision Detection & Resolution ---
+    float entityWidth = TILE_SIZE * 0.8f; // Use slightly smaller collision box
+    float entityHeight = TILE_SIZE * 0.95f;
+
+    // Create a bounding box for the entity's potential new position
+    float nextLeft = newX;
+    float nextRight = newX + entityWidth;
+    float nextBottom = newY;
+    float nextTop = newY + entityHeight;
+
+    // --- Vertical Collision ---
+    if (world->entities.vy[e] != 0) { // Only check vertical collision if moving vertically
+        // Check points slightly inside the horizontal edges at the new bottom/top Y
+        float checkXLeft = nextLeft + TILE_SIZE * 0.1f;
+        float checkXRight = nextRight - TILE_SIZE * 0.1f;
+        float checkY = (world->entities.vy[e] < 0) ? nextBottom : nextTop; // Check bottom edge when falling, top edge when rising
+
+        // Sweep the rows the edge enters this tick, nearest first; within a tile of movement
+        // that is just the row it ends in
+        int checkGridY = getGridY(checkY);
+        int fromGridY = getGridY((world->entities.vy[e] < 0) ? oldY : oldY + entityHeight);
+        if (world->entities.vy[e] < 0 && checkGridY < fromGridY) fromGridY--;
+        else if (world->entities.vy[e] > 0 && checkGridY > fromGridY) fromGridY++;
+        else fromGridY = checkGridY;
+        int hitGridY = checkGridY;
+        bool hitSolid = sweepRows(world->solidRows, getGridX(checkXLeft), getGridX(checkXRight), fromGridY, checkGridY, hitGridY);
+
+        bool collision = false;
+        if (world->entities.vy[e] < 0) { // Moving Down (Falling/Landing)
+            // Collision if hitting Brick, Solid Brick, or potentially another entity in a hole
+            if (hitSolid) {
+                collision = true;
+            }
+            // Check landing on trapped enemy head (Lode Runner mechanic)
+            // A head we can cross lies in the cell below us or beside it
+            int feetGridX = getGridX(newX + entityWidth / 2.0f);
+            int feetGridY = getGridY(newY);
+            for (int gridY = feetGridY - 1; gridY <= feetGridY + 1 && !collision; ++gridY) {
+                int begin, end;
+                spatialRowRange(SPATIAL_TRAPPED, feetGridX - 1, feetGridX + 1, gridY, begin, end);
+                for (int k = begin; k < end; ++k) {
+                    int i = world->spatialEntities[k];
+                    if (e != i && world->entities.isTrapped[i]) { // Check against other trapped enemies
+                        float enemyHeadY = world->entities.y[i] + TILE_SIZE * 0.9f; // Approx head height
+                        if (nextBottom <= enemyHeadY && oldY >= enemyHeadY && // Crossing the head level
+                            nextRight > world->entities.x[i] && nextLeft < world->entities.x[i] + TILE_SIZE * 0.8f) // Horizontal overlap
+                        {
+                            collision = true;
+                            newY = enemyHeadY; // Land exactly on head
+                            break; // Stop checking after landing on one
+                        }
+                    }
+                }
+            }
+
+            if (collision) {
+                int gridY = hitGridY; // Grid Y of the tile being collided with
+                newY = static_cast<float>(gridY + 1) * TILE_SIZE; // Snap feet to top of the tile below
+                world->entities.vy[e] = 0;
+                world->entities.isFalling[e] = false;
+                if (e == PLAYER) { // Only reset jump state for player
+                    world->entities.isJumping[e] = false; // << ADD THIS LINE: Reset jump state on landing
+                }
+            }
+        }
+        else { // Moving Up
+            // Collision if hitting Brick or Solid Brick
+            if (hitSolid) {
+                collision = true;
+                int gridY = hitGridY; // Grid Y of the tile being collided with
+                newY = static_cast<float>(gridY) * TILE_SIZE - entityHeight; // Snap head to bottom of tile above
+                world->entities.vy[e] = 0; // Stop upward movement
+            }
+        }
+        // If no collision detected while moving down and not climbing/on rope, entity is falling
+        if (!collision && world->entities.vy[e] < 0 && !world->entities.isClimbing[e] && !world->entities.isOnRope[e]) {
+            world->entities.isFalling[e] = true;
+        }
+    }
+
+    // --- Horizontal Collision ---
+    if (world->entities.vx[e] != 0) { // Only check horizontal collision if moving horizontally
+        // Check points slightly inside the vertical edges at the new Y position
+        float checkYBottom = newY + TILE_SIZE * 0.1f;
+        float checkYTop = newY + entityHeight * 0.9f; // Check near top
+        float checkX = (world->entities.vx[e] < 0) ? nextLeft : nextRight; // Check left edge when moving left, right edge when moving right
+
+        // The three samples lie in one column, so test the rows they span with the column bit,
+        // for each column the edge enters this tick (nearest first)
+        int checkGridX = getGridX(checkX);
+        int checkGridY0 = getGridY(checkYBottom);
+        int checkGridY1 = getGridY(checkYTop);
+        int step = (world->entities.vx[e] < 0) ? -1 : 1;
+        int fromGridX = getGridX((world->entities.vx[e] < 0) ? world->entities.x[e] : world->entities.x[e] + entityWidth) + step;
+        if ((checkGridX - fromGridX) * step < 0) fromGridX = checkGridX; // Still in the edge's column
+
+        // Special case: Allow moving horizontally *past* a ladder/rope if not climbing/on it
+        bool onValidTraversal = world->entities.isClimbing[e] || world->entities.isOnRope[e];
+        for (int gridX = fromGridX; ; gridX += step) {
+            // Collision if hitting Brick or Solid Brick
+            if (spanAny(world->solidRows, gridX, gridX, checkGridY0, checkGridY1, true) &&
+                (!onValidTraversal ||
+                 (!spanAny(world->climbableRows, gridX, gridX, checkGridY0, checkGridY1, false) &&
+                  !spanAny(world->hangableRows, gridX, gridX, checkGridY0, checkGridY1, false))))
+            {
+                if (world->entities.vx[e] < 0) { // Moving left
+                    newX = static_cast<float>(gridX + 1) * TILE_SIZE; // Snap left edge to right edge of tile
+                }
+                else { // Moving right
+                    newX = static_cast<float>(gridX) * TILE_SIZE - entityWidth; // Snap right edge to left edge of tile
+                }
+                world->entities.vx[e] = 0; // Stop horizontal movement
+                break;
+            }
+            if (gridX == checkGridX) break;
+        }
+    }
+
+
+    // --- Update final position ---
+    world->entities.x[e] = newX;
+    world->entities.y[e] = newY;
+
+    // --- Boundary Checks (Window edges) ---
+    if (world->entities.x[e] < 0) world->entities.x[e] = 0;
+    if (world->entities.x[e] + entityWidth > world->mapWidth * TILE_SIZE) world->entities.x[e] = world->mapWidth * TILE_SIZE - entityWidth;
+    if (world->entities.y[e] < -TILE_SIZE) { // Allow falling slightly off before reset
+        world->entities.y[e] = 0; // Reset Y
+        world->entities.vy[e] = 0;
+        if (e == PLAYER) { // Only player loses life falling off screen
+            world->lives--;
+            if (world->lives <= 0) {
+                world->gameOver = true;
+            }
+            else {
+                // Respawn player at start
+                world->entities.x[e] = world->entities.startGridX[e] * TILE_SIZE + (TILE_SIZE * 0.1f);
+                world->entities.y[e] = world->entities.startGridY[e] * TILE_SIZE;
+                world->entities.vx[e] = 0; world->entities.vy[e] = 0;
+                world->entities.isFalling[e] = false;
+            }
+        }
+        else {
+            // Enemy fell off bottom - kill and respawn
+            killEnemy(e);
+        }
+    }
+    // No top boundary check needed if level prevents it
+
+
+     // --- Check if falling into a dug hole ---
+    int gridX = getGridX(world->entities.x[e] + entityWidth / 2.0f);
+    int gridY = getGridY(world->entities.y[e] + entityHeight / 2.0f); // Check center
+    int gridYFeet = getGridY(world->entities.y[e] + 1.0f); // Check just above feet
+    if (world->entities.isFalling[e] && world->entities.vy[e] == 0 && isOnGround(e)) { // Additional check ensure falling state is reset if vy becomes 0 while on ground
+        world->entities.isFalling[e] = false;
+        if (e == PLAYER) world->entities.isJumping[e] = false;
+    }
+
+    // Check the tile the feet are currently in
+    if (gridX >= 0 && gridX < GRID_WIDTH && gridYFeet >= 0 && gridYFeet < GRID_HEIGHT) {
+        const DugHole& hole = world->dugHoles[gridYFeet][gridX];
+        if (hole.active && world->entities.isFalling[e]) { // Fell into a hole
+            if (!world->entities.isTrapped[e]) {
+                EVENT_DEBUG("Entity trapped in hole at (%d, %d)", gridX, gridYFeet);
+                world->entities.isTrapped[e] = true;
+                // The refill frees or kills whoever is in the hole; the trap's timer, a tick later,
+                // only matters if the hole closes some other way
+                long refill = world->timers.due[gridYFeet * GRID_WIDTH + gridX];
+                scheduleTimer(TIMER_ENTITY_BASE + e, (refill != TIMER_NONE ? refill : world->timers.now) + 1);
+
+                world->entities.x[e] = gridX * TILE_SIZE + (TILE_SIZE - entityWidth) / 2.0f; // Center in hole horizontally
+                world->entities.y[e] = gridYFeet * TILE_SIZE; // Align feet with bottom of hole
+                world->entities.vx[e] = 0;
+                world->entities.vy[e] = 0;
+                world->entities.isFalling[e] = false;
+                // entities.isJumping[e] = false; // Removed
+                world->entities.isClimbing[e] = false;
+            }
+        }
+    }
+}
+
+void updatePlayer(float deltaTime) {
+    PROFILE_SCOPE(PROFILE_UPDATE_PLAYER);
+    if (!world->entities.isAlive[PLAYER]) return; // Should not happen for player, but safety check
+
+    updatePhysics(PLAYER, deltaTime);
+
+    // --- Collectibles ---
+    // Check a slightly larger area around the player's center for pickup
+    float playerCenterX = world->entities.x[PLAYER] + (TILE_SIZE * 0.8f) / 2.0f;
+    float playerCenterY = world->entities.y[PLAYER] + (TILE_SIZE * 0.95f) / 2.0f;
+    int centerGridX = getGridX(playerCenterX);
+    int centerGridY = getGridY(playerCenterY);
+
+    // Check 3x3 grid around the player's center grid cell
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            int checkX = centerGridX + dx;
+            int checkY = centerGridY + dy;
+
+            if (checkX >= 0 && checkX < GRID_WIDTH && checkY >= 0 && checkY < GRID_HEIGHT) {
+                // Check if collectible exists at this grid cell
+                if (world->collectibles[checkY][checkX] == 1) {
+                    // Check collision between player bounding box and collectible's small area
+                    float collectibleX = checkX * TILE_SIZE + TILE_SIZE * 0.2f; // Approx collectible position
+                    float collectibleY = checkY * TILE_SIZE + TILE_SIZE * 0.2f;
+                    float collectibleSize = TILE_SIZE * 0.6f;
+                    if (isColliding(world->entities.x[PLAYER], world->entities.y[PLAYER], TILE_SIZE * 0.8f, TILE_SIZE * 0.95f,
+                        collectibleX, collectibleY, collectibleSize, collectibleSize))
+                    {
+                        world->collectibles[checkY][checkX] = 0; // Collect it
+                        world->collectiblesCollected++;
+                        world->score += POINTS_PER_COLLECTIBLE;
+                        EVENT_INFO("Collected! Score: %d, Total: %d/%d", world->score, world->collectiblesCollected, world->totalCollectibles);
+                        // Add sound effect here if possible
+                    }
+                }
+            }
+        }
+    }
+
+    // --- Check Win Condition ---
+    if (world->levelComplete && !world->gameWon) {
+        // Check if player reached an exit ladder at the top
+        int topGridY = world->mapHeight - 1; // Or adjust based on level design
+        int playerHeadGridY = getGridY(world->entities.y[PLAYER] + TILE_SIZE * 0.9f);
+        int playerFeetGridY = getGridY(world->entities.y[PLAYER] + 1.0f);
+
+        // Check if player is overlapping with an exit ladder tile near the top
+        if (playerHeadGridY >= topGridY - 1) { // Check top two rows
+            TileType tileAtHead = getTileAt(playerCenterX, world->entities.y[PLAYER] + TILE_SIZE * 0.9f);
+            TileType tileAtFeet = getTileAt(playerCenterX, world->entities.y[PLAYER] + 1.0f);
+            if (tileAtHead == EXIT_LADDER || tileAtFeet == EXIT_LADDER) {
+                world->gameWon = true;
+                EVENT_INFO("Level Complete! Player reached the exit!");
+            }
+        }
+    }
+}
+
+// Job body for the decide phase: (*enemies)[begin, end) of the DecideJob's world
+void decideEnemies(int begin, int end, void* context) {
+    const DecideJob* job = static_cast<const DecideJob*>(context);
+    World* caller = world;
+    world = job->world; // May be running on a worker thread
+    for (int k = begin; k < end; ++k) {
+        int i = (*job->enemies)[k];
+        decideEnemy(i, job->deltaTime + world->entities.sleepTime[i]);
+    }
+    world = caller;
+}
+
+// Sets one enemy's velocity and movement flags for this tick
+void decideEnemy(int i, float deltaTime) {
+    // --- Flow Field Pursuit ---
+    // Follow the shared distance field one cell at a time. Vertical moves wait until
+    // the enemy is centred on its column, sideways moves off a ladder until it is level
+    // with the row, so the continuous physics follows the grid route.
+    float enemyWidth = TILE_SIZE * 0.8f; // [cite: 315]
+    int enemyGridX, enemyGridY;
+    getEntityCell(i, enemyGridX, enemyGridY);
+
+    uint8_t contacts = getTileContacts(i, CONTACT_LADDER | CONTACT_ROPE);
+    bool enemyOnLadder = (contacts & CONTACT_LADDER) != 0; // [cite: 317]
+    bool enemyOnRope = (contacts & CONTACT_ROPE) != 0; // [cite: 317]
+    world->entities.isOnRope[i] = enemyOnRope; // Update state [cite: 317]
+
+    float desiredVX = 0; // [cite: 319]
+    float desiredVY = world->entities.isFalling[i] ? world->entities.vy[i] : 0.0f; // Keep gravity building while falling
+    bool wantsToClimb = false; // [cite: 319]
+    float moveSpeed = enemyOnRope ? ROPE_SPEED : ENEMY_SPEED;
+    float columnX = enemyGridX * TILE_SIZE + (TILE_SIZE - enemyWidth) / 2.0f; // Centred on the column
+    float rowY = enemyGridY * TILE_SIZE;
+
+    int stepX = 0, stepY = 0;
+    if (!isStandable(enemyGridX, enemyGridY) && !enemyOnRope && !enemyOnLadder) {
+        // Mid-fall: drift onto the column so the enemy drops straight down
+        desiredVX = steerTowards(world->entities.x[i], columnX, ENEMY_SPEED, deltaTime);
+    }
+    else if (nextFlowStep(enemyGridX, enemyGridY, stepX, stepY)) {
+        if (stepY != 0) {
+            desiredVX = steerTowards(world->entities.x[i], columnX, ENEMY_SPEED, deltaTime);
+            if (desiredVX == 0) {
+                bool ladderMove = (stepY > 0 || (world->navGraph[enemyGridY][enemyGridX] & NAV_LADDER_DOWN));
+                if (ladderMove) {
+                    desiredVY = stepY * CLIMB_SPEED;
+                    wantsToClimb = true;
+                }
+                else { // Let go of the rope or step off the ledge
+                    desiredVY = -CLIMB_SPEED;
+                    world->entities.isOnRope[i] = false;
+                }
+            }
+        }
+        else if (enemyOnLadder && !enemyOnRope && fabs(world->entities.y[i] - rowY) > 0.5f) {
+            desiredVY = steerTowards(world->entities.y[i], rowY, CLIMB_SPEED, deltaTime);
+            wantsToClimb = true;
+        }
+        else {
+            desiredVX = stepX * moveSpeed;
+            if (enemyOnRope) { // Hang level with the rope instead of dropping through it
+                desiredVY = steerTowards(world->entities.y[i], rowY, CLIMB_SPEED, deltaTime);
+                world->entities.isFalling[i] = false;
+            }
+        }
+    }
+    else if (world->flowDistance[enemyGridY][enemyGridX] == 0) {
+        // Same cell as the player: close the remaining gap directly
+        desiredVX = steerTowards(world->entities.x[i], world->entities.x[PLAYER], moveSpeed, deltaTime);
+        if (enemyOnLadder && !enemyOnRope) {
+            desiredVY = steerTowards(world->entities.y[i], world->entities.y[PLAYER], CLIMB_SPEED, deltaTime);
+            wantsToClimb = true;
+        }
+    }
+    else {
+        // No route: edge towards the player along the row, never off a ledge or into a hole
+        int towards = (world->entities.x[PLAYER] > world->entities.x[i] + 1.0f) ? 1 : (world->entities.x[PLAYER] < world->entities.x[i] - 1.0f) ? -1 : 0;
+        if (towards != 0 && canStep(enemyGridX, enemyGridY, enemyGridX + towards, enemyGridY) &&
+            isStandable(enemyGridX + towards, enemyGridY)) {
+            desiredVX = towards * moveSpeed;
+        }
+    }
+
+
+    // --- Set final velocities based on decisions ---
+    world->entities.vx[i] = desiredVX; // [cite: 339]
+    world->entities.vy[i] = desiredVY; // [cite: 339]
+    world->entities.isClimbing[i] = wantsToClimb; // [cite: 339]
+    if (desiredVX != 0) world->entities.faceRight[i] = (desiredVX > 0); // [cite: 339]
+}
+
+void updateEnemies(float deltaTime) {
+    PROFILE_SCOPE(PROFILE_UPDATE_ENEMIES);
+    updateFlowField(); // Repairs at most FLOW_EXPANSIONS_PER_TICK cells
+    updateEntityLists(); // State changes below take effect in next tick's lists
+
+    // Trapped enemies skip AI and stay put; their hole's refill timer frees them [cite: 311, 312]
+    for (int i : world->trappedEnemies) {
+        updatePhysics(i, deltaTime);
+    }
+
+    // Decide: every active enemy picks its velocity from the flow field. Reads shared state
+    // nobody writes until the apply passes below and writes only its own slot, so the
+    // enemies can be split across the job system with the same result on any thread count.
+    // Distant enemies due this tick decide over the time they slept through.
+    DecideJob decide = { world, &world->activeEnemies, deltaTime };
+    parallelFor(static_cast<int>(world->activeEnemies.size()), ENEMY_DECIDE_GRAIN, decideEnemies, &decide);
+    DecideJob catchUp = { world, &world->distantEnemies, deltaTime };
+    parallelFor(static_cast<int>(world->distantEnemies.size()), ENEMY_DECIDE_GRAIN, decideEnemies, &catchUp);
+
+    // Apply physics and collision, in slot order: integrate every enemy at once, then resolve one by one [cite: 340]
+    {
+        PROFILE_SCOPE(PROFILE_UPDATE_PHYSICS); // One scope for the batch, not one per enemy
+        integrateEntities(FIRST_ENEMY, world->entities.count, deltaTime); // Dormant slots are left alone
+        for (int i : world->activeEnemies) {
+            resolveCollisions(i);
+        }
+        // LOD step: each due distant enemy moves once over its whole sleep
+        for (int i : world->distantEnemies) {
+            world->entities.isDormant[i] = false;
+            updatePhysics(i, deltaTime + world->entities.sleepTime[i]);
+            world->entities.sleepTime[i] = 0.0f;
+        }
+    }
+    for (int i : world->dormantEnemies) {
+        world->entities.sleepTime[i] += deltaTime;
+    }
+
+    // --- Check Collision with Player ---
+    // Enemies have finished moving, so index them once and test only those around the
+    // player. The lowest slot touching the player catches them, once per tick.
+    buildSpatialIndex();
+    float enemyWidth = TILE_SIZE * 0.8f; // [cite: 315]
+    float enemyHeight = TILE_SIZE * 0.95f; // [cite: 315]
+    int catcher = -1;
+    int playerGridX, playerGridY;
+    getEntityCell(PLAYER, playerGridX, playerGridY);
+    for (int gridY = playerGridY - 1; gridY <= playerGridY + 1 && !world->entities.isTrapped[PLAYER]; ++gridY) {
+        int begin, end;
+        spatialRowRange(SPATIAL_FREE, playerGridX - 1, playerGridX + 1, gridY, begin, end);
+        for (int k = begin; k < end; ++k) {
+            int i = world->spatialEntities[k];
+            if ((catcher < 0 || i < catcher) && !world->entities.isTrapped[i] &&
+                isColliding(world->entities.x[PLAYER], world->entities.y[PLAYER], TILE_SIZE * 0.8f, TILE_SIZE * 0.95f,
+                    world->entities.x[i], world->entities.y[i], enemyWidth, enemyHeight)) // [cite: 341]
+            {
+                catcher = i;
+            }
+        }
+    }
+    if (catcher >= 0) {
+        int i = catcher;
+        if (!world->gameOver && !world->gameWon) { // Only trigger once per life/reset [cite: 341]
+            EVENT_INFO("Player caught by enemy %d!", i); // [cite: 342]
+            world->lives--; // [cite: 342]
+            if (world->lives <= 0) { // [cite: 342]
+                world->gameOver = true; // [cite: 343]
+            }
+            else {
+                // Reset player/enemy positions after being caught
+                world->entities.x[PLAYER] = world->entities.startGridX[PLAYER] * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 344]
+                world->entities.y[PLAYER] = world->entities.startGridY[PLAYER] * TILE_SIZE; // [cite: 344]
+                world->entities.vx[PLAYER] = 0; world->entities.vy[PLAYER] = 0; world->entities.isFalling[PLAYER] = false; world->entities.isTrapped[PLAYER] = false; world->entities.isJumping[PLAYER] = false; // Reset jump state too [cite: 344]
+
+                // Optionally reset this specific enemy too
+                world->entities.x[i] = world->entities.startGridX[i] * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 346]
+                world->entities.y[i] = world->entities.startGridY[i] * TILE_SIZE; // [cite: 346]
+                world->entities.vx[i] = (randomInt(2) == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // [cite: 347]
+                world->entities.isAlive[i] = true; // Ensure it's alive [cite: 347]
+                world->entities.isTrapped[i] = false; // [cite: 347]
+                // Reset enemy state fully
+                world->entities.vy[i] = 0.0f;
+                world->entities.isClimbing[i] = false;
+                world->entities.isOnRope[i] = false;
+                world->entities.isFalling[i] = false;
+                world->entities.faceRight[i] = (world->entities.vx[i] > 0);
+
+            }
+        }
+    }
+}
+
+// --- Timer Wheel ---
+
+void resetTimers() {
+    TimerWheel& wheel = world->timers;
+    wheel.now = 0;
+    wheel.pending = 0;
+    std::fill(wheel.head, wheel.head + TIMER_WHEEL_SLOTS, TIMER_NONE);
+    std::fill(wheel.due, wheel.due + TIMER_IDS, static_cast<long>(TIMER_NONE));
+}
+
+void scheduleTimer(int id, long due) {
+    TimerWheel& wheel = world->timers;
+    cancelTimer(id);
+    int slot = static_cast<int>(due & (TIMER_WHEEL_SLOTS - 1));
+    wheel.due[id] = due;
+    wheel.prev[id] = TIMER_NONE;
+    wheel.next[id] = wheel.head[slot];
+    if (wheel.head[slot] != TIMER_NONE) wheel.prev[wheel.head[slot]] = id;
+    wheel.head[slot] = id;
+    wheel.pending++;
+}
+
+void cancelTimer(int id) {
+    TimerWheel& wheel = world->timers;
+    if (wheel.due[id] == TIMER_NONE) return;
+    if (wheel.prev[id] != TIMER_NONE) wheel.next[wheel.prev[id]] = wheel.next[id];
+    else wheel.head[wheel.due[id] & (TIMER_WHEEL_SLOTS - 1)] = wheel.next[id];
+    if (wheel.next[id] != TIMER_NONE) wheel.prev[wheel.next[id]] = wheel.prev[id];
+    wheel.due[id] = TIMER_NONE;
+    wheel.pending--;
+}
+
+// A hair under the exact quotient, so 7 s at 60 Hz is 420 ticks despite float rounding
+long timerTicks(float seconds) {
+    long ticks = static_cast<long>(std::ceil(seconds / world->tickTime - 0.001f));
+    return ticks < 1 ? 1 : ticks;
+}
+
+void updateTimers() {
+    PROFILE_SCOPE(PROFILE_UPDATE_TIMERS);
+    TimerWheel& wheel = world->timers;
+    wheel.now++;
+    int slot = static_cast<int>(wheel.now & (TIMER_WHEEL_SLOTS - 1));
+    int id = wheel.head[slot];
+    while (id != TIMER_NONE) {
+        if (wheel.due[id] != wheel.now) { // Due on a later turn
+            id = wheel.next[id];
+            continue;
+        }
+        cancelTimer(id);
+        fireTimer(id);
+        id = wheel.head[slot]; // Firing may have rescheduled others; what it added here is due later
+    }
+}
+
+void fireTimer(int id) {
+    if (id < TIMER_ENTITY_BASE) {
+        refillHole(id % GRID_WIDTH, id / GRID_WIDTH);
+        return;
+    }
+    int e = id - TIMER_ENTITY_BASE;
+    if (!world->entities.isAlive[e]) respawnEnemy(e);
+    else if (world->entities.isTrapped[e]) expireTrap(e);
+}
+
+void refillHole(int x, int y) {
+    DugHole& hole = world->dugHoles[y][x];
+    if (!hole.active) return;
+    hole.active = false;
+    removeActiveHole(x, y);
+    // Restore the original tile type
+    setTile(x, y, hole.originalType); // Also sets the cell's mask bits again
+    notifyTileChanged(x, y);
+    EVENT_DEBUG("Hole refilled at (%d, %d)", x, y);
+
+    // Free or kill whoever is trapped in this exact spot
+    if (world->entities.isTrapped[PLAYER] && getGridX(world->entities.x[PLAYER] + TILE_SIZE * 0.4f) == x && getGridY(world->entities.y[PLAYER]) == y) {
+        world->entities.isTrapped[PLAYER] = false;
+        world->entities.y[PLAYER] += 5.0f; // Boost slightly to avoid getting stuck in refilled brick
+        world->entities.isFalling[PLAYER] = true;
+        cancelTimer(TIMER_ENTITY_BASE + PLAYER);
+        EVENT_INFO("Player freed by refill.");
+    }
+    int begin, end;
+    spatialRowRange(SPATIAL_TRAPPED, x, x, y, begin, end); // Trapped enemies sit centred in their hole's cell
+    for (int k = begin; k < end; ++k) {
+        int e = world->spatialEntities[k];
+        if (world->entities.isAlive[e] && world->entities.isTrapped[e] && getGridX(world->entities.x[e] + TILE_SIZE * 0.4f) == x && getGridY(world->entities.y[e]) == y) {
+            EVENT_DEBUG("Enemy %d killed by refilling hole at (%d, %d)", e, x, y);
+            killEnemy(e); // Replaces its trap timer with the respawn
+        }
+    }
+}
+
+void expireTrap(int e) {
+    int gridX = getGridX(world->entities.x[e] + TILE_SIZE * 0.4f);
+    int gridY = getGridY(world->entities.y[e]);
+    if (isHoleAt(gridX, gridY)) { // In a hole still open: keep waiting for its refill
+        long due = world->timers.due[gridY * GRID_WIDTH + gridX];
+        scheduleTimer(TIMER_ENTITY_BASE + e, (due != TIMER_NONE ? due : world->timers.now) + 1);
+        return;
+    }
+    if (e != PLAYER) { // Only enemies die when hole refills
+        EVENT_DEBUG("Enemy killed by refilling hole!");
+        killEnemy(e); // Mark for respawn
+    }
+    else {
+        // Player gets freed but might be stuck in brick, give boost
+        EVENT_INFO("Player freed by refill!");
+        world->entities.isTrapped[e] = false;
+        world->entities.y[e] += 5.0f; // Small boost upwards
+        world->entities.isFalling[e] = true; // Apply gravity next frame
+    }
+}
+
+// Respawned enemies start moving next tick [cite: 310]
+void respawnEnemy(int i) {
+    world->entities.x[i] = world->entities.startGridX[i] * TILE_SIZE + (TILE_SIZE * 0.1f); // [cite: 161, 306]
+    world->entities.y[i] = world->entities.startGridY[i] * TILE_SIZE; // [cite: 161, 306]
+    world->entities.vx[i] = (randomInt(2) == 0 ? 1 : -1) * ENEMY_SPEED / 2.0f; // [cite: 162, 307]
+    world->entities.vy[i] = 0.0f; // [cite: 162, 307]
+    world->entities.isClimbing[i] = false; // [cite: 163, 307]
+    world->entities.isOnRope[i] = false; // [cite: 163, 307]
+    world->entities.isFalling[i] = false; // [cite: 163, 307]
+    world->entities.faceRight[i] = (world->entities.vx[i] > 0); // [cite: 163, 307]
+    world->entities.isTrapped[i] = false; // [cite: 164, 308]
+    world->entities.isAlive[i] = true; // Bring back to life [cite: 164, 308]
+    EVENT_DEBUG("Enemy %d respawned.", i); // [cite: 309]
+}
+
+void checkLevelCompletion() {
+    if (!world->levelComplete && world->collectiblesCollected >= world->totalCollectibles && world->totalCollectibles > 0) {
+        world->levelComplete = true;
+        EVENT_INFO("All gold collected! Revealing exit ladder.");
+        revealExitLadder();
+        // Add sound effect or visual cue here
+    }
+}
+
+void revealExitLadder() {
+    // Find specific locations (e.g., above certain ladders at the top) and change EMPTY to EXIT_LADDER
+    for (int x = 0; x < world->mapWidth; ++x) {
+        // Example: Reveal ladder above the top-most regular ladders
+        if (world->level[world->mapHeight - 2][x] == LADDER) { // Check row below the top empty space
+            if (world->level[world->mapHeight - 1][x] == EMPTY || world->level[world->mapHeight - 1][x] == LADDER) { // Ensure space above is empty or ladder
+                setTile(x, world->mapHeight - 1, EXIT_LADDER);
+                notifyTileChanged(x, world->mapHeight - 1);
+                EVENT_INFO("Exit ladder revealed at (%d, %d)", x, world->mapHeight - 1);
+            }
+        }
+        // Add more complex logic here if needed based on level design
+    }
+    // Simple fallback: Place one exit ladder at top center if others fail
+    bool foundExit = false;
+    for (int x = 0; x < world->mapWidth; ++x) if (world->level[world->mapHeight - 1][x] == EXIT_LADDER) foundExit = true;
+    if (!foundExit) {
+        int centerX = world->mapWidth / 2;
+        if (world->level[world->mapHeight - 2][centerX] == LADDER || world->level[world->mapHeight - 2][centerX] == EMPTY) {
+            setTile(centerX, world->mapHeight - 1, EXIT_LADDER);
+            notifyTileChanged(centerX, world->mapHeight - 1);
+            EVENT_INFO("Fallback exit ladder revealed at (%d, %d)", centerX, world->mapHeight - 1);
+        }
+    }
+
+}
+
+void killEnemy(int e) {
+    if (!world->entities.isAlive[e]) return; // Already dead/respawning
+
+    world->entities.isAlive[e] = false;
+    world->entities.isTrapped[e] = false; // Ensure not marked as trapped anymore
+    scheduleTimer(TIMER_ENTITY_BASE + e, world->timers.now + timerTicks(ENEMY_RESPAWN_DELAY)); // Start respawn timer
+    world->entities.vx[e] = 0;
+    world->entities.vy[e] = 0;
+    // Position will be reset when respawn timer finishes
+    EVENT_DEBUG("Enemy marked for respawn.");
+}
+
+
+// --- Collision & Grid Interaction ---
+
+// Simple Axis-Aligned Bounding Box collision check
+bool isColliding(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
+    return (x1 < x2 + w2 &&
+        x1 + w1 > x2 &&
+        y1 < y2 + h2 &&
+        y1 + h1 > y2);
+}
+
+// Gets the tile type at a specific world coordinate (x, y)
+// Takes dug holes into account.
+TileType getTileAt(float x, float y) {
+    int gridX = getGridX(x);
+    int gridY = getGridY(y);
+
+    // Bounds check
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) {
+        return SOLID_BRICK; // Treat out-of-bounds as solid
+    }
+
+    // Check for dug holes first - they act as EMPTY space for collision
+    if (world->dugHoles[gridY][gridX].active) {
+        return EMPTY;
+    }
+
+    // Return the actual tile type from the level grid
+    return world->level[gridY][gridX];
+}
+
+// Check if the entity can move to the target (x, y) position.
+// Checks collision with solid tiles based on entity's bounding box.
+// `onRope` and `isClimbing` flags influence how ladders/ropes are treated.
+bool canMoveTo(float x, float y, float width, float height, bool onRope, bool isClimbing) {
+    // The box's corners and center fall in the cells spanned by its edges, so one mask test
+    // per row over that span replaces sampling the 3x3 points individually.
+    // Ladders and ropes are passable either way; physics handles gravity/climbing speed.
+    return !spanAny(world->solidRows, getGridX(x), getGridX(x + width), getGridY(y), getGridY(y + height), true);
+}
+
+// --- Tile Contacts ---
+// Grid cells an entity's box covers, shared by the contact tests below so a caller that
+// needs several of them converts the position to cells once
+struct EntityCells {
+    int feetLeftX, feetRightX, belowY; // Ground samples, 1 pixel below the feet
+    int centreX, feetY;                // Centre column and the row the feet are in
+    int lowerY, upperY;                // Ladder samples near the feet and the head
+    int middleY;                       // Rope sample at mid-height
+};
+
+// Fills in the cells the `wanted` contacts read; the others are left as they were
+static void getEntityCells(int e, uint8_t wanted, EntityCells& cells) {
+    float entityWidth = TILE_SIZE * 0.8f;
+    float entityHeight = TILE_SIZE * 0.95f;
+    float x = world->entities.x[e];
+    float y = world->entities.y[e];
+    cells.centreX = getGridX(x + entityWidth / 2.0f);
+    if (wanted & CONTACT_GROUND) {
+        cells.feetLeftX = getGridX(x + entityWidth * 0.1f);
+        cells.feetRightX = getGridX(x + entityWidth * 0.9f);
+        cells.belowY = getGridY(y - 1.0f);
+        cells.feetY = getGridY(y);
+    }
+    if (wanted & (CONTACT_LADDER | CONTACT_WALL_LEFT | CONTACT_WALL_RIGHT)) {
+        cells.lowerY = getGridY(y + entityHeight * 0.1f);
+        cells.upperY = getGridY(y + entityHeight * 0.9f);
+    }
+    if (wanted & CONTACT_ROPE) cells.middleY = getGridY(y + entityHeight * 0.5f);
+}
+
+// Standing on Brick or Solid Brick anywhere between the outer feet samples, or on a trapped enemy's head
+static bool groundContact(int e, const EntityCells& cells) {
+    if (spanAny(world->solidRows, cells.feetLeftX, cells.feetRightX, cells.belowY, cells.belowY, true)) return true;
+
+    // A head we can stand on lies in the cell below us or beside it
+    float entityWidth = TILE_SIZE * 0.8f;
+    for (int gridY = cells.feetY - 1; gridY <= cells.feetY + 1; ++gridY) {
+        int begin, end;
+        spatialRowRange(SPATIAL_TRAPPED, cells.centreX - 1, cells.centreX + 1, gridY, begin, end);
+        for (int k = begin; k < end; ++k) {
+            int i = world->spatialEntities[k];
+            if (e != i && world->entities.isTrapped[i]) { // Check other entities that are trapped
+                float enemyHeadY = world->entities.y[i] + TILE_SIZE * 0.9f; // Approx head height
+                // Check if entity's feet are very close to the enemy's head Y
+                // and horizontally overlapping
+                if (fabs(world->entities.y[e] - enemyHeadY) < 5.0f &&
+                    world->entities.x[e] + entityWidth > world->entities.x[i] &&
+                    world->entities.x[e] < world->entities.x[i] + TILE_SIZE * 0.8f)
+                {
+                    return true; // Standing on trapped enemy head
+                }
+            }
+        }
+    }
+    return false; // Not on solid tile or trapped enemy
+}
+
+// Any central part overlaps with a ladder or exit ladder
+static bool ladderContact(const EntityCells& cells) {
+    return spanAny(world->climbableRows, cells.centreX, cells.centreX, cells.lowerY, cells.upperY, false);
+}
+
+// Rope at the vertical centre, with the feet reasonably close to the rope's level
+// (slightly above or below its row still counts as on it)
+static bool ropeContact(int e, const EntityCells& cells) {
+    if (!spanAny(world->hangableRows, cells.centreX, cells.centreX, cells.middleY, cells.middleY, false)) return false;
+    return fabs(world->entities.y[e] - cells.middleY * TILE_SIZE) < TILE_SIZE * 0.3f;
+}
+
+// Solid tile in the column just past one side, over the rows the box spans
+static bool wallContact(const EntityCells& cells, int gridX) {
+    return spanAny(world->solidRows, gridX, gridX, cells.lowerY, cells.upperY, true);
+}
+
+uint8_t getTileContacts(int e, uint8_t wanted) {
+    EntityCells cells = {};
+    getEntityCells(e, wanted, cells);
+    uint8_t contacts = 0;
+    if ((wanted & CONTACT_GROUND) && groundContact(e, cells)) contacts |= CONTACT_GROUND;
+    if ((wanted & CONTACT_LADDER) && ladderContact(cells)) contacts |= CONTACT_LADDER;
+    if ((wanted & CONTACT_ROPE) && ropeContact(e, cells)) contacts |= CONTACT_ROPE;
+    if (wanted & (CONTACT_WALL_LEFT | CONTACT_WALL_RIGHT)) {
+        float x = world->entities.x[e];
+        if ((wanted & CONTACT_WALL_LEFT) && wallContact(cells, getGridX(x - 1.0f))) contacts |= CONTACT_WALL_LEFT;
+        if ((wanted & CONTACT_WALL_RIGHT) && wallContact(cells, getGridX(x + TILE_SIZE * 0.8f + 1.0f))) contacts |= CONTACT_WALL_RIGHT;
+    }
+    return contacts;
+}
+
+// Check if the entity is standing on solid ground (Brick, Solid Brick, or trapped enemy head)
+bool isOnGround(int e) {
+    return getTileContacts(e, CONTACT_GROUND) != 0;
+}
+
+// Check if the entity is overlapping with a ladder tile at its center column
+bool isOnLadder(int e) {
+    return getTileContacts(e, CONTACT_LADDER) != 0;
+}
+
+// Check if the entity is overlapping with a rope tile near its vertical center
+// and is roughly horizontally aligned with it.
+bool checkOnRope(int e) {
+    return getTileContacts(e, CONTACT_ROPE) != 0;
+}
+
+// Creates a dug hole at the specified grid coordinates if possible
+void digHole(int gridX, int gridY) {
+    // Check bounds
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) {
+        LOG_WARNING("Dig attempt out of bounds (%d, %d)", gridX, gridY);
+        return;
+    }
+
+    // Check if the tile is diggable (only BRICK)
+    if (world->level[gridY][gridX] == BRICK) {
+        // Check if there's already a hole being dug here
+        DugHole& hole = world->dugHoles[gridY][gridX];
+        if (!hole.active) {
+            // Activate the cell's hole state and track it in the active list
+            hole.originalType = BRICK; // Store original type (always brick)
+            hole.active = true;
+            world->activeHoles[world->numActiveHoles++] = gridY * GRID_WIDTH + gridX;
+            scheduleTimer(gridY * GRID_WIDTH + gridX, world->timers.now + timerTicks(DIG_REFILL_TIME));
+            updateCellMasks(gridX, gridY); // Open hole is passable
+
+            notifyTileChanged(gridX, gridY);
+            // Don't change level[y][x] here; getTileAt handles checking dugHoles.
+            // The visual representation is handled in drawGrid.
+
+            EVENT_DEBUG("Dug hole initiated at (%d, %d)", gridX, gridY);
+            // Add digging sound effect here if possible
+        }
+        else {
+            // Optional: Prevent re-digging an existing hole? Or maybe reset timer?
+            // EVENT_DEBUG("Already digging at (%d, %d)", gridX, gridY);
+        }
+    }
+    else {
+        EVENT_DEBUG("Cannot dig non-brick tile type %d at (%d, %d)", static_cast<int>(world->level[gridY][gridX]), gridX, gridY);
+    }
+}
+
+// True if (gridX, gridY) is inside the grid and currently a dug hole
+bool isHoleAt(int gridX, int gridY) {
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) return false;
+    return world->dugHoles[gridY][gridX].active;
+}
+
+// Removes every hole without restoring tiles (used when the level is rebuilt)
+void clearDugHoles() {
+    for (int i = 0; i < world->numActiveHoles; ++i) {
+        int x = world->activeHoles[i] % GRID_WIDTH;
+        int y = world->activeHoles[i] / GRID_WIDTH;
+        world->dugHoles[y][x].active = false;
+        cancelTimer(world->activeHoles[i]);
+        updateCellMasks(x, y);
+    }
+    world->numActiveHoles = 0;
+}
+
+void removeActiveHole(int gridX, int gridY) {
+    int cell = gridY * GRID_WIDTH + gridX;
+    for (int i = 0; i < world->numActiveHoles; ++i) {
+        if (world->activeHoles[i] != cell) continue;
+        world->activeHoles[i] = world->activeHoles[--world->numActiveHoles]; // Swap-remove
+        return;
+    }
+}
+
+float holeTimeLeft(int gridX, int gridY) {
+    long due = world->timers.due[gridY * GRID_WIDTH + gridX];
+    if (!world->dugHoles[gridY][gridX].active || due == TIMER_NONE) return 0.0f;
+    return (due - world->timers.now) * world->tickTime;
+}
+
+// --- Packed Grid Masks ---
+
+void setTile(int gridX, int gridY, TileType type) {
+    world->level[gridY][gridX] = type;
+    updateCellMasks(gridX, gridY);
+}
+
+// Recomputes the mask bits of one cell from its tile and hole state
+void updateCellMasks(int gridX, int gridY) {
+    uint8_t flags = world->dugHoles[gridY][gridX].active ? 0 : TILE_FLAGS[world->level[gridY][gridX]];
+    RowMask bit = RowMask(1) << gridX;
+    world->solidRows[gridY] = (flags & TILE_SOLID) ? (world->solidRows[gridY] | bit) : (world->solidRows[gridY] & ~bit);
+    world->climbableRows[gridY] = (flags & TILE_CLIMBABLE) ? (world->climbableRows[gridY] | bit) : (world->climbableRows[gridY] & ~bit);
+    world->hangableRows[gridY] = (flags & TILE_HANGABLE) ? (world->hangableRows[gridY] | bit) : (world->hangableRows[gridY] & ~bit);
+    world->diggableRows[gridY] = (flags & TILE_DIGGABLE) ? (world->diggableRows[gridY] | bit) : (world->diggableRows[gridY] & ~bit);
+}
+
+void rebuildTileMasks() {
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        RowMask solid = 0, climbable = 0, hangable = 0, diggable = 0;
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            uint8_t flags = world->dugHoles[y][x].active ? 0 : TILE_FLAGS[world->level[y][x]];
+            RowMask bit = RowMask(1) << x;
+            if (flags & TILE_SOLID) solid |= bit;
+            if (flags & TILE_CLIMBABLE) climbable |= bit;
+            if (flags & TILE_HANGABLE) hangable |= bit;
+            if (flags & TILE_DIGGABLE) diggable |= bit;
+        }
+        world->solidRows[y] = solid;
+        world->climbableRows[y] = climbable;
+        world->hangableRows[y] = hangable;
+        world->diggableRows[y] = diggable;
+    }
+}
+
+// True if any cell in the inclusive rectangle [gridX0, gridX1] x [gridY0, gridY1] has its bit set
+// in `rows`. Cells outside the grid count as `outside` (true for solidity, matching getTileAt()).
+// Each row is answered with a single AND against a column-span mask.
+bool spanAny(const RowMask rows[], int gridX0, int gridX1, int gridY0, int gridY1, bool outside) {
+    if (gridX0 < 0 || gridX1 >= GRID_WIDTH || gridY0 < 0 || gridY1 >= GRID_HEIGHT) {
+        if (outside) return true;
+        if (gridX0 < 0) gridX0 = 0;
+        if (gridX1 >= GRID_WIDTH) gridX1 = GRID_WIDTH - 1;
+        if (gridY0 < 0) gridY0 = 0;
+        if (gridY1 >= GRID_HEIGHT) gridY1 = GRID_HEIGHT - 1;
+    }
+    if (gridX0 > gridX1 || gridY0 > gridY1) return false;
+
+    // Bits gridX0..gridX1 (the shift wraps to all ones for a full 64-column span)
+    RowMask span = ((RowMask(2) << (gridX1 - gridX0)) - 1) << gridX0;
+    for (int y = gridY0; y <= gridY1; ++y) {
+        if (rows[y] & span) return true;
+    }
+    return false;
+}
+
+// Walks rows fromY to toY (either direction, inclusive) and stops at the first with a bit in
+// columns [gridX0, gridX1], which it returns in `hitY`. Rows and columns outside the grid count
+// as set, as in spanAny() for solidity, so an entity moving more than a tile in one tick stops
+// at the first tile it crosses rather than only testing where it ends up.
+bool sweepRows(const RowMask rows[], int gridX0, int gridX1, int fromY, int toY, int& hitY) {
+    int step = (toY >= fromY) ? 1 : -1;
+    for (int y = fromY; ; y += step) {
+        if (spanAny(rows, gridX0, gridX1, y, y, true)) {
+            hitY = y;
+            return true;
+        }
+        if (y == toY) return false;
+    }
+}
+
+bool isSolidCell(int gridX, int gridY) {
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) return true;
+    return (world->solidRows[gridY] >> gridX) & 1;
+}
+
+// --- Navigation Graph ---
+
+void compileNavGraph() {
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        for (int x = 0; x < GRID_WIDTH; ++x) world->navGraph[y][x] = buildNavCell(x, y);
+    }
+}
+
+// Enemies treat open holes as walls so routes never lead into (or over) one
+uint8_t buildNavCell(int gridX, int gridY) {
+    if (isSolidCell(gridX, gridY) || isHoleAt(gridX, gridY)) return 0;
+    RowMask bit = RowMask(1) << gridX;
+    bool climbable = (world->climbableRows[gridY] & bit) != 0;
+    bool rope = (world->hangableRows[gridY] & bit) != 0;
+    bool ladderBelow = gridY > 0 && (world->climbableRows[gridY - 1] & bit);
+    bool standable = climbable || rope || ladderBelow || isSolidCell(gridX, gridY - 1); // Bottom edge counts as floor
+
+    uint8_t flags = 0;
+    auto open = [](int x, int y) { return !isSolidCell(x, y) && !isHoleAt(x, y); };
+    if (open(gridX, gridY - 1)) {
+        flags |= NAV_DOWN; // Falls and drops are always possible into an open cell
+        if (climbable || ladderBelow) flags |= NAV_LADDER_DOWN;
+    }
+    if (standable) {
+        flags |= NAV_STANDABLE;
+        if (rope) flags |= NAV_ROPE;
+        if (open(gridX - 1, gridY)) flags |= NAV_LEFT;
+        if (open(gridX + 1, gridY)) flags |= NAV_RIGHT;
+        if (climbable && open(gridX, gridY + 1)) flags |= NAV_UP;
+    }
+    return flags;
+}
+
+// A cell's moves depend on itself, the cell below (support) and its four neighbours (targets),
+// so a change at one cell touches only that cell and its four neighbours.
+bool updateNavAround(int gridX, int gridY) {
+    const int offsets[5][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    bool changed = false;
+    for (const auto& offset : offsets) {
+        int x = gridX + offset[0];
+        int y = gridY + offset[1];
+        if (x < 0 || x >= GRID_WIDTH || y < 0 || y >= GRID_HEIGHT) continue;
+        uint8_t flags = buildNavCell(x, y);
+        if (flags != world->navGraph[y][x]) {
+            world->navGraph[y][x] = flags;
+            updateFlowCell(x, y); // Its moves changed, so its best neighbour may have too
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool isStandable(int gridX, int gridY) {
+    if (gridX < 0 || gridX >= GRID_WIDTH || gridY < 0 || gridY >= GRID_HEIGHT) return false;
+    return (world->navGraph[gridY][gridX] & NAV_STANDABLE) != 0;
+}
+
+bool canStep(int fromX, int fromY, int toX, int toY) {
+    if (fromX < 0 || fromX >= GRID_WIDTH || fromY < 0 || fromY >= GRID_HEIGHT) return false;
+    uint8_t flags = world->navGraph[fromY][fromX];
+    if (toY == fromY) return (flags & (toX < fromX ? NAV_LEFT : NAV_RIGHT)) != 0;
+    return (flags & (toY > fromY ? NAV_UP : NAV_DOWN)) != 0;
+}
+
+// --- Enemy Pathfinding ---
+
+void getEntityCell(int e, int& gridX, int& gridY) {
+    gridX = getGridX(world->entities.x[e] + TILE_SIZE * 0.4f);
+    gridY = getGridY(world->entities.y[e] + TILE_SIZE * 0.475f);
+    if (gridX < 0) gridX = 0;
+    if (gridX >= GRID_WIDTH) gridX = GRID_WIDTH - 1;
+    if (gridY < 0) gridY = 0;
+    if (gridY >= GRID_HEIGHT) gridY = GRID_HEIGHT - 1;
+}
+
+// The flow field is maintained by an incremental planner (LPA* with no heuristic, i.e. an
+// incremental Dijkstra from the player's cell over reversed moves). A dig, refill or player
+// move only queues the cells it makes inconsistent; each tick then settles a bounded number
+// of them, cheapest first, so a change costs work proportional to the area it affects and
+// never more than the per-tick budget. Until settled, cells keep their previous distance.
+
+void resetFlowField() {
+    for (int y = 0; y < GRID_HEIGHT; ++y) {
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            world->flowDistance[y][x] = FLOW_UNREACHABLE;
+            world->flowRhs[y][x] = FLOW_UNREACHABLE;
+            world->flowQueuePos[y * GRID_WIDTH + x] = -1;
+        }
+    }
+    world->flowQueueSize = 0;
+    world->flowGoalX = -1;
+    world->flowGoalY = -1;
+}
+
+void updateFlowField() {
+    int goalX, goalY;
+    getEntityCell(PLAYER, goalX, goalY);
+    if (goalX != world->flowGoalX || goalY != world->flowGoalY) {
+        // Moving the goal is two local edits: the old cell loses its zero, the new one gains it
+        int oldX = world->flowGoalX, oldY = world->flowGoalY;
+        world->flowGoalX = goalX;
+        world->flowGoalY = goalY;
+        if (oldX >= 0) updateFlowCell(oldX, oldY);
+        updateFlowCell(goalX, goalY);
+    }
+
+    // Neighbour offset and the move it needs to step into the expanded cell
+    const int predecessors[4][3] = { { -1, 0, NAV_RIGHT }, { 1, 0, NAV_LEFT }, { 0, -1, NAV_UP }, { 0, 1, NAV_DOWN } };
+    for (int budget = FLOW_EXPANSIONS_PER_TICK; budget > 0 && world->flowQueueSize > 0; --budget) {
+        int cell = popFlowQueue();
+        int x = cell % GRID_WIDTH;
+        int y = cell / GRID_WIDTH;
+        if (world->flowDistance[y][x] > world->flowRhs[y][x]) {
+            world->flowDistance[y][x] = world->flowRhs[y][x]; // Got cheaper: settle it
+        }
+        else {
+            world->flowDistance[y][x] = FLOW_UNREACHABLE; // Got dearer: reopen it and let neighbours re-offer
+            updateFlowCell(x, y);
+        }
+        for (const auto& predecessor : predecessors) {
+            int fromX = x + predecessor[0];
+            int fromY = y + predecessor[1];
+            if (fromX < 0 || fromX >= GRID_WIDTH || fromY < 0 || fromY >= GRID_HEIGHT) continue;
+            if (world->navGraph[fromY][fromX] & predecessor[2]) updateFlowCell(fromX, fromY);
+        }
+    }
+}
+
+// Recomputes a cell's rhs from its moves and (re)queues it if it no longer matches its distance
+void updateFlowCell(int gridX, int gridY) {
+    if (world->flowGoalX < 0) return; // Nothing to route to until updateFlowField() sets the goal
+    int cell = gridY * GRID_WIDTH + gridX;
+    int rhs = FLOW_UNREACHABLE;
+    if (gridX == world->flowGoalX && gridY == world->flowGoalY) {
+        rhs = 0;
+    }
+    else {
+        uint8_t flags = world->navGraph[gridY][gridX];
+        if ((flags & NAV_LEFT) && world->flowDistance[gridY][gridX - 1] + 1 < rhs) rhs = world->flowDistance[gridY][gridX - 1] + 1;
+        if ((flags & NAV_RIGHT) && world->flowDistance[gridY][gridX + 1] + 1 < rhs) rhs = world->flowDistance[gridY][gridX + 1] + 1;
+        if ((flags & NAV_UP) && world->flowDistance[gridY + 1][gridX] + 1 < rhs) rhs = world->flowDistance[gridY + 1][gridX] + 1;
+        if ((flags & NAV_DOWN) && world->flowDistance[gridY - 1][gridX] + 1 < rhs) rhs = world->flowDistance[gridY - 1][gridX] + 1;
+    }
+    world->flowRhs[gridY][gridX] = rhs;
+
+    if (world->flowQueuePos[cell] >= 0) removeFlowQueue(cell);
+    if (world->flowDistance[gridY][gridX] != rhs) pushFlowQueue(cell, std::min(world->flowDistance[gridY][gridX], rhs));
+}
+
+// --- Flow Queue (binary heap with positions, for O(log n) removal) ---
+
+void pushFlowQueue(int cell, int key) {
+    int slot = world->flowQueueSize++;
+    world->flowQueueKey[cell] = key;
+    while (slot > 0) {
+        int parent = (slot - 1) / 2;
+        if (world->flowQueueKey[world->flowQueue[parent]] <= key) break;
+        world->flowQueue[slot] = world->flowQueue[parent];
+        world->flowQueuePos[world->flowQueue[slot]] = slot;
+        slot = parent;
+    }
+    world->flowQueue[slot] = cell;
+    world->flowQueuePos[cell] = slot;
+}
+
+int popFlowQueue() {
+    int cell = world->flowQueue[0];
+    removeFlowQueue(cell);
+    return cell;
+}
+
+void removeFlowQueue(int cell) {
+    int slot = world->flowQueuePos[cell];
+    world->flowQueuePos[cell] = -1;
+    int last = world->flowQueue[--world->flowQueueSize];
+    if (last == cell) return;
+
+    // Refill the hole with the last entry, sifting it up or down as its key requires
+    int key = world->flowQueueKey[last];
+    while (slot > 0 && world->flowQueueKey[world->flowQueue[(slot - 1) / 2]] > key) {
+        int parent = (slot - 1) / 2;
+        world->flowQueue[slot] = world->flowQueue[parent];
+        world->flowQueuePos[world->flowQueue[slot]] = slot;
+        slot = parent;
+    }
+    while (true) {
+        int child = slot * 2 + 1;
+        if (child >= world->flowQueueSize) break;
+        if (child + 1 < world->flowQueueSize && world->flowQueueKey[world->flowQueue[child + 1]] < world->flowQueueKey[world->flowQueue[child]]) child++;
+        if (world->flowQueueKey[world->flowQueue[child]] >= key) break;
+        world->flowQueue[slot] = world->flowQueue[child];
+        world->flowQueuePos[world->flowQueue[slot]] = slot;
+        slot = child;
+    }
+    world->flowQueue[slot] = last;
+    world->flowQueuePos[last] = slot;
+}
+
+// Velocity that moves `position` to `target` at up to `speed`, landing on it exactly
+float steerTowards(float position, float target, float speed, float deltaTime) {
+    float velocity = (target - position) / deltaTime;
+    if (fabs(target - position) < 0.01f) return 0.0f;
+    if (velocity > speed) return speed;
+    if (velocity < -speed) return -speed;
+    return velocity;
+}
+
+bool nextFlowStep(int gridX, int gridY, int& stepX, int& stepY) {
+    int best = world->flowDistance[gridY][gridX];
+    if (best == FLOW_UNREACHABLE || best == 0) return false;
+
+    const int offsets[4][2] = { { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 } }; // Ties prefer vertical moves
+    bool found = false;
+    for (const auto& offset : offsets) {
+        int toX = gridX + offset[0];
+        int toY = gridY + offset[1];
+        if (toX < 0 || toX >= GRID_WIDTH || toY < 0 || toY >= GRID_HEIGHT) continue;
+        int distance = world->flowDistance[toY][toX];
+        if (distance == FLOW_UNREACHABLE || distance >= best || !canStep(gridX, gridY, toX, toY)) continue;
+        best = distance;
+        stepX = offset[0];
+        stepY = offset[1];
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,399 @@
+/**
+ * Lode Runner simulation
+ *
+ * Level, entities, physics, digging and scoring, with no OpenGL/GLUT dependency.
+ * Shared by the game (lode_runner) and the headless runner (lode_runner_headless).
+ * The frontend owns the clock and the input devices: it calls stepSimulation() once
+ * per fixed tick with the buttons held, and listens for tile changes to redraw.
+ * All state lives in a World; set `world` to the session to act on before calling in.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "log.h"
+
+// --- Grid ---
+// Fixed storage for the largest map; a level uses the mapWidth x mapHeight cells in the
+// bottom-left corner and the rest is solid brick (see World).
+const int GRID_WIDTH = 64;  // Number of tiles horizontally
+const int GRID_HEIGHT = 64; // Number of tiles vertically
+const float TILE_SIZE = 40.0f; // Pixel size of a grid tile
+
+// --- Grid Coordinates ---
+// Pixel to cell without a division: truncate the product with the reciprocal, then step
+// the quotient by one where truncation (below zero) or rounding put it in the neighbouring
+// cell. A power-of-two TILE_SIZE has an exact reciprocal and only needs the step below
+// zero. Equal to floor(v / TILE_SIZE) while |v| < 2^24.
+constexpr bool isPowerOfTwo(float v) { // For whole v >= 1
+    return v == 1.0f || (v >= 2.0f && isPowerOfTwo(v * 0.5f));
+}
+
+inline int tileFloor(float v) {
+    int q = static_cast<int>(v * (1.0f / TILE_SIZE));
+    float edge = static_cast<float>(q) * TILE_SIZE; // Exact: a whole number of pixels
+    if (isPowerOfTwo(TILE_SIZE)) return q - (edge > v);
+    return q - (edge > v) + (edge + TILE_SIZE <= v);
+}
+
+inline int getGridX(float x) { return tileFloor(x); } // Grid X index of world X coordinate
+inline int getGridY(float y) { return tileFloor(y); } // Grid Y index of world Y coordinate
+
+// --- View ---
+// The window shows VIEW_WIDTH x VIEW_HEIGHT cells of a map that follow the player. Enemies
+// more than ENEMY_LOD_MARGIN cells outside that view are stepped only on every
+// ENEMY_LOD_INTERVAL-th tick (staggered by slot), with the time they skipped.
+const int VIEW_WIDTH = 20;
+const int VIEW_HEIGHT = 15;
+const int ENEMY_LOD_MARGIN = 2;   // Cells beyond the view still stepped every tick
+const int ENEMY_LOD_INTERVAL = 4; // Ticks per step for enemies further away
+
+// --- Physics & Movement ---
+const float PLAYER_SPEED = 150.0f; // Pixels per second
+const float ENEMY_SPEED = 120.0f;  // Pixels per second
+const float GRAVITY = 500.0f;    // Pixels per second squared
+const float JUMP_FORCE = 10.0f; // Lode Runner doesn't jump
+const float CLIMB_SPEED = 150.0f; // Pixels per second
+const float ROPE_SPEED = 150.0f; // Pixels per second (Speed moving horizontally on ropes)
+
+// --- Simulation Timing ---
+const int DEFAULT_TICK_RATE = 60;      // Fixed simulation ticks per second
+
+// --- Gameplay ---
+const int DEFAULT_ENEMIES = 3;  // Enemies per level unless numEnemies is changed before initGame()
+const int MAX_ENEMIES = 4096;   // Upper bound for numEnemies (stress levels)
+const int INITIAL_LIVES = 3;
+const float DIG_REFILL_TIME = 7.0f; // Seconds for a dug hole to refill
+const int POINTS_PER_COLLECTIBLE = 100;
+const float ENEMY_RESPAWN_DELAY = 3.0f; // Seconds before enemy respawns
+
+// --- Input ---
+// Buttons held during a tick, combined into the mask passed to stepSimulation()
+enum InputBit : uint8_t {
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_UP = 1 << 2,
+    INPUT_DOWN = 1 << 3,
+    INPUT_DIG_LEFT = 1 << 4,
+    INPUT_DIG_RIGHT = 1 << 5,
+    INPUT_JUMP = 1 << 6,
+};
+// Presses acted on once and then reported back as consumed (not held)
+const uint8_t INPUT_ONE_SHOT = INPUT_DIG_LEFT | INPUT_DIG_RIGHT | INPUT_JUMP;
+
+// --- Tile Types ---
+// Stored as one byte per cell so the whole grid stays within a few cache lines
+enum TileType : uint8_t {
+    EMPTY = 0,
+    BRICK = 1,       // Diggable
+    LADDER = 2,
+    ROPE = 3,        // Horizontal traversal
+    SOLID_BRICK = 4, // Indestructible
+    EXIT_LADDER = 5, // Appears after collecting all gold
+    // Removed DIGGING_BRICK, handled by the dugHoles grid
+};
+
+// --- Passability Flags ---
+// Per-tile properties, also kept as one bit per column in the row masks below
+enum TileFlag : uint8_t {
+    TILE_SOLID = 1 << 0,     // Blocks movement (Brick, Solid Brick)
+    TILE_CLIMBABLE = 1 << 1, // Ladder or exit ladder
+    TILE_HANGABLE = 1 << 2,  // Rope
+    TILE_DIGGABLE = 1 << 3,  // Brick that can be dug
+};
+
+// Flags for each TileType, indexed by its value
+const uint8_t TILE_FLAGS[] = {
+    0,                          // EMPTY
+    TILE_SOLID | TILE_DIGGABLE, // BRICK
+    TILE_CLIMBABLE,             // LADDER
+    TILE_HANGABLE,              // ROPE
+    TILE_SOLID,                 // SOLID_BRICK
+    TILE_CLIMBABLE,             // EXIT_LADDER
+};
+
+// One bit per column; GRID_WIDTH must fit in a single word per row
+typedef uint64_t RowMask;
+static_assert(GRID_WIDTH <= 64, "Row masks hold one bit per column in a 64-bit word");
+
+// --- Tile Contacts ---
+// What an entity's box touches, from one pass over the cells it covers (getTileContacts())
+enum TileContact : uint8_t {
+    CONTACT_GROUND = 1 << 0,     // Brick or solid brick just below the feet, or a trapped enemy's head (isOnGround())
+    CONTACT_LADDER = 1 << 1,     // Ladder along the centre line (isOnLadder())
+    CONTACT_ROPE = 1 << 2,       // Rope at mid-height with the feet near its row (checkOnRope())
+    CONTACT_WALL_LEFT = 1 << 3,  // Solid tile just past the left edge
+    CONTACT_WALL_RIGHT = 1 << 4, // Solid tile just past the right edge
+};
+const uint8_t CONTACT_ALL = 0x1F;
+
+// --- Entity Store ---
+// Structure of arrays with one slot per runner: the player in slot PLAYER, enemies in
+// [FIRST_ENEMY, count). Hot fields (position, velocity, movement state) are read and
+// written every tick and each lives in its own contiguous array; cold fields (timers,
+// spawn points) are kept apart so they don't share cache lines with the hot loops.
+// Flags are bytes rather than std::vector<bool> so they can be loaded as plain memory.
+const int PLAYER = 0;
+const int FIRST_ENEMY = 1;
+
+struct EntityStore {
+    int count = 0; // Slots in use (player + enemies)
+
+    // Hot
+    std::vector<float> x, y;          // Position (bottom-left corner)
+    std::vector<float> prevX, prevY;  // Position at the start of the last tick (for render interpolation)
+    std::vector<float> vx, vy;        // Velocity (pixels per second)
+    std::vector<float> nextX, nextY;  // Integrated position before collision (scratch, see integrateEntities())
+    std::vector<uint8_t> isClimbing;  // On ladder
+    std::vector<uint8_t> isOnRope;    // On rope
+    std::vector<uint8_t> isFalling;
+    std::vector<uint8_t> isJumping;
+    std::vector<uint8_t> faceRight;   // Direction facing
+    std::vector<uint8_t> isTrapped;   // If stuck in a dug hole
+    std::vector<uint8_t> isAlive;     // Enemy alive or waiting to respawn (the player always is)
+    std::vector<uint8_t> isDormant;   // Distant enemy not moved by this tick's batch (see ENEMY_LOD_INTERVAL)
+
+    // Cold
+    std::vector<float> sleepTime;     // Time a distant enemy has skipped since its last step (seconds)
+    std::vector<int> startGridX, startGridY; // Initial spawn point for respawning
+};
+
+// --- Dug Hole Structure ---
+// One per grid cell; a cell is a hole only while `active` is set. Its refill is a timer
+// in the wheel below (holeTimeLeft() for the time remaining).
+struct DugHole {
+    TileType originalType; // What the tile was before digging (should always be BRICK)
+    bool active;
+};
+
+// --- Timer Wheel ---
+// Hole refills, trap expiry and enemy respawns are scheduled for a tick and filed in the
+// wheel slot for that tick, so updateTimers() visits only the timers due now instead of
+// counting every hole and every trapped or dead runner down. A timer more than one turn
+// ahead waits in its slot for the turns in between. Each hole cell and each runner slot
+// has at most one timer pending, and that owner is its id: y * GRID_WIDTH + x for a hole,
+// TIMER_ENTITY_BASE + e for runner e (trap expiry while trapped, respawn while dead).
+const int TIMER_WHEEL_SLOTS = 512; // Power of two; 8.5 s at 60 Hz, so no timer waits a turn
+const int TIMER_ENTITY_BASE = GRID_HEIGHT * GRID_WIDTH;
+const int TIMER_IDS = TIMER_ENTITY_BASE + FIRST_ENEMY + MAX_ENEMIES;
+const int TIMER_NONE = -1;
+
+struct TimerWheel {
+    long now = 0;                    // Ticks advanced since initGame() (see updateTimers())
+    int head[TIMER_WHEEL_SLOTS];     // First timer in each slot, or TIMER_NONE
+    long due[TIMER_IDS];             // Tick each timer fires on, TIMER_NONE if not pending
+    int next[TIMER_IDS], prev[TIMER_IDS]; // Links within the slot's list
+    int pending = 0;
+};
+
+// --- Navigation Graph ---
+// One node per open cell, with the enemy moves out of it packed into a byte. Compiled
+// once by initLevel() and patched locally when a hole opens/refills or the exit appears,
+// so pathfinding reads adjacency bits instead of sampling tiles.
+enum NavFlag : uint8_t {
+    NAV_LEFT = 1 << 0,       // Walk or hang one cell left
+    NAV_RIGHT = 1 << 1,      // Walk or hang one cell right
+    NAV_UP = 1 << 2,         // Climb up the ladder
+    NAV_DOWN = 1 << 3,       // Climb down, drop from a rope/ledge or fall
+    NAV_STANDABLE = 1 << 4,  // Supported: floor or ladder below, or ladder/rope here
+    NAV_LADDER_DOWN = 1 << 5, // NAV_DOWN is a ladder climb rather than a drop
+    NAV_ROPE = 1 << 6,       // Hanging from a rope in this cell
+};
+
+// --- Enemy Pathfinding ---
+// Flow field: for every cell, the number of enemy moves (walk, climb, hang, drop/fall)
+// needed to reach the player's cell. Shared by all enemies, so each one steers with a
+// neighbour lookup instead of planning its own path. Repaired incrementally, see game.cpp.
+const int FLOW_UNREACHABLE = 1 << 20;       // Larger than any real distance, so comparisons just work
+const int FLOW_EXPANSIONS_PER_TICK = 128;  // Planner budget: cells settled per tick at most
+const int ENEMY_DECIDE_GRAIN = 256;        // Enemies per job when deciding moves in parallel (see jobs.h)
+
+// --- Spatial Index ---
+// Free and trapped enemies are bucketed separately: contact checks only want the free
+// ones and head-standing only the trapped ones, even when a crowd shares a cell.
+const int SPATIAL_FREE = 0;
+const int SPATIAL_TRAPPED = 1;
+const int SPATIAL_LAYERS = 2;
+
+// --- Tile Change Notification ---
+// Called whenever a cell's tile or hole state changes; (-1, -1) means the whole level.
+typedef void (*TileChangeListener)(int gridX, int gridY);
+
+// --- Level Source ---
+// A level's cells as tile letters (see initLevel()): `height` rows of `width` letters,
+// top row first. Maps larger than the grid are cropped to its bottom-left GRID_WIDTH x
+// GRID_HEIGHT cells: the top rows and rightmost columns are dropped.
+struct LevelView {
+    int width = 0;
+    int height = 0;
+    const char* cells = nullptr; // Not owned (e.g. points into a mapped level pack)
+};
+
+// --- World ---
+// Everything one game session owns. The simulation functions act on the calling thread's
+// current world, so independent sessions can be stepped side by side on different threads.
+struct World {
+    EntityStore entities;
+    int numEnemies = DEFAULT_ENEMIES; // Enemies spawned by initLevel(); set before initGame() to change
+    LevelView levelSource;            // Level built by initLevel(); the built-in level while cells is null
+    int mapWidth = GRID_WIDTH;        // Cells the level uses, from the bottom-left corner (set by initLevel())
+    int mapHeight = GRID_HEIGHT;
+    // Enemies split by state, rebuilt at the start of every updateEnemies()
+    std::vector<int> activeEnemies;  // Alive and free, near the view: AI + physics every tick
+    std::vector<int> distantEnemies; // Alive and free, catching up this tick on the ticks they skipped
+    std::vector<int> dormantEnemies; // Alive and free, far from the view, skipping this tick
+    std::vector<int> trappedEnemies; // Alive but in a hole: held in place, no AI
+    // Living enemies bucketed by layer and the cell holding their centre (see getEntityCell()),
+    // rebuilt by buildSpatialIndex(). Buckets cover the map only, so with cells = mapWidth * mapHeight
+    // bucket b = layer * cells + gridY * mapWidth + gridX holds spatialEntities[spatialCellStart[b]]
+    // up to spatialEntities[spatialCellStart[b + 1] - 1].
+    int spatialCellStart[SPATIAL_LAYERS * GRID_HEIGHT * GRID_WIDTH + 1] = {};
+    std::vector<int> spatialEntities;
+
+    TileType level[GRID_HEIGHT][GRID_WIDTH] = {};
+    // Passability masks per row, bit x set if cell (x, y) has the property.
+    // Derived from level and dugHoles (an open hole clears all bits); kept current by setTile()/updateCellMasks().
+    RowMask solidRows[GRID_HEIGHT] = {};
+    RowMask climbableRows[GRID_HEIGHT] = {};
+    RowMask hangableRows[GRID_HEIGHT] = {};
+    RowMask diggableRows[GRID_HEIGHT] = {};
+    DugHole dugHoles[GRID_HEIGHT][GRID_WIDTH] = {}; // Dense per-cell hole state, indexed [y][x]
+    int activeHoles[GRID_HEIGHT * GRID_WIDTH] = {}; // Cell indices (y * GRID_WIDTH + x) of active holes
+    int numActiveHoles = 0;                         // Valid entries in activeHoles
+    TimerWheel timers;
+
+    bool gameOver = false;
+    bool gameWon = false;
+    bool levelComplete = false; // True when all gold is collected
+
+    int collectibles[GRID_HEIGHT][GRID_WIDTH] = {}; // 1 if collectible exists
+    int collectiblesCollected = 0;
+    int totalCollectibles = 0;
+    int score = 0;
+    int lives = INITIAL_LIVES;
+
+    float gameTime = 0.0f; // Simulation time (seconds), also drives effects
+    long tickCount = 0;    // Ticks stepped since initGame()
+    float tickTime = 1.0f / DEFAULT_TICK_RATE; // Length of a tick (seconds), set by stepSimulation(); timers count in these
+    unsigned int seed = 0; // Passed to initGame(); with the inputs it reproduces the session
+    uint32_t rngState = 1; // randomInt() state, seeded by initGame()
+
+    uint8_t navGraph[GRID_HEIGHT][GRID_WIDTH] = {}; // NavFlag bits per cell, 0 for walls and holes
+    int flowDistance[GRID_HEIGHT][GRID_WIDTH] = {}; // Moves to the player's cell, or FLOW_UNREACHABLE (may lag by a few ticks)
+
+    TileChangeListener tileChangeListener = nullptr; // Renderer hook, unset when headless
+    bool logEvents = true; // Event messages (pickups, deaths, holes) go to the log (log.h); false silences them
+
+    // Internal to game.cpp
+    std::vector<int> spatialCellOf;                  // Bucket of each slot during buildSpatialIndex()
+    int flowRhs[GRID_HEIGHT][GRID_WIDTH] = {};       // One-step lookahead: 1 + best neighbour distance (0 at the goal)
+    int flowGoalX = -1, flowGoalY = -1;              // Player cell the planner is converging on, -1 until set
+    int flowQueue[GRID_HEIGHT * GRID_WIDTH] = {};    // Binary min-heap of inconsistent cells (cell index)
+    int flowQueueKey[GRID_HEIGHT * GRID_WIDTH] = {}; // Key each cell was queued with, min(distance, rhs)
+    int flowQueuePos[GRID_HEIGHT * GRID_WIDTH] = {}; // Heap slot per cell, -1 if not queued
+    int flowQueueSize = 0;
+};
+
+// Context for decideEnemies()
+struct DecideJob {
+    World* world;
+    const std::vector<int>* enemies; // Slots to decide, e.g. &world->activeEnemies
+    float deltaTime;                 // Each enemy also catches up on its sleepTime
+};
+
+// The world this thread's simulation calls read and write. Each frontend points it at a
+// World it owns before initGame(); the job system hands it on to the workers it uses.
+extern thread_local World* world;
+
+// --- Event Log ---
+// The current world's event messages, printf-style, unless the world is silenced (see log.h)
+#define EVENT_DEBUG(...) do { if (world->logEvents) LOG_DEBUG(__VA_ARGS__); } while (0)
+#define EVENT_INFO(...) do { if (world->logEvents) LOG_INFO(__VA_ARGS__); } while (0)
+#define EVENT_WARNING(...) do { if (world->logEvents) LOG_WARNING(__VA_ARGS__); } while (0)
+
+// --- Function Prototypes ---
+
+// Setup & Stepping
+void initGame(unsigned int seed); // Builds the level and resets all state; seeds randomInt()
+void initLevel();
+void initEntities();
+uint8_t stepSimulation(float tickTime, uint8_t input); // One fixed tick; returns the INPUT_ONE_SHOT bits consumed
+void setTileChangeListener(TileChangeListener listener);
+int randomInt(int range); // Uniform in [0, range) from the world's own generator
+void notifyTileChanged(int gridX, int gridY);
+// Bottom-left corner (pixels) of the view centred on (centreX, centreY), kept inside the map
+void getViewOrigin(float centreX, float centreY, float& originX, float& originY);
+
+// Entity Store
+void resizeEntities(int count); // Sets the number of slots (player + enemies)
+void updateEntityLists();       // Rebuilds the enemy lists by state and distance from the view
+
+// Spatial Index
+// Built at level start and after enemies move each tick. Entities overlap only if their
+// centres are in the same or adjacent cells, so contact queries scan a 3x3 block.
+void buildSpatialIndex();
+void spatialRowRange(int layer, int gridX0, int gridX1, int gridY, int& begin, int& end); // spatialEntities range for cells gridX0..gridX1 of a row
+
+// Updates
+uint8_t handleInput(uint8_t input, float deltaTime);
+void updatePlayer(float deltaTime);
+void updateEnemies(float deltaTime);
+void decideEnemy(int e, float deltaTime); // Enemy AI: velocity and climb/rope flags from the flow field
+void decideEnemies(int begin, int end, void* context); // JobFunction over a DecideJob's enemy list
+void updatePhysics(int e, float deltaTime); // Held in place while trapped, else integrate + resolve for one entity
+void integrateEntities(int first, int last, float deltaTime); // Gravity and motion for a slot range (SSE2 when available)
+void resolveCollisions(int e); // Tile/head collision, bounds and holes from nextX/nextY
+void updateTimers(); // Advances the timer wheel one tick and fires what is due
+void checkLevelCompletion();
+void revealExitLadder();
+void killEnemy(int e); // Function to handle enemy death/respawn start
+
+// Collision & Grid Interaction
+bool isColliding(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2);
+bool canMoveTo(float x, float y, float width, float height, bool onRope, bool isClimbing);
+TileType getTileAt(float x, float y);
+bool isOnGround(int e);
+bool isOnLadder(int e);
+bool checkOnRope(int e); // Renamed to avoid conflict
+uint8_t getTileContacts(int e, uint8_t wanted = CONTACT_ALL); // TileContact bits; only the `wanted` ones are tested
+void digHole(int gridX, int gridY);
+bool isHoleAt(int gridX, int gridY); // Bounds-checked dug hole query
+void setTile(int gridX, int gridY, TileType type); // Changes a tile and keeps the row masks in sync
+void updateCellMasks(int gridX, int gridY);
+void rebuildTileMasks();
+bool spanAny(const RowMask rows[], int gridX0, int gridX1, int gridY0, int gridY1, bool outside);
+bool sweepRows(const RowMask rows[], int gridX0, int gridX1, int fromY, int toY, int& hitY); // First row from fromY to toY with a bit in the span
+bool isSolidCell(int gridX, int gridY);
+void clearDugHoles();
+void removeActiveHole(int gridX, int gridY); // Drops a hole from the active list (not the hole itself)
+float holeTimeLeft(int gridX, int gridY);    // Seconds until the active hole at (gridX, gridY) refills
+
+// Timer Wheel
+void resetTimers(); // Cancels everything and restarts the clock
+void scheduleTimer(int id, long due); // Replaces the id's pending timer, if any; `due` must be after timers.now
+void cancelTimer(int id);
+long timerTicks(float seconds); // Ticks of world->tickTime covering `seconds`, at least one
+void fireTimer(int id);
+void refillHole(int gridX, int gridY); // Closes the hole, freeing or killing whoever is trapped in it
+void expireTrap(int e);  // Frees a runner whose hole closed without refilling on it
+void respawnEnemy(int e);
+
+// Navigation Graph
+void compileNavGraph();
+uint8_t buildNavCell(int gridX, int gridY); // NavFlag bits for one cell from the row masks and holes
+bool updateNavAround(int gridX, int gridY); // Re-derives the cells whose moves depend on (gridX, gridY); true if any changed
+bool isStandable(int gridX, int gridY); // Open cell an entity can stay in without falling
+bool canStep(int fromX, int fromY, int toX, int toY); // One enemy move between adjacent cells
+
+// Enemy Pathfinding
+void getEntityCell(int e, int& gridX, int& gridY); // Cell containing the entity's centre
+void resetFlowField(); // Forgets all distances (new level)
+void updateFlowField(); // Follows the player's cell and spends this tick's planner budget
+void updateFlowCell(int gridX, int gridY); // Re-evaluates one cell after its moves or neighbours changed
+void pushFlowQueue(int cell, int key);
+int popFlowQueue();
+void removeFlowQueue(int cell);
+bool nextFlowStep(int gridX, int gridY, int& stepX, int& stepY); // Neighbour one move closer to the player
+float steerTowards(float position, float target, float speed, float deltaTime);
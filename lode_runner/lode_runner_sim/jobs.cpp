@@ -0,0 +1,150 @@
+/**
+ * Lode Runner job system: per-worker job queues with stealing. See jobs.h.
+ */
+
+#include "jobs.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// --- Jobs ---
+struct Job {
+    JobFunction body;
+    void* context;
+    int begin, end;             // Sub-range of the parallelFor() loop
+    std::atomic<int>* pending;  // Jobs of that loop not finished yet
+};
+
+struct JobQueue {
+    std::mutex lock;
+    std::deque<Job> jobs; // Owner pops the back, thieves take the front
+};
+
+const int JOB_SPIN_ROUNDS = 256; // Steal attempts before an idle worker sleeps (ticks come in bursts)
+
+std::vector<std::thread> jobWorkers;
+std::deque<JobQueue> jobQueues;      // One per worker (deque: JobQueue is not movable)
+std::atomic<int> queuedJobs(0);      // Jobs sitting in any queue
+std::atomic<bool> jobsStopping(false);
+std::mutex jobSleepLock;
+std::condition_variable jobWake;
+unsigned int nextJobQueue = 0;       // Round-robin start for the next parallelFor()
+thread_local bool insideJob = false; // This thread is running a job; nested loops run inline
+
+// Takes a job from queue `own` (back), or else from any other queue (front)
+bool takeJob(int own, Job& job) {
+    int numQueues = static_cast<int>(jobQueues.size());
+    for (int k = 0; k < numQueues; ++k) {
+        int q = (own < 0 ? 0 : own) + k;
+        if (q >= numQueues) q -= numQueues;
+        JobQueue& queue = jobQueues[q];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) continue;
+        if (q == own) {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        else {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void runJob(const Job& job) {
+    bool outer = insideJob;
+    insideJob = true;
+    job.body(job.begin, job.end, job.context);
+    insideJob = outer;
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void jobWorkerMain(int own) {
+    int idleRounds = 0;
+    while (true) {
+        Job job;
+        if (takeJob(own, job)) {
+            runJob(job);
+            idleRounds = 0;
+            continue;
+        }
+        if (++idleRounds < JOB_SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> sleep(jobSleepLock);
+        jobWake.wait(sleep, [] { return jobsStopping.load() || queuedJobs.load() > 0; });
+        if (jobsStopping.load() && queuedJobs.load() == 0) return;
+        idleRounds = 0;
+    }
+}
+
+// --- Pool ---
+
+void startJobSystem(int workers) {
+    stopJobSystem();
+    if (workers < 0) {
+        int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        workers = hardware > 1 ? hardware - 1 : 0; // The calling thread works too
+    }
+    jobsStopping = false;
+    jobQueues.resize(workers);
+    for (int w = 0; w < workers; ++w) {
+        jobWorkers.emplace_back(jobWorkerMain, w);
+    }
+}
+
+void stopJobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(jobSleepLock);
+        jobsStopping = true;
+    }
+    jobWake.notify_all();
+    for (std::thread& worker : jobWorkers) worker.join();
+    jobWorkers.clear();
+    jobQueues.clear();
+}
+
+int jobWorkerCount() {
+    return static_cast<int>(jobWorkers.size());
+}
+
+void parallelFor(int count, int grain, JobFunction body, void* context) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    if (jobWorkers.empty() || count <= grain || insideJob) {
+        body(0, count, context);
+        return;
+    }
+
+    // Deal the chunks round-robin over the worker queues
+    std::atomic<int> pending(0);
+    int numChunks = (count + grain - 1) / grain;
+    pending = numChunks;
+    int numQueues = static_cast<int>(jobQueues.size());
+    for (int c = 0; c < numChunks; ++c) {
+        Job job = { body, context, c * grain, (c + 1) * grain < count ? (c + 1) * grain : count, &pending };
+        JobQueue& queue = jobQueues[(nextJobQueue + c) % numQueues];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.jobs.push_back(job);
+    }
+    nextJobQueue = (nextJobQueue + numChunks) % numQueues;
+    {
+        std::lock_guard<std::mutex> guard(jobSleepLock); // Pairs with the sleeping worker's check
+        queuedJobs.fetch_add(numChunks, std::memory_order_relaxed);
+    }
+    jobWake.notify_all();
+
+    // Help out until every chunk has finished, including those running on workers
+    while (pending.load(std::memory_order_acquire) > 0) {
+        Job job;
+        if (takeJob(-1, job)) runJob(job);
+        else std::this_thread::yield();
+    }
+}
@@ -0,0 +1,22 @@
+/**
+ * Lode Runner job system
+ *
+ * A small work-stealing thread pool for data-parallel loops inside a tick. Each worker
+ * owns a queue that it takes jobs from at the back; idle workers (and the thread that
+ * called parallelFor()) steal from the front of the others. Jobs must not write state
+ * another job reads. A parallelFor() inside a job runs inline on that job's thread, so
+ * an outer loop (e.g. over whole game worlds) keeps the workers busy by itself.
+ */
+
+#pragma once
+
+// Runs body(begin, end, context) over [begin, end) sub-ranges covering [0, count)
+typedef void (*JobFunction)(int begin, int end, void* context);
+
+void startJobSystem(int workers); // Spawns the worker threads; < 0 picks one per spare hardware thread
+void stopJobSystem();             // Finishes queued work and joins the workers
+int jobWorkerCount();             // Worker threads running (0 until startJobSystem())
+
+// Splits [0, count) into chunks of about `grain` items and waits until all have run.
+// Runs inline when there are no workers, the loop fits in a single chunk or it is nested.
+void parallelFor(int count, int grain, JobFunction body, void* context);
@@ -0,0 +1,215 @@
+/**
+ * Lode Runner level packs: memory-mapped binary packs and the text pack compiler.
+ * See levelpack.h.
+ */
+
+#include "levelpack.h"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// --- Mapping ---
+
+bool mapPackFile(const char* path, LevelPack& pack) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    pack.file = file;
+    pack.mapping = mapping;
+    pack.data = static_cast<const uint8_t*>(view);
+    pack.size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED) {
+        close(file);
+        return false;
+    }
+    pack.file = file;
+    pack.data = static_cast<const uint8_t*>(view);
+    pack.size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void closeLevelPack(LevelPack& pack) {
+    if (!pack.data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(pack.data);
+    CloseHandle(pack.mapping);
+    CloseHandle(pack.file);
+    pack.file = nullptr;
+    pack.mapping = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(pack.data), pack.size);
+    close(pack.file);
+    pack.file = -1;
+#endif
+    pack.data = nullptr;
+    pack.size = 0;
+    pack.levelCount = 0;
+}
+
+// --- Reading ---
+
+bool openLevelPack(const char* path, LevelPack& pack) {
+    closeLevelPack(pack);
+    if (!mapPackFile(path, pack)) {
+        std::cerr << "Cannot map level pack: " << path << std::endl;
+        return false;
+    }
+
+    LevelPackHeader header;
+    bool valid = pack.size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, pack.data, sizeof(header));
+        valid = header.magic == LEVEL_PACK_MAGIC && header.version == LEVEL_PACK_VERSION &&
+            header.levelCount <= (pack.size - sizeof(header)) / sizeof(LevelPackEntry);
+    }
+    if (!valid) {
+        std::cerr << path << ": not a version " << LEVEL_PACK_VERSION << " level pack" << std::endl;
+        closeLevelPack(pack);
+        return false;
+    }
+    pack.levelCount = static_cast<int>(header.levelCount);
+    return true;
+}
+
+bool getPackLevel(const LevelPack& pack, int index, LevelView& level, std::string* name) {
+    if (index < 0 || index >= pack.levelCount) return false;
+
+    // Only the index entry and this level's bytes are touched
+    LevelPackEntry entry;
+    std::memcpy(&entry, pack.data + sizeof(LevelPackHeader) + index * sizeof(LevelPackEntry), sizeof(entry));
+    size_t cells = static_cast<size_t>(entry.width) * entry.height;
+    if (entry.offset > pack.size || pack.size - entry.offset < entry.nameLength + cells) {
+        std::cerr << "Level pack entry " << index << " runs past the end of the file" << std::endl;
+        return false;
+    }
+
+    const char* base = reinterpret_cast<const char*>(pack.data + entry.offset);
+    if (name) name->assign(base, entry.nameLength);
+    level.width = entry.width;
+    level.height = entry.height;
+    level.cells = base + entry.nameLength;
+    return true;
+}
+
+// --- Authoring ---
+
+struct TextLevel {
+    std::string name;
+    std::vector<std::string> rows; // Top row first
+    size_t width = 0;
+};
+
+bool compileLevelPack(const char* textPath, const char* packPath) {
+    std::ifstream text(textPath);
+    if (!text) {
+        std::cerr << "Cannot open level text: " << textPath << std::endl;
+        return false;
+    }
+
+    std::vector<TextLevel> levels;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(text, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back(); // Files edited on Windows
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line.rfind("level", 0) == 0 && (line.size() == 5 || line[5] == ' ')) {
+            TextLevel level;
+            level.name = line.size() > 6 ? line.substr(6) : "Level " + std::to_string(levels.size() + 1);
+            levels.push_back(level);
+            continue;
+        }
+        if (levels.empty()) {
+            std::cerr << textPath << ":" << lineNumber << ": rows before the first 'level' line" << std::endl;
+            return false;
+        }
+        TextLevel& level = levels.back();
+        level.rows.push_back(line);
+        if (line.size() > level.width) level.width = line.size();
+        if (level.width > MAX_PACK_LEVEL_SIZE || level.rows.size() > MAX_PACK_LEVEL_SIZE) {
+            std::cerr << textPath << ":" << lineNumber << ": level too large for the pack format" << std::endl;
+            return false;
+        }
+    }
+
+    // Header and index first, then each level's name and padded rows
+    std::vector<char> pack(sizeof(LevelPackHeader) + levels.size() * sizeof(LevelPackEntry));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const TextLevel& level = levels[i];
+        if (level.rows.empty()) {
+            std::cerr << textPath << ": level '" << level.name << "' has no rows" << std::endl;
+            return false;
+        }
+
+        LevelPackEntry entry = {};
+        entry.offset = static_cast<uint32_t>(pack.size());
+        entry.width = static_cast<uint16_t>(level.width);
+        entry.height = static_cast<uint16_t>(level.rows.size());
+        entry.nameLength = static_cast<uint16_t>(std::min<size_t>(level.name.size(), 0xFFFF));
+        std::memcpy(pack.data() + sizeof(LevelPackHeader) + i * sizeof(LevelPackEntry), &entry, sizeof(entry));
+
+        pack.insert(pack.end(), level.name.begin(), level.name.begin() + entry.nameLength);
+        for (const std::string& row : level.rows) {
+            pack.insert(pack.end(), row.begin(), row.end());
+            pack.insert(pack.end(), level.width - row.size(), 'E');
+        }
+        if (level.width > static_cast<size_t>(GRID_WIDTH) || level.rows.size() > static_cast<size_t>(GRID_HEIGHT)) {
+            // initLevel() keeps the bottom-left corner, where the floor and the start are
+            bool tall = level.rows.size() > static_cast<size_t>(GRID_HEIGHT);
+            std::cerr << "Warning: level '" << level.name << "' is larger than the " << GRID_WIDTH << "x" << GRID_HEIGHT
+                << " grid and will be cropped to its bottom-left corner, dropping the";
+            if (tall) std::cerr << " top " << level.rows.size() - GRID_HEIGHT << " rows";
+            if (tall && level.width > static_cast<size_t>(GRID_WIDTH)) std::cerr << " and the";
+            if (level.width > static_cast<size_t>(GRID_WIDTH)) std::cerr << " rightmost " << level.width - GRID_WIDTH << " columns";
+            std::cerr << std::endl;
+        }
+    }
+
+    LevelPackHeader header = { LEVEL_PACK_MAGIC, LEVEL_PACK_VERSION, static_cast<uint32_t>(levels.size()), 0 };
+    std::memcpy(pack.data(), &header, sizeof(header));
+
+    std::ofstream out(packPath, std::ios::binary);
+    if (!out || !out.write(pack.data(), static_cast<std::streamsize>(pack.size()))) {
+        std::cerr << "Cannot write level pack: " << packPath << std::endl;
+        return false;
+    }
+    std::cout << "Packed " << levels.size() << " levels into " << packPath << " (" << pack.size() << " bytes)" << std::endl;
+    return true;
+}
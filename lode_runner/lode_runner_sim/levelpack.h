@@ -0,0 +1,65 @@
+/**
+ * Lode Runner level packs
+ *
+ * Text packs are for authoring. Each level starts with a "level <name>" line followed
+ * by its rows, top row first, in the tile letters initLevel() reads; lines starting
+ * with '#' are comments and empty lines are skipped. Short rows are padded with 'E'.
+ *
+ * compileLevelPack() turns a text pack into a binary pack: a header, an index with one
+ * entry per level, then each level's name and cells. Binary packs are memory-mapped,
+ * so opening one touches only the header and a level's cells are read when it is played.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "game.h"
+
+// --- Binary Layout ---
+// Little-endian: LevelPackHeader, LevelPackEntry[levelCount], then for each level its
+// name (nameLength bytes, no terminator) followed by width * height tile letters.
+const uint32_t LEVEL_PACK_MAGIC = 0x4B50524C; // "LRPK"
+const uint32_t LEVEL_PACK_VERSION = 1;
+const int MAX_PACK_LEVEL_SIZE = 0xFFFF; // Width/height limit of the format (the grid is smaller)
+
+struct LevelPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct LevelPackEntry {
+    uint32_t offset;     // From the start of the file to the level's name
+    uint16_t width;      // Cells
+    uint16_t height;     // Cells
+    uint16_t nameLength; // Bytes
+    uint16_t reserved;
+};
+
+static_assert(sizeof(LevelPackHeader) == 16 && sizeof(LevelPackEntry) == 12, "Pack structs are read straight from the file");
+
+// --- Mapped Pack ---
+struct LevelPack {
+    const uint8_t* data = nullptr; // Whole file, mapped read-only
+    size_t size = 0;
+    int levelCount = 0;
+#ifdef _WIN32
+    void* file = nullptr;          // HANDLEs
+    void* mapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+
+// Maps a binary pack and checks its header and index; false (with a message) if unusable
+bool openLevelPack(const char* path, LevelPack& pack);
+void closeLevelPack(LevelPack& pack);
+// View of one level's cells; valid until the pack is closed
+bool getPackLevel(const LevelPack& pack, int index, LevelView& level, std::string* name);
+
+// --- Authoring ---
+bool compileLevelPack(const char* textPath, const char* packPath); // Text pack in, binary pack out
@@ -0,0 +1,151 @@
+/**
+ * Lode Runner asynchronous log: the ring, its writer thread and the synchronous fallback.
+ * See log.h.
+ */
+
+#include "log.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// --- Ring ---
+// Bounded queue after Dmitry Vyukov's: each slot's sequence says whose turn it is. A producer
+// claims position p when sequence == p, fills the slot and publishes p + 1; the writer
+// takes it when sequence == p + 1 and hands it back for p + LOG_RING_SLOTS.
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+struct LogSlot {
+    std::atomic<unsigned> sequence;
+    LogLevel level;
+    char text[LOG_MESSAGE_SIZE];
+};
+
+struct Logger {
+    LogSlot slots[LOG_RING_SLOTS];
+    std::atomic<unsigned> claimed{ 0 };  // Next position a producer takes
+    std::atomic<unsigned> written{ 0 };  // Positions the writer has written out and flushed
+    std::atomic<long> dropped{ 0 };      // Messages lost to a full ring since the writer last reported
+    std::atomic<bool> running{ false };  // Writer thread is draining the ring
+    std::atomic<int> level{ LOG_LEVEL_INFO };
+    std::thread writer;
+};
+
+static Logger logger;
+
+static void writeLine(LogLevel level, const char* text) {
+    std::ostream& out = level >= LOG_LEVEL_WARNING ? std::cerr : std::cout;
+    if (level == LOG_LEVEL_WARNING) out << "Warning: ";
+    else if (level == LOG_LEVEL_ERROR) out << "Error: ";
+    out << text << '\n';
+}
+
+// Writer side: everything published so far, in order; returns the messages written
+static int drainLog() {
+    unsigned position = logger.written.load(std::memory_order_relaxed);
+    int count = 0;
+    for (;;) {
+        LogSlot& slot = logger.slots[position & (LOG_RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) break; // Not published yet
+        writeLine(slot.level, slot.text);
+        slot.sequence.store(position + LOG_RING_SLOTS, std::memory_order_release);
+        position++;
+        count++;
+    }
+    long dropped = logger.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) std::cerr << "Warning: the log was full; " << dropped << " messages dropped" << '\n';
+    if (count > 0 || dropped > 0) {
+        std::cout.flush();
+        std::cerr.flush();
+    }
+    logger.written.store(position, std::memory_order_release);
+    return count;
+}
+
+static void writerMain() {
+    while (logger.running.load(std::memory_order_acquire)) {
+        if (drainLog() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(LOG_DRAIN_INTERVAL_MS));
+    }
+    drainLog(); // Whatever came in while stopping
+}
+
+// --- Control ---
+
+void startLogger() {
+    if (logger.running.load()) return;
+    for (unsigned i = 0; i < static_cast<unsigned>(LOG_RING_SLOTS); ++i) logger.slots[i].sequence.store(i, std::memory_order_relaxed);
+    logger.claimed.store(0, std::memory_order_relaxed);
+    logger.written.store(0, std::memory_order_relaxed);
+    logger.running.store(true, std::memory_order_release);
+    logger.writer = std::thread(writerMain);
+}
+
+void stopLogger() {
+    if (!logger.running.load()) return;
+    logger.running.store(false, std::memory_order_release);
+    logger.writer.join();
+}
+
+void flushLog() {
+    if (!logger.running.load(std::memory_order_acquire)) return;
+    unsigned target = logger.claimed.load(std::memory_order_acquire);
+    while (static_cast<int>(logger.written.load(std::memory_order_acquire) - target) < 0) std::this_thread::yield();
+}
+
+void setLogLevel(LogLevel level) {
+    logger.level.store(level, std::memory_order_relaxed);
+}
+
+bool logLevelEnabled(LogLevel level) {
+    return level >= logger.level.load(std::memory_order_relaxed);
+}
+
+bool parseLogLevel(const char* name, LogLevel& level) {
+    static const char* const NAMES[] = { "debug", "info", "warning", "error", "off" };
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_OFF; ++i) {
+        if (strcmp(name, NAMES[i]) == 0) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- Producers ---
+
+void logMessage(LogLevel level, const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    if (!logger.running.load(std::memory_order_acquire)) {
+        char text[LOG_MESSAGE_SIZE];
+        vsnprintf(text, sizeof(text), format, arguments);
+        writeLine(level, text);
+        va_end(arguments);
+        return;
+    }
+
+    unsigned position = logger.claimed.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    for (;;) {
+        slot = &logger.slots[position & (LOG_RING_SLOTS - 1)];
+        int turn = static_cast<int>(slot->sequence.load(std::memory_order_acquire) - position);
+        if (turn == 0) {
+            if (logger.claimed.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        }
+        else if (turn < 0) { // The writer has not freed this slot yet: the ring is full
+            logger.dropped.fetch_add(1, std::memory_order_relaxed);
+            va_end(arguments);
+            return;
+        }
+        else {
+            position = logger.claimed.load(std::memory_order_relaxed); // Another producer took it
+        }
+    }
+    slot->level = level;
+    vsnprintf(slot->text, sizeof(slot->text), format, arguments);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    va_end(arguments);
+}
@@ -0,0 +1,67 @@
+/**
+ * Lode Runner asynchronous log
+ *
+ * Messages are formatted printf-style straight into a slot of a fixed, lock-free ring
+ * (multiple producers, one consumer) and written out by a background thread, so a tick
+ * that logs never waits on the console. A full ring drops the message and counts it
+ * rather than blocking; the writer reports the count. Before startLogger(), and after
+ * stopLogger(), messages are written synchronously instead.
+ *
+ * Messages below LODE_RUNNER_LOG_LEVEL are compiled out, arguments and all: debug
+ * messages exist in debug builds only. setLogLevel() filters further at run time.
+ */
+
+#pragma once
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG,   // Per-tick detail: holes dug and refilled, traps, respawns
+    LOG_LEVEL_INFO,    // Session events: pickups, captures, level complete
+    LOG_LEVEL_WARNING, // Something was wrong with the input but play goes on
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF,
+};
+
+#ifndef LODE_RUNNER_LOG_LEVEL
+#ifdef NDEBUG
+#define LODE_RUNNER_LOG_LEVEL 1 // LOG_LEVEL_INFO
+#else
+#define LODE_RUNNER_LOG_LEVEL 0 // LOG_LEVEL_DEBUG
+#endif
+#endif
+
+const int LOG_RING_SLOTS = 1024;   // Messages in flight; a power of two
+const int LOG_MESSAGE_SIZE = 120;  // Longer messages are cut short
+const int LOG_DRAIN_INTERVAL_MS = 5; // Writer's sleep when the ring is empty
+
+void startLogger(); // Starts the writer thread (stdout, stderr for warnings and errors)
+void stopLogger();  // Writes what is queued and joins the writer
+void flushLog();    // Waits until everything logged so far has been written
+void setLogLevel(LogLevel level); // Least severe level written (default LOG_LEVEL_INFO)
+bool logLevelEnabled(LogLevel level);
+void logMessage(LogLevel level, const char* format, ...);
+bool parseLogLevel(const char* name, LogLevel& level); // "debug", "info", "warning", "error" or "off"
+
+// --- Macros ---
+// A message is only formatted if its level is on: use these rather than logMessage()
+#define LOG_AT(level, ...) do { if (logLevelEnabled(level)) logMessage(level, __VA_ARGS__); } while (0)
+
+#if LODE_RUNNER_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LODE_RUNNER_LOG_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LODE_RUNNER_LOG_LEVEL <= 2
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#if LODE_RUNNER_LOG_LEVEL <= 3
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
@@ -0,0 +1,658 @@
+/**
+ * Lode Runner networked sessions: wire state, frames, sockets, server and client. See net.h.
+ */
+
+#include "net.h"
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+// --- Encoding ---
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    do { // LEB128: seven bits per byte, high bit set while more follow
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out.push_back(value ? (byte | 0x80) : byte);
+    } while (value);
+}
+
+void putSigned(std::vector<uint8_t>& out, int32_t value) {
+    putVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31)); // Zigzag: small magnitudes stay short
+}
+
+// Reads from data[at], advancing `at`; false past the end or on an overlong varint
+bool getVarint(const std::vector<uint8_t>& data, size_t& at, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (at >= data.size()) return false;
+        uint8_t byte = data[at++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getSigned(const std::vector<uint8_t>& data, size_t& at, int32_t& value) {
+    uint32_t zigzag;
+    if (!getVarint(data, at, zigzag)) return false;
+    value = static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+    return true;
+}
+
+bool getByte(const std::vector<uint8_t>& data, size_t& at, uint8_t& value) {
+    if (at >= data.size()) return false;
+    value = data[at++];
+    return true;
+}
+
+void putWord(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+uint32_t getWord(const std::vector<uint8_t>& data, size_t at) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(data[at + i]) << (8 * i);
+    return value;
+}
+
+// --- Wire State ---
+
+int32_t quantizePosition(float position) {
+    return static_cast<int32_t>(floorf(position * NET_POSITION_SCALE + 0.5f));
+}
+
+void captureNetState(NetState& state) {
+    state.tick = world->tickCount;
+    state.mapWidth = world->mapWidth;
+    state.mapHeight = world->mapHeight;
+    for (int y = 0; y < world->mapHeight; ++y) {
+        for (int x = 0; x < world->mapWidth; ++x) {
+            uint8_t cell = static_cast<uint8_t>(world->level[y][x]);
+            if (world->dugHoles[y][x].active) cell |= NET_CELL_HOLE;
+            if (world->collectibles[y][x]) cell |= NET_CELL_GOLD;
+            state.cells[y * GRID_WIDTH + x] = cell;
+        }
+    }
+
+    const EntityStore& entities = world->entities;
+    state.entities.resize(entities.count);
+    for (int i = 0; i < entities.count; ++i) {
+        NetEntity& entity = state.entities[i];
+        entity.x = quantizePosition(entities.x[i]);
+        entity.y = quantizePosition(entities.y[i]);
+        entity.flags = (entities.isAlive[i] ? NET_ALIVE : 0) | (entities.isTrapped[i] ? NET_TRAPPED : 0) |
+            (entities.faceRight[i] ? NET_FACE_RIGHT : 0) | (entities.isClimbing[i] ? NET_CLIMBING : 0) |
+            (entities.isOnRope[i] ? NET_ON_ROPE : 0) | (entities.isFalling[i] ? NET_FALLING : 0);
+    }
+    state.score = world->score;
+    state.lives = world->lives;
+    state.gold = world->collectiblesCollected;
+    state.status = (world->gameOver ? NET_GAME_OVER : 0) | (world->gameWon ? NET_GAME_WON : 0) |
+        (world->levelComplete ? NET_LEVEL_COMPLETE : 0);
+}
+
+uint32_t netStateHash(const NetState& state) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            hash ^= (value >> (8 * i)) & 0xFF;
+            hash *= 16777619u;
+        }
+    };
+    for (int y = 0; y < state.mapHeight; ++y) {
+        for (int x = 0; x < state.mapWidth; ++x) {
+            hash ^= state.cells[y * GRID_WIDTH + x];
+            hash *= 16777619u;
+        }
+    }
+    for (const NetEntity& entity : state.entities) {
+        mix(static_cast<uint32_t>(entity.x));
+        mix(static_cast<uint32_t>(entity.y));
+        mix(entity.flags);
+    }
+    mix(static_cast<uint32_t>(state.score));
+    mix(static_cast<uint32_t>(state.lives));
+    mix(static_cast<uint32_t>(state.gold));
+    mix(state.status);
+    return hash;
+}
+
+// Removes the hole at (x, y) without the refill's side effects (used when snapping)
+void closeHole(int x, int y) {
+    removeActiveHole(x, y);
+    cancelTimer(y * GRID_WIDTH + x);
+    world->dugHoles[y][x].active = false;
+    setTile(x, y, world->dugHoles[y][x].originalType);
+    notifyTileChanged(x, y);
+}
+
+void applyNetState(const NetState& state) {
+    for (int y = 0; y < state.mapHeight && y < world->mapHeight; ++y) {
+        for (int x = 0; x < state.mapWidth && x < world->mapWidth; ++x) {
+            uint8_t cell = state.cells[y * GRID_WIDTH + x];
+            TileType type = static_cast<TileType>(cell & NET_CELL_TILE);
+            bool hole = (cell & NET_CELL_HOLE) != 0;
+            if (world->dugHoles[y][x].active && !hole) closeHole(x, y);
+            if (world->level[y][x] != type) {
+                setTile(x, y, type);
+                notifyTileChanged(x, y);
+            }
+            if (hole && !world->dugHoles[y][x].active) digHole(x, y); // A full refill time: the server does not send timers
+            int gold = (cell & NET_CELL_GOLD) ? 1 : 0;
+            if (world->collectibles[y][x] != gold) {
+                world->collectibles[y][x] = gold;
+                notifyTileChanged(x, y);
+            }
+        }
+    }
+
+    EntityStore& entities = world->entities;
+    for (int i = 0; i < entities.count && i < static_cast<int>(state.entities.size()); ++i) {
+        const NetEntity& entity = state.entities[i];
+        entities.x[i] = entity.x / NET_POSITION_SCALE;
+        entities.y[i] = entity.y / NET_POSITION_SCALE;
+        entities.isAlive[i] = (entity.flags & NET_ALIVE) != 0;
+        entities.isTrapped[i] = (entity.flags & NET_TRAPPED) != 0;
+        entities.faceRight[i] = (entity.flags & NET_FACE_RIGHT) != 0;
+        entities.isClimbing[i] = (entity.flags & NET_CLIMBING) != 0;
+        entities.isOnRope[i] = (entity.flags & NET_ON_ROPE) != 0;
+        entities.isFalling[i] = (entity.flags & NET_FALLING) != 0;
+    }
+    world->score = state.score;
+    world->lives = state.lives;
+    world->collectiblesCollected = state.gold;
+    world->gameOver = (state.status & NET_GAME_OVER) != 0;
+    world->gameWon = (state.status & NET_GAME_WON) != 0;
+    world->levelComplete = (state.status & NET_LEVEL_COMPLETE) != 0;
+    buildSpatialIndex(); // Positions moved under it
+}
+
+// --- Frames ---
+// tick, input (byte), score, lives, gold, status (byte), runner count, then the changed
+// cells (count, then per cell the gap from the previous changed cell and its byte) and
+// the changed runners (count, then per runner the slot gap, x and y deltas and flags).
+// Cells are numbered row by row over the map only.
+
+void encodeNetFrame(const NetState& previous, const NetState& current, uint8_t input, std::vector<uint8_t>& out) {
+    putVarint(out, static_cast<uint32_t>(current.tick));
+    out.push_back(input);
+    putVarint(out, static_cast<uint32_t>(current.score));
+    putVarint(out, static_cast<uint32_t>(current.lives));
+    putVarint(out, static_cast<uint32_t>(current.gold));
+    out.push_back(current.status);
+    putVarint(out, static_cast<uint32_t>(current.entities.size()));
+
+    std::vector<uint8_t> changes;
+    uint32_t count = 0;
+    int last = -1;
+    for (int y = 0; y < current.mapHeight; ++y) {
+        for (int x = 0; x < current.mapWidth; ++x) {
+            uint8_t cell = current.cells[y * GRID_WIDTH + x];
+            if (cell == previous.cells[y * GRID_WIDTH + x]) continue;
+            int index = y * current.mapWidth + x;
+            putVarint(changes, static_cast<uint32_t>(index - last - 1));
+            changes.push_back(cell);
+            last = index;
+            count++;
+        }
+    }
+    putVarint(out, count);
+    out.insert(out.end(), changes.begin(), changes.end());
+
+    changes.clear();
+    count = 0;
+    last = -1;
+    static const NetEntity unseen = { 0, 0, 0 }; // Baseline for slots the previous state lacks
+    for (size_t i = 0; i < current.entities.size(); ++i) {
+        const NetEntity& entity = current.entities[i];
+        const NetEntity& before = i < previous.entities.size() ? previous.entities[i] : unseen;
+        if (entity.x == before.x && entity.y == before.y && entity.flags == before.flags) continue;
+        putVarint(changes, static_cast<uint32_t>(static_cast<int>(i) - last - 1));
+        putSigned(changes, entity.x - before.x);
+        putSigned(changes, entity.y - before.y);
+        changes.push_back(entity.flags);
+        last = static_cast<int>(i);
+        count++;
+    }
+    putVarint(out, count);
+    out.insert(out.end(), changes.begin(), changes.end());
+}
+
+bool decodeNetFrame(const std::vector<uint8_t>& frame, NetState& state, uint8_t& input) {
+    size_t at = 0;
+    uint32_t tick, score, lives, gold, entityCount, count;
+    if (!getVarint(frame, at, tick) || !getByte(frame, at, input) || !getVarint(frame, at, score) ||
+        !getVarint(frame, at, lives) || !getVarint(frame, at, gold) || !getByte(frame, at, state.status) ||
+        !getVarint(frame, at, entityCount) || entityCount > static_cast<uint32_t>(SNAPSHOT_SLOTS)) {
+        return false;
+    }
+    state.tick = tick;
+    state.score = static_cast<int>(score);
+    state.lives = static_cast<int>(lives);
+    state.gold = static_cast<int>(gold);
+    state.entities.resize(entityCount, NetEntity{ 0, 0, 0 });
+
+    if (!getVarint(frame, at, count)) return false;
+    int cells = state.mapWidth * state.mapHeight;
+    int index = -1;
+    for (uint32_t k = 0; k < count; ++k) {
+        uint32_t gap;
+        uint8_t cell;
+        if (!getVarint(frame, at, gap) || !getByte(frame, at, cell)) return false;
+        index += static_cast<int>(gap) + 1;
+        if (index >= cells) return false;
+        state.cells[(index / state.mapWidth) * GRID_WIDTH + index % state.mapWidth] = cell;
+    }
+
+    if (!getVarint(frame, at, count)) return false;
+    int slot = -1;
+    for (uint32_t k = 0; k < count; ++k) {
+        uint32_t gap;
+        int32_t dx, dy;
+        uint8_t flags;
+        if (!getVarint(frame, at, gap) || !getSigned(frame, at, dx) || !getSigned(frame, at, dy) || !getByte(frame, at, flags)) return false;
+        slot += static_cast<int>(gap) + 1;
+        if (slot >= static_cast<int>(entityCount)) return false;
+        NetEntity& entity = state.entities[slot];
+        entity.x += dx;
+        entity.y += dy;
+        entity.flags = flags;
+    }
+    return at == frame.size();
+}
+
+// --- Sockets ---
+
+#ifdef _WIN32
+typedef SOCKET NativeSocket;
+typedef int SocketLength;
+const int SEND_FLAGS = 0;
+void closeSocket(NetSocket socket) { closesocket(static_cast<SOCKET>(socket)); }
+bool socketWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+typedef int NativeSocket;
+typedef socklen_t SocketLength;
+const int SEND_FLAGS = MSG_NOSIGNAL; // A vanished peer is an error return, not SIGPIPE
+void closeSocket(NetSocket socket) { close(static_cast<int>(socket)); }
+bool socketWouldBlock() { return errno == EWOULDBLOCK || errno == EAGAIN; }
+#endif
+
+NativeSocket native(NetSocket socket) {
+    return static_cast<NativeSocket>(socket);
+}
+
+bool startSockets() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+        started = true;
+    }
+#endif
+    return true;
+}
+
+// Non-blocking, and without Nagle's delay: frames are small and should leave at once
+void configureSocket(NetSocket socket) {
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(static_cast<SOCKET>(socket), FIONBIO, &nonBlocking);
+#else
+    fcntl(native(socket), F_SETFL, fcntl(native(socket), F_GETFL, 0) | O_NONBLOCK);
+#endif
+    int noDelay = 1;
+    setsockopt(native(socket), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+}
+
+// Waits until the socket can be read (or written); false on timeout
+bool waitForSocket(NetSocket socket, bool write, int timeoutMs) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(native(socket), &set);
+    timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    return select(static_cast<int>(socket) + 1, write ? nullptr : &set, write ? &set : nullptr, nullptr, &timeout) > 0;
+}
+
+bool netConnected(const NetConnection& connection) {
+    return connection.socket != NET_NO_SOCKET;
+}
+
+void closeNetConnection(NetConnection& connection) {
+    if (connection.socket != NET_NO_SOCKET) closeSocket(connection.socket);
+    connection.socket = NET_NO_SOCKET;
+    connection.received.clear();
+}
+
+bool sendNetMessage(NetConnection& connection, uint8_t type, const std::vector<uint8_t>& payload) {
+    if (!netConnected(connection)) return false;
+    std::vector<uint8_t> message;
+    message.push_back(type);
+    putVarint(message, static_cast<uint32_t>(payload.size()));
+    message.insert(message.end(), payload.begin(), payload.end());
+
+    size_t sent = 0;
+    while (sent < message.size()) {
+        int result = send(native(connection.socket), reinterpret_cast<const char*>(message.data() + sent),
+            static_cast<int>(message.size() - sent), SEND_FLAGS);
+        if (result > 0) {
+            sent += static_cast<size_t>(result);
+            continue;
+        }
+        if (result < 0 && socketWouldBlock() && waitForSocket(connection.socket, true, 1000)) continue;
+        closeNetConnection(connection); // Peer gone, or stalled for a second
+        return false;
+    }
+    connection.bytesSent += static_cast<long>(message.size());
+    return true;
+}
+
+bool receiveNetMessage(NetConnection& connection, uint8_t& type, std::vector<uint8_t>& payload, int timeoutMs) {
+    while (netConnected(connection)) {
+        // A whole message buffered already?
+        size_t at = 1;
+        uint32_t length;
+        if (connection.received.size() > 1 && getVarint(connection.received, at, length) && connection.received.size() - at >= length) {
+            type = connection.received[0];
+            payload.assign(connection.received.begin() + at, connection.received.begin() + at + length);
+            connection.received.erase(connection.received.begin(), connection.received.begin() + at + length);
+            return true;
+        }
+
+        uint8_t buffer[4096];
+        int result = recv(native(connection.socket), reinterpret_cast<char*>(buffer), sizeof(buffer), 0);
+        if (result > 0) {
+            connection.received.insert(connection.received.end(), buffer, buffer + result);
+            connection.bytesReceived += result;
+            continue;
+        }
+        if (result < 0 && socketWouldBlock()) {
+            if (timeoutMs > 0 && waitForSocket(connection.socket, false, timeoutMs)) continue;
+            return false;
+        }
+        closeNetConnection(connection); // Closed by the peer, or failed
+    }
+    return false;
+}
+
+// --- Server ---
+
+bool startNetServer(NetServer& server, int port) {
+    if (!startSockets()) return false;
+    NetSocket listener = static_cast<NetSocket>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (listener == NET_NO_SOCKET) return false;
+    int reuse = 1;
+    setsockopt(native(listener), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(native(listener), reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(native(listener), 1) != 0) {
+        std::cerr << "Cannot listen on port " << port << std::endl;
+        closeSocket(listener);
+        return false;
+    }
+    server.listener = listener;
+    return true;
+}
+
+bool acceptNetClient(NetServer& server) {
+    while (server.listener != NET_NO_SOCKET) {
+        NetSocket socket = static_cast<NetSocket>(accept(native(server.listener), nullptr, nullptr));
+        if (socket == NET_NO_SOCKET) return false;
+        closeNetConnection(server.client);
+        server.client.socket = socket;
+        configureSocket(socket);
+
+        uint8_t type;
+        std::vector<uint8_t> payload;
+        if (receiveNetMessage(server.client, type, payload, 5000) && type == NET_HELLO && payload.size() == 8 &&
+            getWord(payload, 0) == NET_MAGIC && getWord(payload, 4) == NET_VERSION) {
+            return true;
+        }
+        std::cerr << "Dropped a connection that is not a version " << NET_VERSION << " client" << std::endl;
+        closeNetConnection(server.client);
+    }
+    return false;
+}
+
+void beginNetSession(NetServer& server, const NetSessionInfo& session) {
+    std::vector<uint8_t> payload;
+    putWord(payload, session.seed);
+    putVarint(payload, static_cast<uint32_t>(session.tickRate));
+    putVarint(payload, static_cast<uint32_t>(session.enemies));
+    putSigned(payload, session.level);
+    putVarint(payload, static_cast<uint32_t>(world->mapWidth));
+    putVarint(payload, static_cast<uint32_t>(world->mapHeight));
+    sendNetMessage(server.client, NET_WELCOME, payload);
+
+    // Keyframe: everything, against an empty state
+    server.sent = NetState();
+    captureNetState(server.current);
+    payload.clear();
+    encodeNetFrame(server.sent, server.current, 0, payload);
+    sendNetMessage(server.client, NET_FRAME, payload);
+    std::swap(server.sent, server.current);
+
+    for (int k = 0; k < NET_HISTORY_TICKS; ++k) server.queuedTick[k] = -1;
+    server.held = 0;
+    server.lateInputs = 0;
+}
+
+uint8_t nextNetInput(NetServer& server) {
+    long tick = world->tickCount;
+    uint8_t type;
+    std::vector<uint8_t> payload;
+    while (receiveNetMessage(server.client, type, payload, 0)) {
+        if (type == NET_BYE) {
+            closeNetConnection(server.client);
+            break;
+        }
+        size_t at = 0;
+        uint32_t inputTick;
+        uint8_t mask;
+        if (type != NET_INPUT || !getVarint(payload, at, inputTick) || !getByte(payload, at, mask)) continue;
+        if (static_cast<long>(inputTick) < tick) {
+            server.held = mask; // Too late for its tick: applied from now on, and the client rolls back
+            server.lateInputs++;
+        }
+        else if (static_cast<long>(inputTick) < tick + NET_HISTORY_TICKS) {
+            server.queuedInput[inputTick % NET_HISTORY_TICKS] = mask;
+            server.queuedTick[inputTick % NET_HISTORY_TICKS] = inputTick;
+        }
+    }
+    if (server.queuedTick[tick % NET_HISTORY_TICKS] == tick) server.held = server.queuedInput[tick % NET_HISTORY_TICKS];
+    return server.held;
+}
+
+void sendNetFrame(NetServer& server, uint8_t input, uint8_t consumed) {
+    server.held &= ~(consumed & INPUT_ONE_SHOT); // A press repeated while waiting for input acts once
+    captureNetState(server.current);
+    std::vector<uint8_t> payload;
+    encodeNetFrame(server.sent, server.current, input, payload);
+    sendNetMessage(server.client, NET_FRAME, payload);
+    std::swap(server.sent, server.current);
+}
+
+void endNetSession(NetServer& server) {
+    sendNetMessage(server.client, NET_BYE, std::vector<uint8_t>());
+    closeNetConnection(server.client);
+}
+
+void stopNetServer(NetServer& server) {
+    closeNetConnection(server.client);
+    if (server.listener != NET_NO_SOCKET) closeSocket(server.listener);
+    server.listener = NET_NO_SOCKET;
+}
+
+// --- Client ---
+
+bool connectNetClient(NetClient& client, const char* host, int port) {
+    if (!startSockets()) return false;
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host, service.c_str(), &hints, &addresses) != 0 || !addresses) {
+        std::cerr << "Cannot resolve " << host << std::endl;
+        return false;
+    }
+    NetSocket socket = static_cast<NetSocket>(::socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol));
+    bool connected = socket != NET_NO_SOCKET &&
+        connect(native(socket), addresses->ai_addr, static_cast<SocketLength>(addresses->ai_addrlen)) == 0;
+    freeaddrinfo(addresses);
+    if (!connected) {
+        std::cerr << "Cannot connect to " << host << ":" << port << std::endl;
+        if (socket != NET_NO_SOCKET) closeSocket(socket);
+        return false;
+    }
+    client.connection.socket = socket;
+    configureSocket(socket);
+
+    std::vector<uint8_t> payload;
+    putWord(payload, NET_MAGIC);
+    putWord(payload, NET_VERSION);
+    sendNetMessage(client.connection, NET_HELLO, payload);
+
+    // The server answers once its session is built
+    uint8_t type;
+    size_t at = 4;
+    uint32_t tickRate, enemies, mapWidth, mapHeight;
+    int32_t level;
+    if (!receiveNetMessage(client.connection, type, payload, 10000) || type != NET_WELCOME || payload.size() < 4 ||
+        !getVarint(payload, at, tickRate) || !getVarint(payload, at, enemies) || !getSigned(payload, at, level) ||
+        !getVarint(payload, at, mapWidth) || !getVarint(payload, at, mapHeight) ||
+        mapWidth > static_cast<uint32_t>(GRID_WIDTH) || mapHeight > static_cast<uint32_t>(GRID_HEIGHT)) {
+        std::cerr << "No session from " << host << ":" << port << std::endl;
+        closeNetConnection(client.connection);
+        return false;
+    }
+    client.session.seed = getWord(payload, 0);
+    client.session.tickRate = static_cast<int>(tickRate);
+    client.session.enemies = static_cast<int>(enemies);
+    client.session.level = level;
+    client.mirror = NetState();
+    client.mirror.mapWidth = static_cast<int>(mapWidth);
+    client.mirror.mapHeight = static_cast<int>(mapHeight);
+    return true;
+}
+
+// Steps the local world one tick and remembers what it looked like before and after
+uint8_t predictNetTick(NetClient& client, float tickTime, uint8_t input) {
+    long tick = world->tickCount;
+    pushSnapshot(client.history);
+    client.inputs[tick % NET_HISTORY_TICKS] = input;
+    uint8_t consumed = stepSimulation(tickTime, input);
+    captureNetState(client.predicted);
+    client.hashes[(tick + 1) % NET_HISTORY_TICKS] = netStateHash(client.predicted);
+    return consumed;
+}
+
+void sendNetInput(NetClient& client, long tick, uint8_t input) {
+    std::vector<uint8_t> payload;
+    putVarint(payload, static_cast<uint32_t>(tick));
+    payload.push_back(input);
+    sendNetMessage(client.connection, NET_INPUT, payload);
+}
+
+bool startNetClient(NetClient& client) {
+    uint8_t type, input;
+    std::vector<uint8_t> payload;
+    if (!receiveNetMessage(client.connection, type, payload, 10000) || type != NET_FRAME ||
+        !decodeNetFrame(payload, client.mirror, input) || client.mirror.tick != 0) {
+        std::cerr << "The server sent no keyframe" << std::endl;
+        return false;
+    }
+    captureNetState(client.predicted);
+    if (netStateHash(client.predicted) != netStateHash(client.mirror)) {
+        std::cerr << "The server's level differs from this one (check --pack)" << std::endl;
+        return false;
+    }
+    client.hashes[0] = netStateHash(client.predicted);
+    initSnapshotRing(client.history, NET_HISTORY_TICKS);
+    client.finished = false;
+    client.rollbacks = client.corrections = client.resimulatedTicks = 0;
+
+    // Start ahead, so inputs reach the server before it steps their ticks
+    float tickTime = 1.0f / static_cast<float>(client.session.tickRate);
+    for (int k = 0; k < NET_INPUT_LEAD; ++k) {
+        sendNetInput(client, world->tickCount, 0);
+        predictNetTick(client, tickTime, 0);
+    }
+    return true;
+}
+
+// The server stepped to `mirror.tick` with `input`: confirm the prediction or redo it
+void reconcileNetFrame(NetClient& client, float tickTime, uint8_t input) {
+    long tick = client.mirror.tick;
+    if (tick < 1) return;
+    while (world->tickCount < tick) { // Server ahead (the client stalled): catch up on its inputs
+        predictNetTick(client, tickTime, input);
+    }
+    long now = world->tickCount;
+    if (now - tick >= NET_HISTORY_TICKS) return; // Out of the history; later frames will tell
+
+    uint32_t expected = netStateHash(client.mirror);
+    uint8_t& stepped = client.inputs[(tick - 1) % NET_HISTORY_TICKS];
+    if (stepped == input && client.hashes[tick % NET_HISTORY_TICKS] == expected) return; // Predicted right
+    if (rollbackTo(client.history, tick - 1) != tick - 1) return;
+    client.rollbacks++;
+
+    bool logEvents = world->logEvents;
+    world->logEvents = false; // Resimulated events were logged the first time round
+    stepped = input;
+    pushSnapshot(client.history);
+    stepSimulation(tickTime, input);
+    captureNetState(client.predicted);
+    if (netStateHash(client.predicted) != expected) {
+        applyNetState(client.mirror); // Not just a late input: take the server's word for it
+        client.corrections++;
+    }
+    client.hashes[tick % NET_HISTORY_TICKS] = expected;
+    for (long t = tick; t < now; ++t) {
+        predictNetTick(client, tickTime, client.inputs[t % NET_HISTORY_TICKS]);
+        client.resimulatedTicks++;
+    }
+    world->logEvents = logEvents;
+}
+
+uint8_t stepNetClient(NetClient& client, float tickTime, uint8_t input) {
+    uint8_t type, applied;
+    std::vector<uint8_t> payload;
+    while (!client.finished && receiveNetMessage(client.connection, type, payload, 0)) {
+        if (type == NET_BYE) client.finished = true;
+        else if (type == NET_FRAME && decodeNetFrame(payload, client.mirror, applied)) reconcileNetFrame(client, tickTime, applied);
+    }
+    if (!netConnected(client.connection)) client.finished = true;
+    if (client.finished) return 0;
+
+    sendNetInput(client, world->tickCount, input);
+    return predictNetTick(client, tickTime, input);
+}
+
+void stopNetClient(NetClient& client) {
+    if (netConnected(client.connection)) sendNetMessage(client.connection, NET_BYE, std::vector<uint8_t>());
+    closeNetConnection(client.connection);
+    client.finished = true;
+}
@@ -0,0 +1,159 @@
+/**
+ * Lode Runner networked sessions
+ *
+ * A server (lode_runner_headless --serve) plays the authoritative session and a client
+ * (the game or lode_runner_headless with --connect) controls its runner over TCP. Both
+ * build the same level from the same seed, so the client predicts every tick locally
+ * with its own input and shows the result at once, without waiting for the server.
+ *
+ * Each tick the server sends a frame: the input mask it applied (the client's, if it
+ * arrived in time), the cells whose tile, hole or gold changed and the runners whose
+ * quantized position or flags changed, all delta-encoded against the previous frame.
+ * The client keeps a mirror of that state and compares it with its prediction for the
+ * same tick. On a mismatch it rolls back to the tick before (see snapshot.h), steps it
+ * again with the server's input, snaps to the mirror if that still disagrees, and
+ * resimulates up to the present with its own later inputs.
+ *
+ * The simulation has a single runner, so a session has one client; co-op and versus
+ * need more than one player in the World and are not covered here.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "game.h"
+#include "snapshot.h"
+
+// --- Protocol ---
+// Messages are a type byte, the payload length as a LEB128 varint, then the payload.
+// Multi-byte integers are LEB128 varints (zigzag for signed values) unless noted.
+const uint32_t NET_MAGIC = 0x4E52524C; // "LRRN"
+const uint32_t NET_VERSION = 1;
+const int NET_DEFAULT_PORT = 27960;
+const float NET_POSITION_SCALE = 8.0f; // Wire units per pixel (positions are sent to 1/8 pixel)
+const int NET_HISTORY_TICKS = 32;      // Ticks a client can roll back (about half a second at 60 Hz)
+const int NET_INPUT_LEAD = 4;          // Ticks a client runs ahead of the server, so its inputs arrive in time
+
+enum NetMessageType : uint8_t {
+    NET_HELLO = 1,   // Client -> server: magic, version (4 bytes each, little-endian)
+    NET_WELCOME = 2, // Server -> client: NetSessionInfo
+    NET_INPUT = 3,   // Client -> server: tick, mask (the input for the step from `tick`)
+    NET_FRAME = 4,   // Server -> client: state after a tick, see encodeNetFrame()
+    NET_BYE = 5,     // Either way: the session is over
+};
+
+// Settings a client needs to build the server's session
+struct NetSessionInfo {
+    unsigned int seed = 0;
+    int tickRate = DEFAULT_TICK_RATE;
+    int enemies = DEFAULT_ENEMIES;
+    int level = -1; // Pack level, -1 for the built-in level
+};
+
+// --- Wire State ---
+// What the server streams: per cell the tile type in the low bits plus hole and gold bits,
+// and per runner its position in NET_POSITION_SCALE units plus state flags.
+enum NetCellBit : uint8_t {
+    NET_CELL_TILE = 0x07, // TileType
+    NET_CELL_HOLE = 1 << 3,
+    NET_CELL_GOLD = 1 << 4,
+};
+
+enum NetEntityFlag : uint8_t {
+    NET_ALIVE = 1 << 0,
+    NET_TRAPPED = 1 << 1,
+    NET_FACE_RIGHT = 1 << 2,
+    NET_CLIMBING = 1 << 3,
+    NET_ON_ROPE = 1 << 4,
+    NET_FALLING = 1 << 5,
+};
+
+enum NetStatusBit : uint8_t {
+    NET_GAME_OVER = 1 << 0,
+    NET_GAME_WON = 1 << 1,
+    NET_LEVEL_COMPLETE = 1 << 2,
+};
+
+struct NetEntity {
+    int32_t x, y;
+    uint8_t flags; // NetEntityFlag bits
+};
+
+struct NetState {
+    long tick = 0; // Ticks stepped
+    int mapWidth = 0, mapHeight = 0;
+    uint8_t cells[GRID_HEIGHT * GRID_WIDTH] = {}; // NetCellBit values, indexed y * GRID_WIDTH + x
+    std::vector<NetEntity> entities;
+    int score = 0, lives = 0, gold = 0;
+    uint8_t status = 0; // NetStatusBit bits
+};
+
+void captureNetState(NetState& state);         // Quantizes the current world
+uint32_t netStateHash(const NetState& state);  // FNV-1a over the map's cells, the runners and the score
+void applyNetState(const NetState& state);     // Snaps the current world to it (positions, flags, tiles, holes, gold)
+// Appends the frame bringing `previous` up to `current`, which the server stepped with `input`
+void encodeNetFrame(const NetState& previous, const NetState& current, uint8_t input, std::vector<uint8_t>& out);
+// Applies a frame to `state`; false if it is malformed
+bool decodeNetFrame(const std::vector<uint8_t>& frame, NetState& state, uint8_t& input);
+
+// --- Connections ---
+typedef intptr_t NetSocket; // SOCKET on Windows, a file descriptor elsewhere
+const NetSocket NET_NO_SOCKET = -1;
+
+struct NetConnection {
+    NetSocket socket = NET_NO_SOCKET;
+    std::vector<uint8_t> received; // Bytes read but not yet returned as messages
+    long bytesSent = 0, bytesReceived = 0;
+};
+
+bool netConnected(const NetConnection& connection);
+void closeNetConnection(NetConnection& connection);
+bool sendNetMessage(NetConnection& connection, uint8_t type, const std::vector<uint8_t>& payload);
+// Next complete message; waits up to `timeoutMs` for one (0 polls). False if none, or the peer is gone.
+bool receiveNetMessage(NetConnection& connection, uint8_t& type, std::vector<uint8_t>& payload, int timeoutMs);
+
+// --- Server ---
+struct NetServer {
+    NetSocket listener = NET_NO_SOCKET;
+    NetConnection client;
+    NetState sent;    // State as of the last frame sent
+    NetState current; // Scratch for the next one
+    uint8_t queuedInput[NET_HISTORY_TICKS] = {}; // Client inputs by tick % NET_HISTORY_TICKS...
+    long queuedTick[NET_HISTORY_TICKS] = {};     // ...and the tick each is for (-1 if none)
+    uint8_t held = 0;    // Mask applied when the client's input for a tick is missing
+    long lateInputs = 0; // Client inputs that arrived after their tick was stepped
+};
+
+bool startNetServer(NetServer& server, int port); // Listens on all interfaces
+bool acceptNetClient(NetServer& server);          // Waits for a client's hello
+// Sends the session settings and a keyframe of the current world, which initGame() has just built
+void beginNetSession(NetServer& server, const NetSessionInfo& session);
+uint8_t nextNetInput(NetServer& server); // Reads the client's inputs; the mask for the tick about to be stepped
+void sendNetFrame(NetServer& server, uint8_t input, uint8_t consumed); // After stepping with `input`
+void endNetSession(NetServer& server);
+void stopNetServer(NetServer& server);
+
+// --- Client ---
+struct NetClient {
+    NetConnection connection;
+    NetSessionInfo session;
+    NetState mirror;     // Server's state as of mirror.tick, rebuilt from its frames
+    NetState predicted;  // Scratch capture of the local world
+    SnapshotRing history;                 // Local world before each recent tick, for rollback
+    uint8_t inputs[NET_HISTORY_TICKS] = {};  // Mask stepped from each tick, by tick % NET_HISTORY_TICKS
+    uint32_t hashes[NET_HISTORY_TICKS] = {}; // netStateHash() of the local world at each tick
+    bool finished = false; // The server ended the session or the connection dropped
+    long rollbacks = 0, corrections = 0, resimulatedTicks = 0;
+};
+
+// Connects and waits for the server's session settings; the caller then builds that
+// session (level, enemies, initGame(seed)) in the current world and calls startNetClient()
+bool connectNetClient(NetClient& client, const char* host, int port);
+bool startNetClient(NetClient& client); // Checks the level against the server's keyframe and runs NET_INPUT_LEAD ticks ahead
+// One predicted tick with `input`, after reconciling with the frames that have arrived;
+// returns the INPUT_ONE_SHOT bits consumed, like stepSimulation()
+uint8_t stepNetClient(NetClient& client, float tickTime, uint8_t input);
+void stopNetClient(NetClient& client);
@@ -0,0 +1,43 @@
+/**
+ * Lode Runner frame pacing: ticks per frame and when the frame loop may stop. See pacing.h.
+ */
+
+#include "pacing.h"
+
+#include <cmath>
+
+int takeFrameTicks(FrameClock& clock, float frameTime, float tickTime, int speed) {
+    // Clamp to avoid a burst of ticks after debugging or a window drag
+    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+    clock.accumulator += frameTime * speed;
+
+    int ticks = 0;
+    while (clock.accumulator >= tickTime && ticks < MAX_TICKS_PER_FRAME * speed) {
+        clock.accumulator -= tickTime;
+        ticks++;
+    }
+    // Still behind after the catch-up limit: drop the backlog rather than spiral
+    if (clock.accumulator >= tickTime) clock.accumulator = fmod(clock.accumulator, tickTime);
+    clock.alpha = clock.accumulator / tickTime;
+    return ticks;
+}
+
+FrameDecision endFrame(const FrameState& state) {
+    FrameDecision decision;
+    decision.schedule = state.sessionInPlay || state.alwaysActive;
+    decision.redraw = state.windowVisible && (decision.schedule || state.ticks > 0 || state.redrawRequested);
+    return decision;
+}
+
+void restartCadence(FrameCadence& cadence, double now) {
+    cadence.nextFrame = now;
+}
+
+int nextFrameDelayMs(FrameCadence& cadence, double now, int frameRate) {
+    if (frameRate <= 0) return 0;
+    double period = 1.0 / frameRate;
+    cadence.nextFrame += period;
+    if (cadence.nextFrame + period < now) cadence.nextFrame = now;
+    if (cadence.nextFrame <= now) return 0;
+    return static_cast<int>((cadence.nextFrame - now) * 1000.0);
+}
@@ -0,0 +1,59 @@
+/**
+ * Lode Runner frame pacing
+ *
+ * The game's frame loop (update() in lode_runner) apart from its GLUT calls: when the
+ * next frame is due, how many ticks a frame's real time pays for, and whether the frame
+ * is drawn and the loop goes on. A frame on a display faster than the tick rate (or just
+ * off its phase) often pays for no tick; whether the loop goes on depends on the session,
+ * never on that count. lode_runner_headless --fps=N runs sessions through the same
+ * functions on a simulated clock and checks the loop's decisions.
+ */
+
+#pragma once
+
+// --- Frame Timing ---
+const int MAX_TICKS_PER_FRAME = 8;  // Catch-up limit before the backlog is dropped
+const float MAX_FRAME_TIME = 0.25f; // Longest real time accounted for in one frame (seconds)
+
+struct FrameClock {
+    float accumulator = 0.0f; // Real time not yet consumed by ticks (seconds)
+    float alpha = 0.0f;       // Progress into the next tick [0, 1) used to interpolate drawing
+};
+
+// Adds frameTime seconds (clamped to MAX_FRAME_TIME) at `speed` times real time and
+// returns the ticks to run for it, at most MAX_TICKS_PER_FRAME * speed; a backlog past
+// that is dropped rather than let spiral. `alpha` is where those ticks leave drawing.
+int takeFrameTicks(FrameClock& clock, float frameTime, float tickTime, int speed);
+
+// --- Frame Loop ---
+// What the frame loop knows once a frame's ticks have run
+struct FrameState {
+    int ticks;            // Ticks the frame ran, often none
+    bool sessionInPlay;   // Neither game over nor won, after those ticks
+    bool alwaysActive;    // The picture moves anyway: replay, network session, profiler, --always-redraw
+    bool redrawRequested; // Input or a window change since the last frame was drawn
+    bool windowVisible;   // Not minimised or fully covered
+};
+
+struct FrameDecision {
+    bool redraw;   // Draw the frame
+    bool schedule; // Schedule the next frame; otherwise the loop idles until an event
+};
+
+// Keeps the loop going while the session is in play (however many ticks the frame ran)
+// or alwaysActive; draws while it does, and once more for the frame whose ticks ended the
+// session or after a redraw request, but never into a hidden window
+FrameDecision endFrame(const FrameState& state);
+
+// --- Frame Cadence ---
+// Frames are due on a fixed cadence, so a timer with whole-millisecond delays doesn't
+// drift; more than a frame behind, the cadence restarts rather than rushing to catch up
+struct FrameCadence {
+    double nextFrame = 0.0; // When the last scheduled frame was due (seconds, on the caller's clock)
+};
+
+void restartCadence(FrameCadence& cadence, double now); // The next frame is one period from now
+
+// Milliseconds to wait at `now` for the next frame at frameRate, rounded down; 0 without
+// a frame rate (paced by the buffer swap instead)
+int nextFrameDelayMs(FrameCadence& cadence, double now, int frameRate);
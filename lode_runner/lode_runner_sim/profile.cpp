@@ -0,0 +1,258 @@
+/**
+ * Lode Runner frame profiler: scopes, frame history and export. See profile.h.
+ */
+
+#include "profile.h"
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// --- State ---
+// Written by the profiling thread only; read by whoever exports after it has stopped
+struct ProfileEvent {
+    double start;
+    float duration;
+    uint8_t zone;
+};
+
+struct Profiler {
+    bool running = false;
+    std::chrono::steady_clock::time_point origin;
+    ProfileFrame open;                  // Frame being recorded
+    std::vector<ProfileFrame> history;  // Ring of closed frames, PROFILE_HISTORY_FRAMES once full
+    long closed = 0;                    // Frames closed since startProfiler()
+    int depth[PROFILE_ZONE_COUNT] = {}; // Open scopes per zone
+    std::vector<ProfileEvent> events;   // Outermost scopes, for the trace
+    long droppedEvents = 0;
+};
+
+static Profiler profiler;
+thread_local bool profilerThread = false;
+
+static const char* const ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+    "handleInput", "updatePlayer", "updateEnemies", "updatePhysics", "updateTimers",
+    "drawGrid", "drawEntities", "drawCollectibles", "drawHUD",
+};
+static const char* const COUNTER_NAMES[PROFILE_COUNTER_COUNT] = { "ticks", "drawCalls", "stateChanges", "skippedCalls" };
+static const char* const GPU_PASS_NAMES[PROFILE_GPU_PASS_COUNT] = { "tiles", "sprites", "hud" };
+
+const char* profileZoneName(ProfileZone zone) { return ZONE_NAMES[zone]; }
+const char* profileCounterName(ProfileCounter counter) { return COUNTER_NAMES[counter]; }
+const char* profileGpuPassName(ProfileGpuPass pass) { return GPU_PASS_NAMES[pass]; }
+
+static double profileNow() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - profiler.origin).count();
+}
+
+static void openFrame(long number) {
+    ProfileFrame& frame = profiler.open;
+    frame = ProfileFrame();
+    frame.frame = number;
+    frame.start = profileNow();
+    for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) frame.gpuTime[pass] = -1.0;
+}
+
+static void closeFrame() {
+    profiler.open.duration = profileNow() - profiler.open.start;
+    if (profiler.history.size() < static_cast<size_t>(PROFILE_HISTORY_FRAMES)) profiler.history.push_back(profiler.open);
+    else profiler.history[profiler.closed % PROFILE_HISTORY_FRAMES] = profiler.open;
+    profiler.closed++;
+}
+
+static long oldestHistoryFrame() {
+    return profiler.closed - static_cast<long>(profiler.history.size());
+}
+
+// The closed frame `number`, or nullptr if it has left the history
+static ProfileFrame* historyFrame(long number) {
+    if (number < oldestHistoryFrame() || number >= profiler.closed) return nullptr;
+    return &profiler.history[number % PROFILE_HISTORY_FRAMES];
+}
+
+// --- Control ---
+
+void startProfiler() {
+    profiler.running = true;
+    profiler.origin = std::chrono::steady_clock::now();
+    profiler.history.clear();
+    profiler.closed = 0;
+    for (int& depth : profiler.depth) depth = 0;
+    profiler.events.clear();
+    profiler.droppedEvents = 0;
+    profilerThread = true;
+    openFrame(0);
+}
+
+void stopProfiler() {
+    if (!profiler.running) return;
+    closeFrame();
+    profiler.running = false;
+    profilerThread = false;
+    if (profiler.droppedEvents > 0) {
+        std::cerr << "Profiler: " << profiler.droppedEvents << " scopes past the first " << PROFILE_MAX_EVENTS << " are missing from the trace" << std::endl;
+    }
+}
+
+bool profilerRunning() {
+    return profiler.running;
+}
+
+void nextProfileFrame() {
+    if (!profilerThread) return;
+    closeFrame();
+    openFrame(profiler.closed);
+}
+
+long currentProfileFrame() {
+    return profiler.open.frame;
+}
+
+void addProfileCount(ProfileCounter counter, int amount) {
+    if (profilerThread) profiler.open.counters[counter] += amount;
+}
+
+void setProfileGpuTime(long frame, ProfileGpuPass pass, double microseconds) {
+    if (!profilerThread) return;
+    if (ProfileFrame* closed = historyFrame(frame)) closed->gpuTime[pass] = microseconds;
+    else if (frame == profiler.open.frame) profiler.open.gpuTime[pass] = microseconds;
+}
+
+int averageProfileFrames(int frames, ProfileFrame& average) {
+    average = ProfileFrame();
+    int count = 0;
+    int gpuFrames[PROFILE_GPU_PASS_COUNT] = {};
+    for (long number = profiler.closed - 1; number >= 0 && count < frames; --number) {
+        const ProfileFrame* frame = historyFrame(number);
+        if (!frame) break;
+        average.duration += frame->duration;
+        for (int zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) {
+            average.zoneTime[zone] += frame->zoneTime[zone];
+            average.zoneCalls[zone] += frame->zoneCalls[zone];
+        }
+        for (int counter = 0; counter < PROFILE_COUNTER_COUNT; ++counter) average.counters[counter] += frame->counters[counter];
+        for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) {
+            if (frame->gpuTime[pass] < 0.0) continue;
+            average.gpuTime[pass] += frame->gpuTime[pass];
+            gpuFrames[pass]++;
+        }
+        average.frame = frame->frame;
+        average.start = frame->start;
+        count++;
+    }
+    if (count == 0) {
+        for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) average.gpuTime[pass] = -1.0;
+        return 0;
+    }
+    // Call and counter means are rounded, which keeps whole numbers whole
+    average.duration /= count;
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) {
+        average.zoneTime[zone] /= count;
+        average.zoneCalls[zone] = (average.zoneCalls[zone] + count / 2) / count;
+    }
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; ++counter) average.counters[counter] = (average.counters[counter] + count / 2) / count;
+    for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) {
+        average.gpuTime[pass] = gpuFrames[pass] > 0 ? average.gpuTime[pass] / gpuFrames[pass] : -1.0;
+    }
+    return count;
+}
+
+// --- Scopes ---
+
+bool enterProfileZone(ProfileZone zone, double& start) {
+    if (!profiler.running) return false;
+    if (profiler.depth[zone]++ == 0) start = profileNow();
+    return true;
+}
+
+void leaveProfileZone(ProfileZone zone, double start) {
+    if (--profiler.depth[zone] > 0 || !profiler.running) return;
+    double duration = profileNow() - start;
+    profiler.open.zoneTime[zone] += duration;
+    profiler.open.zoneCalls[zone]++;
+    if (profiler.events.size() < static_cast<size_t>(PROFILE_MAX_EVENTS)) {
+        profiler.events.push_back({ start, static_cast<float>(duration), static_cast<uint8_t>(zone) });
+    }
+    else {
+        profiler.droppedEvents++;
+    }
+}
+
+// --- Export ---
+
+bool writeProfileCsv(const char* path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write profile: " << path << std::endl;
+        return false;
+    }
+    out << "frame,start_us,duration_us";
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) out << "," << ZONE_NAMES[zone] << "_us," << ZONE_NAMES[zone] << "_calls";
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; ++counter) out << "," << COUNTER_NAMES[counter];
+    for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) out << ",gpu_" << GPU_PASS_NAMES[pass] << "_us";
+    out << "\n" << std::fixed << std::setprecision(2);
+
+    for (long number = oldestHistoryFrame(); number < profiler.closed; ++number) {
+        const ProfileFrame& frame = *historyFrame(number);
+        out << frame.frame << "," << frame.start << "," << frame.duration;
+        for (int zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) out << "," << frame.zoneTime[zone] << "," << frame.zoneCalls[zone];
+        for (int counter = 0; counter < PROFILE_COUNTER_COUNT; ++counter) out << "," << frame.counters[counter];
+        for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) {
+            out << ",";
+            if (frame.gpuTime[pass] >= 0.0) out << frame.gpuTime[pass]; // Empty until reported
+        }
+        out << "\n";
+    }
+    if (!out.flush()) {
+        std::cerr << "Cannot write profile: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Scopes and frames on one track, counters and GPU pass times as counter tracks
+bool writeProfileTrace(const char* path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write trace: " << path << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}";
+    double oldest = 0.0; // Scopes of frames that have left the history are left out too
+    if (oldestHistoryFrame() > 0) oldest = historyFrame(oldestHistoryFrame())->start;
+
+    for (long number = oldestHistoryFrame(); number < profiler.closed; ++number) {
+        const ProfileFrame& frame = *historyFrame(number);
+        out << ",\n{\"name\":\"frame " << frame.frame << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+            << frame.start << ",\"dur\":" << frame.duration << "}";
+        out << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.start << ",\"args\":{";
+        for (int counter = 0; counter < PROFILE_COUNTER_COUNT; ++counter) {
+            out << (counter > 0 ? "," : "") << "\"" << COUNTER_NAMES[counter] << "\":" << frame.counters[counter];
+        }
+        out << "}}";
+        bool anyGpu = false;
+        for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) anyGpu = anyGpu || frame.gpuTime[pass] >= 0.0;
+        if (anyGpu) {
+            out << ",\n{\"name\":\"gpu_us\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.start << ",\"args\":{";
+            for (int pass = 0; pass < PROFILE_GPU_PASS_COUNT; ++pass) {
+                out << (pass > 0 ? "," : "") << "\"" << GPU_PASS_NAMES[pass] << "\":" << std::max(frame.gpuTime[pass], 0.0);
+            }
+            out << "}}";
+        }
+    }
+    for (const ProfileEvent& event : profiler.events) {
+        if (event.start < oldest) continue;
+        out << ",\n{\"name\":\"" << ZONE_NAMES[event.zone] << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+            << event.start << ",\"dur\":" << event.duration << "}";
+    }
+    out << "\n]}\n";
+    if (!out.flush()) {
+        std::cerr << "Cannot write trace: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+/**
+ * Lode Runner frame profiler
+ *
+ * Scoped CPU timers around the simulation's update steps and the renderer's draw
+ * functions, per-frame counters (draw calls, GL state changes) and the GPU time of each
+ * render pass, which the renderer measures with timer queries and reports a few frames
+ * late. Closed frames go into a history that the game's overlay averages and that can be
+ * written out as CSV (one row per frame) or as a Chrome trace (chrome://tracing or
+ * Perfetto: one event per timed scope, counters per frame).
+ *
+ * Only the thread that called startProfiler() records, so sessions on other threads
+ * (batches, preloading) do not mix into its frames; elsewhere, and while the profiler is
+ * stopped, a PROFILE_SCOPE costs one thread-local test. Building with
+ * LODE_RUNNER_PROFILE=0 compiles the scopes out altogether.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#ifndef LODE_RUNNER_PROFILE
+#define LODE_RUNNER_PROFILE 1
+#endif
+
+// --- Zones ---
+enum ProfileZone {
+    PROFILE_HANDLE_INPUT,
+    PROFILE_UPDATE_PLAYER,
+    PROFILE_UPDATE_ENEMIES,
+    PROFILE_UPDATE_PHYSICS,
+    PROFILE_UPDATE_TIMERS, // Hole refills, trap expiry and respawns
+    PROFILE_DRAW_GRID,
+    PROFILE_DRAW_ENTITIES,
+    PROFILE_DRAW_COLLECTIBLES,
+    PROFILE_DRAW_HUD,
+    PROFILE_ZONE_COUNT
+};
+
+enum ProfileCounter {
+    PROFILE_TICKS,         // Simulation ticks stepped
+    PROFILE_DRAW_CALLS,
+    PROFILE_STATE_CHANGES, // Binds and uniform uploads that reached GL
+    PROFILE_SKIPPED_CALLS, // Redundant ones the render state tracker dropped
+    PROFILE_COUNTER_COUNT
+};
+
+enum ProfileGpuPass {
+    PROFILE_GPU_TILES,   // Static tile layer
+    PROFILE_GPU_SPRITES, // Gold and runners
+    PROFILE_GPU_HUD,
+    PROFILE_GPU_PASS_COUNT
+};
+
+const char* profileZoneName(ProfileZone zone); // The function the zone times
+const char* profileCounterName(ProfileCounter counter);
+const char* profileGpuPassName(ProfileGpuPass pass);
+
+// --- Frames ---
+const int PROFILE_HISTORY_FRAMES = 36000; // Frames kept, oldest dropped first (ten minutes at 60 Hz)
+const int PROFILE_MAX_EVENTS = 1 << 20;   // Scopes kept for the trace; later ones are counted, not kept
+
+// Times are in microseconds from startProfiler()
+struct ProfileFrame {
+    long frame;
+    double start, duration;
+    double zoneTime[PROFILE_ZONE_COUNT]; // Outermost scopes only, so recursion is not counted twice
+    int zoneCalls[PROFILE_ZONE_COUNT];
+    int counters[PROFILE_COUNTER_COUNT];
+    double gpuTime[PROFILE_GPU_PASS_COUNT]; // -1 until reported
+};
+
+extern thread_local bool profilerThread; // This thread records (set by startProfiler())
+
+void startProfiler(); // Clears the history and opens frame 0 on the calling thread
+void stopProfiler();  // Closes the open frame; the history stays for export
+bool profilerRunning();
+void nextProfileFrame();  // Closes the open frame into the history and opens the next
+long currentProfileFrame(); // Number of the open frame
+void addProfileCount(ProfileCounter counter, int amount = 1); // To the open frame
+// Reports a pass of an earlier frame; ignored once the frame has left the history
+void setProfileGpuTime(long frame, ProfileGpuPass pass, double microseconds);
+// Mean of the newest `frames` closed frames (GPU times over the frames that have them);
+// returns how many were averaged
+int averageProfileFrames(int frames, ProfileFrame& average);
+
+bool writeProfileCsv(const char* path);
+bool writeProfileTrace(const char* path); // Chrome trace event JSON
+
+// --- Scopes ---
+// A scope nested in one of the same zone (updatePhysics() inside a timed batch) adds neither
+// time nor a call; enterProfileZone() is false if the profiler is stopped
+bool enterProfileZone(ProfileZone zone, double& start);
+void leaveProfileZone(ProfileZone zone, double start);
+
+struct ProfileScope {
+    ProfileZone zone;
+    double start;
+    bool timed;
+    explicit ProfileScope(ProfileZone zone) : zone(zone), start(0.0), timed(profilerThread && enterProfileZone(zone, start)) {}
+    ~ProfileScope() { if (timed) leaveProfileZone(zone, start); }
+};
+
+#if LODE_RUNNER_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(zone)
+#else
+#define PROFILE_SCOPE(zone) ((void)0)
+#endif
@@ -0,0 +1,163 @@
+/**
+ * Lode Runner input recordings: run-length encoding, files and checksums. See replay.h.
+ */
+
+#include "replay.h"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+// --- Recording ---
+
+void beginRecording(InputRecording& recording, int tickRate, int level) {
+    recording.seed = world->seed;
+    recording.tickRate = tickRate;
+    recording.enemies = world->numEnemies;
+    recording.level = level;
+    recording.ticks = 0;
+    recording.startChecksum = worldChecksum();
+    recording.endChecksum = 0;
+    recording.runs.clear();
+}
+
+void recordInput(InputRecording& recording, uint8_t input) {
+    if (!recording.runs.empty() && recording.runs.back().input == input && recording.runs.back().ticks < UINT32_MAX) {
+        recording.runs.back().ticks++;
+    }
+    else {
+        recording.runs.push_back({ input, 1 });
+    }
+    recording.ticks++;
+}
+
+void endRecording(InputRecording& recording) {
+    recording.endChecksum = worldChecksum();
+}
+
+bool nextReplayInput(const InputRecording& recording, ReplayCursor& cursor, uint8_t& input) {
+    while (cursor.run < recording.runs.size() && cursor.tick >= recording.runs[cursor.run].ticks) {
+        cursor.run++;
+        cursor.tick = 0;
+    }
+    if (cursor.run >= recording.runs.size()) return false;
+    input = recording.runs[cursor.run].input;
+    cursor.tick++;
+    return true;
+}
+
+// --- Files ---
+
+bool saveRecording(const char* path, const InputRecording& recording) {
+    RecordingHeader header = { RECORDING_MAGIC, RECORDING_VERSION, recording.seed, static_cast<uint32_t>(recording.tickRate),
+        static_cast<uint32_t>(recording.enemies), recording.level, recording.ticks, static_cast<uint32_t>(recording.runs.size()),
+        recording.startChecksum, recording.endChecksum };
+    std::vector<char> data(sizeof(header));
+    std::memcpy(data.data(), &header, sizeof(header));
+    for (const InputRun& run : recording.runs) {
+        data.push_back(static_cast<char>(run.input));
+        uint32_t length = run.ticks;
+        do { // LEB128: seven bits per byte, high bit set while more follow
+            uint8_t byte = length & 0x7F;
+            length >>= 7;
+            data.push_back(static_cast<char>(length ? byte | 0x80 : byte));
+        } while (length);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out || !out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+        std::cerr << "Cannot write recording: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadRecording(const char* path, InputRecording& recording) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open recording: " << path << std::endl;
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    RecordingHeader header;
+    if (data.size() < sizeof(header)) header.magic = 0;
+    else std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION) {
+        std::cerr << path << ": not a version " << RECORDING_VERSION << " input recording" << std::endl;
+        return false;
+    }
+
+    recording.seed = header.seed;
+    recording.tickRate = static_cast<int>(header.tickRate);
+    recording.enemies = static_cast<int>(header.enemies);
+    recording.level = header.level;
+    recording.ticks = header.ticks;
+    recording.startChecksum = header.startChecksum;
+    recording.endChecksum = header.endChecksum;
+    recording.runs.clear();
+
+    size_t pos = sizeof(header);
+    uint32_t total = 0;
+    for (uint32_t r = 0; r < header.runCount; ++r) {
+        InputRun run = { 0, 0 };
+        bool complete = pos < data.size();
+        if (complete) run.input = static_cast<uint8_t>(data[pos++]);
+        for (int shift = 0; complete; shift += 7) {
+            if (pos >= data.size() || shift > 28) {
+                complete = false;
+                break;
+            }
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            run.ticks |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        if (!complete) {
+            std::cerr << path << ": truncated at run " << r << " of " << header.runCount << std::endl;
+            return false;
+        }
+        recording.runs.push_back(run);
+        total += run.ticks;
+    }
+    if (total != header.ticks) {
+        std::cerr << path << ": runs cover " << total << " ticks, header says " << header.ticks << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --- Checksums ---
+
+uint32_t hashBytes(uint32_t hash, const void* bytes, size_t size) {
+    const uint8_t* data = static_cast<const uint8_t*>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t worldChecksum() {
+    uint32_t hash = 2166136261u;
+    for (int y = 0; y < world->mapHeight; ++y) {
+        hash = hashBytes(hash, world->level[y], world->mapWidth * sizeof(TileType));
+        hash = hashBytes(hash, world->collectibles[y], world->mapWidth * sizeof(int));
+        for (int x = 0; x < world->mapWidth; ++x) {
+            const DugHole& hole = world->dugHoles[y][x];
+            if (!hole.active) continue;
+            int cell = y * GRID_WIDTH + x;
+            hash = hashBytes(hash, &cell, sizeof(cell));
+            int32_t ticksLeft = static_cast<int32_t>(world->timers.due[cell] - world->timers.now); // Same width everywhere
+            hash = hashBytes(hash, &ticksLeft, sizeof(ticksLeft));
+        }
+    }
+    const EntityStore& entities = world->entities;
+    size_t count = static_cast<size_t>(entities.count);
+    hash = hashBytes(hash, entities.x.data(), count * sizeof(float));
+    hash = hashBytes(hash, entities.y.data(), count * sizeof(float));
+    hash = hashBytes(hash, entities.isAlive.data(), count);
+    hash = hashBytes(hash, entities.isTrapped.data(), count);
+    int totals[3] = { world->score, world->lives, world->collectiblesCollected };
+    hash = hashBytes(hash, totals, sizeof(totals));
+    return hashBytes(hash, &world->rngState, sizeof(world->rngState));
+}
@@ -0,0 +1,75 @@
+/**
+ * Lode Runner input recordings
+ *
+ * A session is fully determined by its level, seed, enemy count, tick rate and the
+ * InputBit mask passed to each stepSimulation() call. A recording stores those, with
+ * the masks run-length encoded (ticks rarely change buttons), so a session played in the
+ * game can be replayed headlessly at full speed, or in the game with fast-forward.
+ * Checksums of the world after initGame() and after the last tick tell whether a replay
+ * started from the same level and reproduced the same outcome.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "game.h"
+
+// --- File Layout ---
+// Little-endian: RecordingHeader, then runCount runs of one mask byte followed by the
+// run's length in ticks as a LEB128 varint (one byte for runs under 128 ticks).
+const uint32_t RECORDING_MAGIC = 0x4352524C; // "LRRC"
+const uint32_t RECORDING_VERSION = 2; // 2: timers count whole ticks (see TimerWheel), so version 1 sessions play out differently
+
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    uint32_t tickRate;
+    uint32_t enemies;
+    int32_t level;          // Pack level, -1 for the built-in level
+    uint32_t ticks;
+    uint32_t runCount;
+    uint32_t startChecksum; // worldChecksum() after initGame()
+    uint32_t endChecksum;   // worldChecksum() after the last tick
+};
+
+static_assert(sizeof(RecordingHeader) == 40, "The header is read straight from the file");
+
+// --- Recording ---
+struct InputRun {
+    uint8_t input;  // InputBit mask
+    uint32_t ticks; // Consecutive ticks it was passed for
+};
+
+struct InputRecording {
+    unsigned int seed = 0;
+    int tickRate = DEFAULT_TICK_RATE;
+    int enemies = DEFAULT_ENEMIES;
+    int level = -1;
+    uint32_t ticks = 0;
+    uint32_t startChecksum = 0;
+    uint32_t endChecksum = 0;
+    std::vector<InputRun> runs;
+};
+
+// Position in a recording while it is played back
+struct ReplayCursor {
+    size_t run = 0;
+    uint32_t tick = 0; // Ticks used of the current run
+};
+
+// Starts a recording of the current world, which initGame() has just built
+void beginRecording(InputRecording& recording, int tickRate, int level);
+void recordInput(InputRecording& recording, uint8_t input); // Mask passed to this tick's stepSimulation()
+void endRecording(InputRecording& recording); // Stamps the final state's checksum
+bool saveRecording(const char* path, const InputRecording& recording);
+bool loadRecording(const char* path, InputRecording& recording); // False (with a message) if unusable
+
+// Next tick's mask; false once the recording is used up
+bool nextReplayInput(const InputRecording& recording, ReplayCursor& cursor, uint8_t& input);
+
+// FNV-1a over the current world's tiles, holes, gold, runners and score
+uint32_t worldChecksum();
@@ -0,0 +1,212 @@
+/**
+ * Lode Runner world snapshots: save, restore and the rollback ring. See snapshot.h.
+ */
+
+#include "snapshot.h"
+#include <cstring>
+
+// --- Copies ---
+
+template <typename T>
+void saveSlots(T* out, const std::vector<T>& in, int count) {
+    std::memcpy(out, in.data(), count * sizeof(T));
+}
+
+template <typename T>
+void restoreSlots(std::vector<T>& out, const T* in, int count) {
+    std::memcpy(out.data(), in, count * sizeof(T));
+}
+
+// The first `rows` rows of a [GRID_HEIGHT][GRID_WIDTH] (or cell-indexed) array
+template <typename T>
+void copyRows(T* out, const T* in, int rows) {
+    std::memcpy(out, in, rows * GRID_WIDTH * sizeof(T));
+}
+
+// Pending timers slot by slot, each slot's list from its head, so restoring them in reverse
+// rebuilds the lists in the same order and timers due together fire in the same order
+static void saveTimers(WorldSnapshot& snapshot) {
+    const TimerWheel& wheel = world->timers;
+    int count = 0;
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) {
+        for (int id = wheel.head[slot]; id != TIMER_NONE; id = wheel.next[id]) {
+            snapshot.timerIds[count] = id;
+            snapshot.timerDue[count] = wheel.due[id];
+            count++;
+        }
+    }
+    snapshot.timerCount = count;
+    snapshot.timerNow = wheel.now;
+}
+
+static void restoreTimers(const WorldSnapshot& snapshot) {
+    TimerWheel& wheel = world->timers;
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) { // Cheaper than resetTimers() while few are pending
+        for (int id = wheel.head[slot]; id != TIMER_NONE; id = wheel.next[id]) wheel.due[id] = TIMER_NONE;
+        wheel.head[slot] = TIMER_NONE;
+    }
+    wheel.pending = 0;
+    wheel.now = snapshot.timerNow;
+    for (int k = snapshot.timerCount - 1; k >= 0; --k) scheduleTimer(snapshot.timerIds[k], snapshot.timerDue[k]);
+}
+
+// --- Snapshots ---
+
+void saveSnapshot(WorldSnapshot& snapshot) {
+    snapshot.tickCount = world->tickCount;
+    snapshot.gameTime = world->gameTime;
+    snapshot.rngState = world->rngState;
+    snapshot.mapWidth = world->mapWidth;
+    snapshot.mapHeight = world->mapHeight;
+    snapshot.gameOver = world->gameOver;
+    snapshot.gameWon = world->gameWon;
+    snapshot.levelComplete = world->levelComplete;
+    snapshot.collectiblesCollected = world->collectiblesCollected;
+    snapshot.totalCollectibles = world->totalCollectibles;
+    snapshot.score = world->score;
+    snapshot.lives = world->lives;
+
+    const EntityStore& entities = world->entities;
+    int count = entities.count;
+    snapshot.entityCount = count;
+    saveSlots(snapshot.x, entities.x, count);
+    saveSlots(snapshot.y, entities.y, count);
+    saveSlots(snapshot.prevX, entities.prevX, count);
+    saveSlots(snapshot.prevY, entities.prevY, count);
+    saveSlots(snapshot.vx, entities.vx, count);
+    saveSlots(snapshot.vy, entities.vy, count);
+    saveSlots(snapshot.isClimbing, entities.isClimbing, count);
+    saveSlots(snapshot.isOnRope, entities.isOnRope, count);
+    saveSlots(snapshot.isFalling, entities.isFalling, count);
+    saveSlots(snapshot.isJumping, entities.isJumping, count);
+    saveSlots(snapshot.faceRight, entities.faceRight, count);
+    saveSlots(snapshot.isTrapped, entities.isTrapped, count);
+    saveSlots(snapshot.isAlive, entities.isAlive, count);
+    saveSlots(snapshot.isDormant, entities.isDormant, count);
+    saveSlots(snapshot.sleepTime, entities.sleepTime, count);
+    saveSlots(snapshot.startGridX, entities.startGridX, count);
+    saveSlots(snapshot.startGridY, entities.startGridY, count);
+
+    int rows = world->mapHeight;
+    copyRows(&snapshot.level[0][0], &world->level[0][0], rows);
+    std::memcpy(snapshot.solidRows, world->solidRows, rows * sizeof(RowMask));
+    std::memcpy(snapshot.climbableRows, world->climbableRows, rows * sizeof(RowMask));
+    std::memcpy(snapshot.hangableRows, world->hangableRows, rows * sizeof(RowMask));
+    std::memcpy(snapshot.diggableRows, world->diggableRows, rows * sizeof(RowMask));
+    copyRows(&snapshot.dugHoles[0][0], &world->dugHoles[0][0], rows);
+    std::memcpy(snapshot.activeHoles, world->activeHoles, world->numActiveHoles * sizeof(int));
+    snapshot.numActiveHoles = world->numActiveHoles;
+    saveTimers(snapshot);
+    copyRows(&snapshot.collectibles[0][0], &world->collectibles[0][0], rows);
+    copyRows(&snapshot.navGraph[0][0], &world->navGraph[0][0], rows);
+
+    copyRows(&snapshot.flowDistance[0][0], &world->flowDistance[0][0], rows);
+    copyRows(&snapshot.flowRhs[0][0], &world->flowRhs[0][0], rows);
+    snapshot.flowGoalX = world->flowGoalX;
+    snapshot.flowGoalY = world->flowGoalY;
+    std::memcpy(snapshot.flowQueue, world->flowQueue, world->flowQueueSize * sizeof(int));
+    copyRows(snapshot.flowQueueKey, world->flowQueueKey, rows);
+    copyRows(snapshot.flowQueuePos, world->flowQueuePos, rows);
+    snapshot.flowQueueSize = world->flowQueueSize;
+
+    int buckets = SPATIAL_LAYERS * world->mapHeight * world->mapWidth;
+    std::memcpy(snapshot.spatialCellStart, world->spatialCellStart, (buckets + 1) * sizeof(int));
+    snapshot.spatialEntityCount = static_cast<int>(world->spatialEntities.size());
+    saveSlots(snapshot.spatialEntities, world->spatialEntities, snapshot.spatialEntityCount);
+}
+
+void restoreSnapshot(const WorldSnapshot& snapshot) {
+    world->tickCount = snapshot.tickCount;
+    world->gameTime = snapshot.gameTime;
+    world->rngState = snapshot.rngState;
+    world->mapWidth = snapshot.mapWidth;
+    world->mapHeight = snapshot.mapHeight;
+    world->gameOver = snapshot.gameOver;
+    world->gameWon = snapshot.gameWon;
+    world->levelComplete = snapshot.levelComplete;
+    world->collectiblesCollected = snapshot.collectiblesCollected;
+    world->totalCollectibles = snapshot.totalCollectibles;
+    world->score = snapshot.score;
+    world->lives = snapshot.lives;
+
+    int count = snapshot.entityCount;
+    if (world->entities.count != count) resizeEntities(count); // Only if restored into another session
+    EntityStore& entities = world->entities;
+    restoreSlots(entities.x, snapshot.x, count);
+    restoreSlots(entities.y, snapshot.y, count);
+    restoreSlots(entities.prevX, snapshot.prevX, count);
+    restoreSlots(entities.prevY, snapshot.prevY, count);
+    restoreSlots(entities.vx, snapshot.vx, count);
+    restoreSlots(entities.vy, snapshot.vy, count);
+    restoreSlots(entities.isClimbing, snapshot.isClimbing, count);
+    restoreSlots(entities.isOnRope, snapshot.isOnRope, count);
+    restoreSlots(entities.isFalling, snapshot.isFalling, count);
+    restoreSlots(entities.isJumping, snapshot.isJumping, count);
+    restoreSlots(entities.faceRight, snapshot.faceRight, count);
+    restoreSlots(entities.isTrapped, snapshot.isTrapped, count);
+    restoreSlots(entities.isAlive, snapshot.isAlive, count);
+    restoreSlots(entities.isDormant, snapshot.isDormant, count);
+    restoreSlots(entities.sleepTime, snapshot.sleepTime, count);
+    restoreSlots(entities.startGridX, snapshot.startGridX, count);
+    restoreSlots(entities.startGridY, snapshot.startGridY, count);
+
+    int rows = snapshot.mapHeight;
+    copyRows(&world->level[0][0], &snapshot.level[0][0], rows);
+    std::memcpy(world->solidRows, snapshot.solidRows, rows * sizeof(RowMask));
+    std::memcpy(world->climbableRows, snapshot.climbableRows, rows * sizeof(RowMask));
+    std::memcpy(world->hangableRows, snapshot.hangableRows, rows * sizeof(RowMask));
+    std::memcpy(world->diggableRows, snapshot.diggableRows, rows * sizeof(RowMask));
+    copyRows(&world->dugHoles[0][0], &snapshot.dugHoles[0][0], rows);
+    std::memcpy(world->activeHoles, snapshot.activeHoles, snapshot.numActiveHoles * sizeof(int));
+    world->numActiveHoles = snapshot.numActiveHoles;
+    restoreTimers(snapshot);
+    copyRows(&world->collectibles[0][0], &snapshot.collectibles[0][0], rows);
+    copyRows(&world->navGraph[0][0], &snapshot.navGraph[0][0], rows);
+
+    copyRows(&world->flowDistance[0][0], &snapshot.flowDistance[0][0], rows);
+    copyRows(&world->flowRhs[0][0], &snapshot.flowRhs[0][0], rows);
+    world->flowGoalX = snapshot.flowGoalX;
+    world->flowGoalY = snapshot.flowGoalY;
+    std::memcpy(world->flowQueue, snapshot.flowQueue, snapshot.flowQueueSize * sizeof(int));
+    copyRows(world->flowQueueKey, snapshot.flowQueueKey, rows);
+    copyRows(world->flowQueuePos, snapshot.flowQueuePos, rows);
+    world->flowQueueSize = snapshot.flowQueueSize;
+
+    int buckets = SPATIAL_LAYERS * snapshot.mapHeight * snapshot.mapWidth;
+    std::memcpy(world->spatialCellStart, snapshot.spatialCellStart, (buckets + 1) * sizeof(int));
+    world->spatialEntities.resize(snapshot.spatialEntityCount); // Within the capacity resizeEntities() reserved
+    restoreSlots(world->spatialEntities, snapshot.spatialEntities, snapshot.spatialEntityCount);
+
+    // Straight to the renderer: notifyTileChanged() would also reset the restored flow field
+    if (world->tileChangeListener) world->tileChangeListener(-1, -1);
+}
+
+// --- Ring ---
+
+void initSnapshotRing(SnapshotRing& ring, int capacity) {
+    ring.slots.resize(capacity > 0 ? capacity : 1);
+    ring.newest = -1;
+    ring.stored = 0;
+}
+
+void pushSnapshot(SnapshotRing& ring) {
+    int capacity = static_cast<int>(ring.slots.size());
+    if (ring.stored == 0 || ring.slots[ring.newest].tickCount != world->tickCount) {
+        ring.newest = (ring.newest + 1) % capacity;
+        if (ring.stored < capacity) ring.stored++;
+    }
+    saveSnapshot(ring.slots[ring.newest]);
+}
+
+long rollbackTo(SnapshotRing& ring, long tick) {
+    int capacity = static_cast<int>(ring.slots.size());
+    for (int back = 0; back < ring.stored; ++back) {
+        int slot = (ring.newest - back + capacity) % capacity;
+        if (ring.slots[slot].tickCount > tick) continue;
+        restoreSnapshot(ring.slots[slot]);
+        ring.newest = slot;
+        ring.stored -= back;
+        return ring.slots[slot].tickCount;
+    }
+    return -1;
+}
@@ -0,0 +1,88 @@
+/**
+ * Lode Runner world snapshots
+ *
+ * A WorldSnapshot is a plain, fixed-size copy of everything the rest of a session depends
+ * on: runners, tiles and holes, pending timers, gold, score and lives, clocks, the random
+ * generator, the navigation graph, the enemy planner's queue and the spatial index. Saving
+ * and restoring are a few memcpy()s and never allocate, so keeping a SnapshotRing of recent
+ * ticks lets a frontend roll back N ticks and resimulate them every frame (replay seeking,
+ * lookahead, netcode). State every tick rebuilds before reading (the enemy lists, scratch positions)
+ * is not stored, and neither are the renderer hook, the log and the level source: a
+ * snapshot is restored into the session it was taken from.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+const int SNAPSHOT_SLOTS = FIRST_ENEMY + MAX_ENEMIES; // Entity slots a snapshot can hold
+
+struct WorldSnapshot {
+    long tickCount;
+    float gameTime;
+    uint32_t rngState;
+    int mapWidth, mapHeight;
+    bool gameOver, gameWon, levelComplete;
+    int collectiblesCollected, totalCollectibles;
+    int score, lives;
+
+    // Entity store, first `entityCount` slots
+    int entityCount;
+    float x[SNAPSHOT_SLOTS], y[SNAPSHOT_SLOTS];
+    float prevX[SNAPSHOT_SLOTS], prevY[SNAPSHOT_SLOTS];
+    float vx[SNAPSHOT_SLOTS], vy[SNAPSHOT_SLOTS];
+    uint8_t isClimbing[SNAPSHOT_SLOTS], isOnRope[SNAPSHOT_SLOTS], isFalling[SNAPSHOT_SLOTS], isJumping[SNAPSHOT_SLOTS];
+    uint8_t faceRight[SNAPSHOT_SLOTS], isTrapped[SNAPSHOT_SLOTS], isAlive[SNAPSHOT_SLOTS], isDormant[SNAPSHOT_SLOTS];
+    float sleepTime[SNAPSHOT_SLOTS];
+    int startGridX[SNAPSHOT_SLOTS], startGridY[SNAPSHOT_SLOTS];
+
+    // Per-cell state, first `mapHeight` rows (the rows above a map never change)
+    TileType level[GRID_HEIGHT][GRID_WIDTH];
+    RowMask solidRows[GRID_HEIGHT], climbableRows[GRID_HEIGHT], hangableRows[GRID_HEIGHT], diggableRows[GRID_HEIGHT];
+    DugHole dugHoles[GRID_HEIGHT][GRID_WIDTH];
+    int activeHoles[GRID_HEIGHT * GRID_WIDTH];
+    int numActiveHoles;
+    long timerNow;
+    int timerIds[TIMER_IDS]; // First timerCount pending timers, in wheel order
+    long timerDue[TIMER_IDS];
+    int timerCount;
+    int collectibles[GRID_HEIGHT][GRID_WIDTH];
+    uint8_t navGraph[GRID_HEIGHT][GRID_WIDTH];
+
+    // Enemy planner
+    int flowDistance[GRID_HEIGHT][GRID_WIDTH];
+    int flowRhs[GRID_HEIGHT][GRID_WIDTH];
+    int flowGoalX, flowGoalY;
+    int flowQueue[GRID_HEIGHT * GRID_WIDTH]; // First flowQueueSize entries
+    int flowQueueKey[GRID_HEIGHT * GRID_WIDTH];
+    int flowQueuePos[GRID_HEIGHT * GRID_WIDTH];
+    int flowQueueSize;
+
+    // Spatial index as of the last buildSpatialIndex(), which the player reads next tick
+    int spatialCellStart[SPATIAL_LAYERS * GRID_HEIGHT * GRID_WIDTH + 1]; // First buckets + 1 entries
+    int spatialEntities[SNAPSHOT_SLOTS];
+    int spatialEntityCount;
+};
+
+// Both use the current world. About 450 KB: keep snapshots on the heap (e.g. in a SnapshotRing).
+void saveSnapshot(WorldSnapshot& snapshot);
+void restoreSnapshot(const WorldSnapshot& snapshot); // Also reports the whole level as changed
+
+// --- Ring ---
+// The most recent snapshots, oldest overwritten first. Allocated once, so pushing every
+// tick costs only the copy.
+struct SnapshotRing {
+    std::vector<WorldSnapshot> slots;
+    int newest = -1; // Slot of the latest snapshot
+    int stored = 0;  // Valid snapshots, newest backwards
+};
+
+void initSnapshotRing(SnapshotRing& ring, int capacity);
+// Saves the current world as the newest snapshot; a tick already held newest is overwritten
+void pushSnapshot(SnapshotRing& ring);
+// Restores the newest snapshot taken at or before `tick` and drops the newer ones; returns
+// the tick restored to, or -1 (world untouched) if the ring holds nothing that old
+long rollbackTo(SnapshotRing& ring, long tick);